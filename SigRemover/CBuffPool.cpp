@@ -0,0 +1,183 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+
+#include "CBuffPool.h"
+
+
+
+
+CBuffPool::CBuffPool()
+{
+	::InitializeSRWLock(&_lock);
+
+	_pMem = NULL;
+	_szcbBuffer = 0;
+	_nBuffers = 0;
+}
+
+
+CBuffPool::~CBuffPool()
+{
+	Free();
+}
+
+
+BOOL CBuffPool::Init(size_t nBuffers, size_t szcbBuffer)
+{
+	//Pre-allocate buffers
+	//INFO: All memory is committed and touched here, so that using buffers later does not cause page faults.
+	//'nBuffers' = number of buffers to allocate
+	//'szcbBuffer' = size of each buffer in BYTEs (it will be rounded up to the page size)
+	//RETURN:
+	//		= TRUE if success
+	Free();
+
+	SYSTEM_INFO si = {};
+	::GetSystemInfo(&si);
+	size_t szcbPage = si.dwPageSize ? si.dwPageSize : 0x1000;
+
+	szcbBuffer = (szcbBuffer + szcbPage - 1) / szcbPage * szcbPage;
+	if (!nBuffers ||
+		!szcbBuffer ||
+		nBuffers > (size_t)-1 / szcbBuffer)
+	{
+		//Error
+		::SetLastError(ERROR_INVALID_PARAMETER);
+		return FALSE;
+	}
+
+	BYTE* pMem = (BYTE*)::VirtualAlloc(NULL, nBuffers * szcbBuffer, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	if (!pMem)
+		return FALSE;
+
+	//Touch all pages
+	for (size_t i = 0; i < nBuffers * szcbBuffer; i += szcbPage)
+	{
+		((volatile BYTE*)pMem)[i] = 0;
+	}
+
+	AcquireSRWLockExclusive(&_lock);
+
+	_pMem = pMem;
+	_szcbBuffer = szcbBuffer;
+	_nBuffers = nBuffers;
+
+	_arrFree.reserve(nBuffers);
+	for (size_t i = 0; i < nBuffers; i++)
+	{
+		_arrFree.push_back(pMem + i * szcbBuffer);
+	}
+
+	ReleaseSRWLockExclusive(&_lock);
+
+	return TRUE;
+}
+
+
+void CBuffPool::Free()
+{
+	//Free all pooled buffers
+	//IMPORTANT: None of the pooled buffers must be in use!
+	AcquireSRWLockExclusive(&_lock);
+
+	assert(_arrFree.size() == _nBuffers);
+
+	if (_pMem)
+	{
+		verify(::VirtualFree(_pMem, 0, MEM_RELEASE));
+		_pMem = NULL;
+	}
+
+	_szcbBuffer = 0;
+	_nBuffers = 0;
+	_arrFree.clear();
+
+	ReleaseSRWLockExclusive(&_lock);
+}
+
+
+BYTE* CBuffPool::Get(size_t szcbNeeded)
+{
+	//Get a buffer
+	//'szcbNeeded' = minimum size of the buffer in BYTEs
+	//RETURN:
+	//		= Buffer from the pool if one is available and it's large enough, otherwise a newly allocated
+	//		  buffer - in either case it is page-aligned (so it can be used for unbuffered I/O) and must be returned with Release()
+	//		= NULL if out of memory
+	BYTE* pBuff = NULL;
+
+	if (szcbNeeded <= _szcbBuffer)
+	{
+		AcquireSRWLockExclusive(&_lock);
+
+		if (!_arrFree.empty())
+		{
+			pBuff = _arrFree.back();
+			_arrFree.pop_back();
+		}
+
+		ReleaseSRWLockExclusive(&_lock);
+	}
+
+	if (!pBuff)
+	{
+		//Not a pooled buffer
+		pBuff = (BYTE*)::VirtualAlloc(NULL, szcbNeeded ? szcbNeeded : 1, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	}
+
+	return pBuff;
+}
+
+
+void CBuffPool::Release(BYTE* pBuff)
+{
+	//Return a buffer that was received from Get()
+	if (pBuff)
+	{
+		if (pBuff >= _pMem &&
+			pBuff < _pMem + _nBuffers * _szcbBuffer)
+		{
+			//Pooled buffer
+			assert((size_t)(pBuff - _pMem) % _szcbBuffer == 0);
+
+			AcquireSRWLockExclusive(&_lock);
+			_arrFree.push_back(pBuff);
+			ReleaseSRWLockExclusive(&_lock);
+		}
+		else
+		{
+			verify(::VirtualFree(pBuff, 0, MEM_RELEASE));
+		}
+	}
+}
+
+
+size_t CBuffPool::GetBufferSize()
+{
+	//RETURN:
+	//		= Size of each pooled buffer in BYTEs
+	return _szcbBuffer;
+}
@@ -0,0 +1,55 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+//Pool of pre-allocated buffers for file data
+#pragma once
+
+#include "CSigRem.h"
+
+#include <vector>
+
+
+
+class CBuffPool
+{
+	//INFO: This class is thread-safe
+public:
+	CBuffPool();
+	~CBuffPool();
+
+	BOOL Init(size_t nBuffers, size_t szcbBuffer);
+	void Free();
+	BYTE* Get(size_t szcbNeeded);
+	void Release(BYTE* pBuff);
+	size_t GetBufferSize();
+
+private:
+	SRWLOCK _lock;
+	BYTE* _pMem;						//Memory for all pooled buffers (page-aligned), or NULL if not initialized
+	size_t _szcbBuffer;					//Size of each pooled buffer in BYTEs (multiple of the page size)
+	size_t _nBuffers;					//Number of pooled buffers in '_pMem'
+	std::vector<BYTE*> _arrFree;		//Pooled buffers that are not in use
+};
+
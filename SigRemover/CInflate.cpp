@@ -0,0 +1,509 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+
+#include "CInflate.h"
+
+
+
+
+//Base values and extra bits for length codes 257..285
+static const WORD gLengthBase[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const BYTE gLengthExtra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+
+//Base values and extra bits for distance codes 0..29
+static const WORD gDistBase[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const BYTE gDistExtra[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+//Order of code length code lengths in a dynamic block header
+static const BYTE gCodeLenOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+
+
+BOOL CInflate::Inflate(const BYTE* pSrc, size_t szcbSrc, BYTE* pDst, size_t szcbDst, size_t& szcbOut)
+{
+	//Decompress raw DEFLATE data
+	//'pSrc' = compressed data
+	//'szcbSrc' = size of 'pSrc' in BYTEs
+	//'pDst' = buffer for decompressed data
+	//'szcbDst' = size of 'pDst' in BYTEs
+	//'szcbOut' = receives number of BYTEs written into 'pDst'
+	//RETURN:
+	//		= TRUE if all data was decompressed
+	//		= FALSE if data is corrupted, or if it doesn't fit into 'pDst'
+	CInflate inf(pSrc, szcbSrc, pDst, szcbDst);
+
+	BOOL bRes = inf.run();
+	szcbOut = inf._nDstPos;
+
+	return bRes;
+}
+
+
+CInflate::CInflate(const BYTE* pSrc, size_t szcbSrc, BYTE* pDst, size_t szcbDst)
+	: _pSrc(pSrc)
+	, _szcbSrc(szcbSrc)
+	, _nSrcPos(0)
+	, _pDst(pDst)
+	, _szcbDst(szcbDst)
+	, _nDstPos(0)
+	, _uiBitBuff(0)
+	, _nBitCnt(0)
+{
+}
+
+
+BOOL CInflate::run()
+{
+	//Process all blocks
+	for (;;)
+	{
+		if (!needBits(3))
+			return FALSE;
+
+		UINT bLast = getBits(1);
+		UINT nType = getBits(2);
+
+		BOOL bRes;
+		switch (nType)
+		{
+		case 0:
+			bRes = stored();
+			break;
+		case 1:
+			bRes = fixed();
+			break;
+		case 2:
+			bRes = dynamic();
+			break;
+		default:
+			//Invalid block type
+			bRes = FALSE;
+			break;
+		}
+
+		if (!bRes)
+			return FALSE;
+
+		if (bLast)
+			break;
+	}
+
+	return TRUE;
+}
+
+
+BOOL CInflate::needBits(UINT nBits)
+{
+	//Make sure that '_uiBitBuff' has at least 'nBits' bits
+	//RETURN:
+	//		= FALSE if ran out of compressed data
+	assert(nBits <= 32);
+
+	while (_nBitCnt <= 56 &&
+		_nSrcPos < _szcbSrc)
+	{
+		_uiBitBuff |= (ULONGLONG)_pSrc[_nSrcPos++] << _nBitCnt;
+		_nBitCnt += 8;
+	}
+
+	return _nBitCnt >= nBits;
+}
+
+
+UINT CInflate::getBits(UINT nBits)
+{
+	//RETURN:
+	//		= Next 'nBits' bits (needBits() must have been called for them)
+	assert(nBits <= _nBitCnt);
+
+	UINT uiVal = (UINT)(_uiBitBuff & ((1ull << nBits) - 1));
+	_uiBitBuff >>= nBits;
+	_nBitCnt -= nBits;
+
+	return uiVal;
+}
+
+
+BOOL CInflate::stored()
+{
+	//Copy a stored block
+	//Drop bits up to the BYTE boundary, and return whole BYTEs from the bit buffer to the input
+	getBits(_nBitCnt & 7);
+	_nSrcPos -= _nBitCnt / 8;
+	_uiBitBuff = 0;
+	_nBitCnt = 0;
+
+	if (_szcbSrc - _nSrcPos < 4)
+		return FALSE;
+
+	UINT nLen = _pSrc[_nSrcPos] | (_pSrc[_nSrcPos + 1] << 8);
+	UINT nLenCompl = _pSrc[_nSrcPos + 2] | (_pSrc[_nSrcPos + 3] << 8);
+	_nSrcPos += 4;
+
+	if (nLen != (~nLenCompl & 0xFFFF))
+		return FALSE;
+
+	//Copy what fits before failing, as codes() does (callers that peek at the beginning of the data rely on it)
+	size_t szcbCopy = nLen;
+	if (szcbCopy > _szcbSrc - _nSrcPos)
+		szcbCopy = _szcbSrc - _nSrcPos;
+	if (szcbCopy > _szcbDst - _nDstPos)
+		szcbCopy = _szcbDst - _nDstPos;
+
+	memcpy(_pDst + _nDstPos, _pSrc + _nSrcPos, szcbCopy);
+	_nDstPos += szcbCopy;
+	_nSrcPos += szcbCopy;
+
+	return szcbCopy == nLen;
+}
+
+
+BOOL CInflate::codes(const INFLATE_HUFFMAN& hLitLen, const INFLATE_HUFFMAN& hDist)
+{
+	//Decode literals and length/distance pairs of a compressed block
+	for (;;)
+	{
+		int nSym = decode(hLitLen);
+		if (nSym < 0)
+			return FALSE;
+
+		if (nSym < 256)
+		{
+			//Literal
+			if (_nDstPos >= _szcbDst)
+				return FALSE;
+
+			_pDst[_nDstPos++] = (BYTE)nSym;
+		}
+		else if (nSym == 256)
+		{
+			//End of block
+			return TRUE;
+		}
+		else
+		{
+			//Length and distance
+			nSym -= 257;
+			if (nSym >= _countof(gLengthBase) ||
+				!needBits(gLengthExtra[nSym]))
+			{
+				return FALSE;
+			}
+
+			size_t nLen = gLengthBase[nSym] + getBits(gLengthExtra[nSym]);
+
+			nSym = decode(hDist);
+			if (nSym < 0 ||
+				nSym >= _countof(gDistBase) ||
+				!needBits(gDistExtra[nSym]))
+			{
+				return FALSE;
+			}
+
+			size_t nDist = gDistBase[nSym] + getBits(gDistExtra[nSym]);
+
+			if (nDist > _nDstPos ||
+				nLen > _szcbDst - _nDstPos)
+			{
+				return FALSE;
+			}
+
+			//Copy BYTE by BYTE, since the source may overlap what we're writing
+			BYTE* pTo = _pDst + _nDstPos;
+			const BYTE* pFrom = pTo - nDist;
+			_nDstPos += nLen;
+
+			while (nLen--)
+			{
+				*pTo++ = *pFrom++;
+			}
+		}
+	}
+}
+
+
+BOOL CInflate::fixed()
+{
+	//Decode a block with fixed Huffman codes
+	struct FIXED_TABLES
+	{
+		INFLATE_HUFFMAN hLitLen;
+		INFLATE_HUFFMAN hDist;
+
+		FIXED_TABLES()
+		{
+			BYTE lengths[INFLATE_MAX_LITLEN_CODES];
+			int i = 0;
+			for (; i < 144; i++)
+				lengths[i] = 8;
+			for (; i < 256; i++)
+				lengths[i] = 9;
+			for (; i < 280; i++)
+				lengths[i] = 7;
+			for (; i < INFLATE_MAX_LITLEN_CODES; i++)
+				lengths[i] = 8;
+
+			verify(build(hLitLen, lengths, INFLATE_MAX_LITLEN_CODES));
+
+			for (i = 0; i < INFLATE_MAX_DIST_CODES; i++)
+				lengths[i] = 5;
+
+			verify(build(hDist, lengths, INFLATE_MAX_DIST_CODES));
+		}
+	};
+
+	//Built once (thread-safe)
+	static const FIXED_TABLES tables;
+
+	return codes(tables.hLitLen, tables.hDist);
+}
+
+
+BOOL CInflate::dynamic()
+{
+	//Decode a block with dynamic Huffman codes
+	if (!needBits(14))
+		return FALSE;
+
+	UINT nLitLen = getBits(5) + 257;
+	UINT nDist = getBits(5) + 1;
+	UINT nCodeLen = getBits(4) + 4;
+
+	if (nLitLen > 286 ||
+		nDist > INFLATE_MAX_DIST_CODES)
+	{
+		return FALSE;
+	}
+
+	//Read code length code lengths
+	BYTE lengths[INFLATE_MAX_LITLEN_CODES + INFLATE_MAX_DIST_CODES] = {};
+	for (UINT i = 0; i < nCodeLen; i++)
+	{
+		if (!needBits(3))
+			return FALSE;
+
+		lengths[gCodeLenOrder[i]] = (BYTE)getBits(3);
+	}
+
+	INFLATE_HUFFMAN hLitLen, hDist;
+	if (!build(hLitLen, lengths, 19))
+		return FALSE;
+
+	//Read literal/length and distance code lengths (they are one sequence)
+	for (UINT i = 0; i < nLitLen + nDist; )
+	{
+		int nSym = decode(hLitLen);
+		if (nSym < 0)
+			return FALSE;
+
+		if (nSym < 16)
+		{
+			lengths[i++] = (BYTE)nSym;
+		}
+		else
+		{
+			BYTE nLen = 0;
+			UINT nRepeat;
+
+			if (nSym == 16)
+			{
+				//Repeat previous length
+				if (!i ||
+					!needBits(2))
+				{
+					return FALSE;
+				}
+
+				nLen = lengths[i - 1];
+				nRepeat = 3 + getBits(2);
+			}
+			else if (nSym == 17)
+			{
+				if (!needBits(3))
+					return FALSE;
+
+				nRepeat = 3 + getBits(3);
+			}
+			else
+			{
+				if (!needBits(7))
+					return FALSE;
+
+				nRepeat = 11 + getBits(7);
+			}
+
+			if (i + nRepeat > nLitLen + nDist)
+				return FALSE;
+
+			while (nRepeat--)
+			{
+				lengths[i++] = nLen;
+			}
+		}
+	}
+
+	//End of block code must be there
+	if (!lengths[256])
+		return FALSE;
+
+	if (!build(hLitLen, lengths, nLitLen) ||
+		!build(hDist, lengths + nLitLen, nDist))
+	{
+		return FALSE;
+	}
+
+	return codes(hLitLen, hDist);
+}
+
+
+int CInflate::decode(const INFLATE_HUFFMAN& h)
+{
+	//Decode one symbol
+	//RETURN:
+	//		= Decoded symbol
+	//		= -1 if error
+	needBits(INFLATE_MAX_BITS);
+
+	//Short codes take one lookup
+	WORD wEntry = h.fast[_uiBitBuff & ((1 << INFLATE_FAST_BITS) - 1)];
+	if (wEntry)
+	{
+		UINT nLen = wEntry >> 9;
+		if (nLen > _nBitCnt)
+			return -1;
+
+		getBits(nLen);
+		return wEntry & 0x1FF;
+	}
+
+	//Longer codes are decoded one bit at a time (codes are stored MSB first)
+	int nCode = 0;
+	int nFirst = 0;
+	int nIndex = 0;
+	ULONGLONG uiBits = _uiBitBuff;
+
+	for (UINT nLen = 1; nLen <= INFLATE_MAX_BITS && nLen <= _nBitCnt; nLen++)
+	{
+		nCode |= (int)(uiBits & 1);
+		uiBits >>= 1;
+
+		int nCount = h.count[nLen];
+		if (nCode - nCount < nFirst)
+		{
+			getBits(nLen);
+			return h.symbol[nIndex + (nCode - nFirst)];
+		}
+
+		nIndex += nCount;
+		nFirst += nCount;
+		nFirst <<= 1;
+		nCode <<= 1;
+	}
+
+	return -1;
+}
+
+
+BOOL CInflate::build(INFLATE_HUFFMAN& h, const BYTE* pLengths, UINT nCodes)
+{
+	//Build decoding tables for canonical Huffman codes
+	//'pLengths' = code length for each symbol (0 if the symbol is not used)
+	//'nCodes' = number of symbols in 'pLengths'
+	//RETURN:
+	//		= FALSE if the code lengths are over-subscribed
+	assert(nCodes <= INFLATE_MAX_LITLEN_CODES);
+
+	memset(h.count, 0, sizeof(h.count));
+	memset(h.fast, 0, sizeof(h.fast));
+
+	for (UINT s = 0; s < nCodes; s++)
+	{
+		h.count[pLengths[s]]++;
+	}
+
+	if (h.count[0] == nCodes)
+	{
+		//No codes - can be decoded only if not used
+		return TRUE;
+	}
+
+	//Check that the lengths make a valid (possibly incomplete) code
+	int nLeft = 1;
+	for (UINT nLen = 1; nLen <= INFLATE_MAX_BITS; nLen++)
+	{
+		nLeft <<= 1;
+		nLeft -= h.count[nLen];
+		if (nLeft < 0)
+			return FALSE;
+	}
+
+	//Offsets into the symbol table for each length
+	WORD offs[INFLATE_MAX_BITS + 1];
+	offs[1] = 0;
+	for (UINT nLen = 1; nLen < INFLATE_MAX_BITS; nLen++)
+	{
+		offs[nLen + 1] = offs[nLen] + h.count[nLen];
+	}
+
+	for (UINT s = 0; s < nCodes; s++)
+	{
+		if (pLengths[s])
+			h.symbol[offs[pLengths[s]]++] = (WORD)s;
+	}
+
+	//Fill lookup table for short codes (they are reversed, since we read bits LSB first)
+	UINT nCode = 0;
+	UINT nIndex = 0;
+	for (UINT nLen = 1; nLen <= INFLATE_FAST_BITS; nLen++)
+	{
+		for (UINT i = 0; i < h.count[nLen]; i++, nCode++, nIndex++)
+		{
+			UINT nRev = 0;
+			for (UINT b = 0; b < nLen; b++)
+			{
+				nRev |= ((nCode >> b) & 1) << (nLen - 1 - b);
+			}
+
+			WORD wEntry = (WORD)((nLen << 9) | h.symbol[nIndex]);
+			for (UINT j = nRev; j < (1u << INFLATE_FAST_BITS); j += 1u << nLen)
+			{
+				h.fast[j] = wEntry;
+			}
+		}
+
+		nCode <<= 1;
+	}
+
+	return TRUE;
+}
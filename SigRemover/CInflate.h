@@ -0,0 +1,77 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+//Decompressor for raw DEFLATE data (RFC 1951), as used in ZIP files
+#pragma once
+
+#include "CSigRem.h"
+
+
+
+#define INFLATE_MAX_BITS 15					//Max length of a Huffman code, in bits
+#define INFLATE_FAST_BITS 10				//Codes up to this length are decoded with one table lookup
+#define INFLATE_MAX_LITLEN_CODES 288		//Number of literal/length codes
+#define INFLATE_MAX_DIST_CODES 30			//Number of distance codes
+
+
+
+struct INFLATE_HUFFMAN
+{
+	WORD count[INFLATE_MAX_BITS + 1];		//Number of codes of each length
+	WORD symbol[INFLATE_MAX_LITLEN_CODES];	//Symbols ordered by their codes
+	WORD fast[1 << INFLATE_FAST_BITS];		//[next INFLATE_FAST_BITS bits] = (code length << 9) | symbol, or 0 if the code is longer
+};
+
+
+
+class CInflate
+{
+public:
+	static BOOL Inflate(const BYTE* pSrc, size_t szcbSrc, BYTE* pDst, size_t szcbDst, size_t& szcbOut);
+
+protected:
+	CInflate(const BYTE* pSrc, size_t szcbSrc, BYTE* pDst, size_t szcbDst);
+
+	BOOL run();
+	BOOL needBits(UINT nBits);
+	UINT getBits(UINT nBits);
+	BOOL stored();
+	BOOL codes(const INFLATE_HUFFMAN& hLitLen, const INFLATE_HUFFMAN& hDist);
+	BOOL fixed();
+	BOOL dynamic();
+	int decode(const INFLATE_HUFFMAN& h);
+	static BOOL build(INFLATE_HUFFMAN& h, const BYTE* pLengths, UINT nCodes);
+
+private:
+	const BYTE* _pSrc;						//Compressed data
+	size_t _szcbSrc;						//Size of '_pSrc' in BYTEs
+	size_t _nSrcPos;						//Next BYTE to read from '_pSrc'
+	BYTE* _pDst;							//Buffer for decompressed data
+	size_t _szcbDst;						//Size of '_pDst' in BYTEs
+	size_t _nDstPos;						//Number of BYTEs written into '_pDst'
+	ULONGLONG _uiBitBuff;					//Bits read from '_pSrc' that were not used yet (LSB first)
+	UINT _nBitCnt;							//Number of bits in '_uiBitBuff'
+};
+
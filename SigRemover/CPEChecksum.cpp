@@ -0,0 +1,270 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+
+#include "CPEChecksum.h"
+
+
+
+
+DWORD CPEChecksum::Compute(const BYTE* pData, ULONG szcbData, DWORD dwHeaderChecksum, PE_CHECKSUM_KERNEL kernel)
+{
+	//Compute checksum of a PE file
+	//INFO: The checksum is a 16-bit one's complement sum of all WORDs in the file (with the CheckSum field taken out), plus the file size.
+	//      One's complement addition doesn't care about the order, so carries are folded once at the end, instead of after each WORD.
+	//'pData' = contents of the entire PE file
+	//'szcbData' = size of 'pData' in BYTEs
+	//'dwHeaderChecksum' = value of the CheckSum field in the optional header in 'pData'
+	//'kernel' = implementation to use (must be supported by this CPU)
+	//RETURN:
+	//		= Checksum to put into the CheckSum field
+	if (kernel == PCK_Auto)
+		kernel = GetBestKernel();
+
+	assert(IsKernelSupported(kernel));
+
+	size_t nWords = szcbData / sizeof(WORD);
+	ULONGLONG uiSum;
+
+	switch (kernel)
+	{
+	case PCK_AVX2:
+		uiSum = sumWords_AVX2(pData, nWords);
+		break;
+
+	case PCK_SSE2:
+		uiSum = sumWords_SSE2(pData, nWords);
+		break;
+
+	default:
+		assert(kernel == PCK_Scalar);
+		uiSum = sumWords_Scalar(pData, nWords);
+		break;
+	}
+
+	//Last odd BYTE counts as if it was followed by 0
+	if (szcbData & 1)
+		uiSum += pData[szcbData - 1];
+
+	//Fold carries
+	while (uiSum >> 16)
+	{
+		uiSum = (uiSum & 0xFFFF) + (uiSum >> 16);
+	}
+
+	//Take out the CheckSum field (the way CheckSumMappedFile does it)
+	WORD wSum = (WORD)uiSum;
+	WORD wAdjLo = LOWORD(dwHeaderChecksum);
+	WORD wAdjHi = HIWORD(dwHeaderChecksum);
+
+	wSum -= wSum < wAdjLo;
+	wSum -= wAdjLo;
+	wSum -= wSum < wAdjHi;
+	wSum -= wAdjHi;
+
+	return (DWORD)wSum + szcbData;
+}
+
+
+PE_CHECKSUM_KERNEL CPEChecksum::GetBestKernel()
+{
+	//RETURN:
+	//		= Fastest kernel that this CPU supports
+	static PE_CHECKSUM_KERNEL kernel = IsAVX2Supported() ? PCK_AVX2 : PCK_SSE2;
+	return kernel;
+}
+
+
+BOOL CPEChecksum::IsKernelSupported(PE_CHECKSUM_KERNEL kernel)
+{
+	switch (kernel)
+	{
+	case PCK_Auto:
+	case PCK_Scalar:
+	case PCK_SSE2:
+		return TRUE;
+
+	case PCK_AVX2:
+		return IsAVX2Supported();
+
+	default:
+		break;
+	}
+
+	return FALSE;
+}
+
+
+LPCTSTR CPEChecksum::GetKernelName(PE_CHECKSUM_KERNEL kernel)
+{
+	switch (kernel)
+	{
+	case PCK_Auto:
+		return L"auto";
+	case PCK_Scalar:
+		return L"scalar";
+	case PCK_SSE2:
+		return L"sse2";
+	case PCK_AVX2:
+		return L"avx2";
+	default:
+		break;
+	}
+
+	assert(false);
+	return L"";
+}
+
+
+BOOL CPEChecksum::IsAVX2Supported()
+{
+	//RETURN:
+	//		= TRUE if both the CPU and the OS support AVX2
+	static int nSupported = -1;
+	if (nSupported < 0)
+	{
+		BOOL bRes = FALSE;
+
+		int regs[4] = {};
+		__cpuid(regs, 0);
+		if (regs[0] >= 7)
+		{
+			//OS must save YMM registers on context switches (OSXSAVE + AVX, and XCR0 bits for XMM and YMM)
+			__cpuid(regs, 1);
+			if ((regs[2] & (1 << 27)) &&
+				(regs[2] & (1 << 28)) &&
+				(_xgetbv(0) & 0x6) == 0x6)
+			{
+				__cpuidex(regs, 7, 0);
+				bRes = (regs[1] & (1 << 5)) != 0;
+			}
+		}
+
+		nSupported = bRes ? 1 : 0;
+	}
+
+	return nSupported != 0;
+}
+
+
+ULONGLONG CPEChecksum::sumWords_Scalar(const BYTE* pData, size_t nWords)
+{
+	//RETURN:
+	//		= Sum of 'nWords' WORDs from 'pData' (without folding carries)
+	ULONGLONG uiSum = 0;
+
+	const WORD* pW = (const WORD*)pData;
+	for (size_t i = 0; i < nWords; i++)
+	{
+		uiSum += pW[i];
+	}
+
+	return uiSum;
+}
+
+
+ULONGLONG CPEChecksum::sumWords_SSE2(const BYTE* pData, size_t nWords)
+{
+	//RETURN:
+	//		= Sum of 'nWords' WORDs from 'pData' (without folding carries)
+	//INFO: Each 32-bit lane gets both of its WORDs added per block (up to 0x1FFFE), so lanes are moved
+	//      into 64-bit accumulators every 0x8000 blocks, before they can overflow.
+	const size_t knBlockWords = sizeof(__m128i) / sizeof(WORD);
+	const size_t knBlocksPerFlush = 0x8000;
+
+	size_t nBlocks = nWords / knBlockWords;
+	const __m128i* pV = (const __m128i*)pData;
+
+	const __m128i vMaskLo = _mm_set1_epi32(0xFFFF);
+	const __m128i vZero = _mm_setzero_si128();
+	__m128i vSum64 = _mm_setzero_si128();
+
+	while (nBlocks)
+	{
+		size_t nRun = nBlocks < knBlocksPerFlush ? nBlocks : knBlocksPerFlush;
+		nBlocks -= nRun;
+
+		__m128i vSum32 = _mm_setzero_si128();
+		for (; nRun; nRun--, pV++)
+		{
+			__m128i v = _mm_loadu_si128(pV);
+			vSum32 = _mm_add_epi32(vSum32, _mm_and_si128(v, vMaskLo));
+			vSum32 = _mm_add_epi32(vSum32, _mm_srli_epi32(v, 16));
+		}
+
+		vSum64 = _mm_add_epi64(vSum64, _mm_unpacklo_epi32(vSum32, vZero));
+		vSum64 = _mm_add_epi64(vSum64, _mm_unpackhi_epi32(vSum32, vZero));
+	}
+
+	ULONGLONG sums[2];
+	_mm_storeu_si128((__m128i*)sums, vSum64);
+
+	size_t nDone = nWords / knBlockWords * knBlockWords;
+	return sums[0] + sums[1] + sumWords_Scalar((const BYTE*)pV, nWords - nDone);
+}
+
+
+ULONGLONG CPEChecksum::sumWords_AVX2(const BYTE* pData, size_t nWords)
+{
+	//RETURN:
+	//		= Sum of 'nWords' WORDs from 'pData' (without folding carries)
+	//IMPORTANT: Call it only if IsAVX2Supported() returns TRUE!
+	//INFO: Same as sumWords_SSE2() but with 256-bit vectors.
+	const size_t knBlockWords = sizeof(__m256i) / sizeof(WORD);
+	const size_t knBlocksPerFlush = 0x8000;
+
+	size_t nBlocks = nWords / knBlockWords;
+	const __m256i* pV = (const __m256i*)pData;
+
+	const __m256i vMaskLo = _mm256_set1_epi32(0xFFFF);
+	const __m256i vZero = _mm256_setzero_si256();
+	__m256i vSum64 = _mm256_setzero_si256();
+
+	while (nBlocks)
+	{
+		size_t nRun = nBlocks < knBlocksPerFlush ? nBlocks : knBlocksPerFlush;
+		nBlocks -= nRun;
+
+		__m256i vSum32 = _mm256_setzero_si256();
+		for (; nRun; nRun--, pV++)
+		{
+			__m256i v = _mm256_loadu_si256(pV);
+			vSum32 = _mm256_add_epi32(vSum32, _mm256_and_si256(v, vMaskLo));
+			vSum32 = _mm256_add_epi32(vSum32, _mm256_srli_epi32(v, 16));
+		}
+
+		vSum64 = _mm256_add_epi64(vSum64, _mm256_unpacklo_epi32(vSum32, vZero));
+		vSum64 = _mm256_add_epi64(vSum64, _mm256_unpackhi_epi32(vSum32, vZero));
+	}
+
+	ULONGLONG sums[4];
+	_mm256_storeu_si256((__m256i*)sums, vSum64);
+
+	//Don't pay for the AVX-SSE transition in the code that runs after us
+	_mm256_zeroupper();
+
+	size_t nDone = nWords / knBlockWords * knBlockWords;
+	return sums[0] + sums[1] + sums[2] + sums[3] + sumWords_SSE2((const BYTE*)pV, nWords - nDone);
+}
@@ -0,0 +1,60 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+//PE file checksum (same as the one computed by CheckSumMappedFile)
+#pragma once
+
+#include "CSigRem.h"
+
+#include <intrin.h>
+
+
+
+enum PE_CHECKSUM_KERNEL {
+	PCK_Auto,							//Pick the fastest kernel that this CPU supports
+	PCK_Scalar,							//Plain C++
+	PCK_SSE2,							//128-bit SIMD
+	PCK_AVX2,							//256-bit SIMD (needs CPU and OS support)
+
+	PCK_Count							//Number of kernels (must be last)
+};
+
+
+
+class CPEChecksum
+{
+public:
+	static DWORD Compute(const BYTE* pData, ULONG szcbData, DWORD dwHeaderChecksum, PE_CHECKSUM_KERNEL kernel = PCK_Auto);
+	static PE_CHECKSUM_KERNEL GetBestKernel();
+	static BOOL IsKernelSupported(PE_CHECKSUM_KERNEL kernel);
+	static LPCTSTR GetKernelName(PE_CHECKSUM_KERNEL kernel);
+	static BOOL IsAVX2Supported();
+
+protected:
+	static ULONGLONG sumWords_Scalar(const BYTE* pData, size_t nWords);
+	static ULONGLONG sumWords_SSE2(const BYTE* pData, size_t nWords);
+	static ULONGLONG sumWords_AVX2(const BYTE* pData, size_t nWords);
+};
+
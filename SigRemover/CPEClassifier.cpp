@@ -0,0 +1,275 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+
+#include "CPEClassifier.h"
+
+#include <immintrin.h>
+
+
+
+//Offsets in the NT headers (same for 32-bit and 64-bit, up to the optional header)
+#define NT_OFFSET_SIZE_OF_OPT_HDR offsetof(IMAGE_NT_HEADERS32, FileHeader.SizeOfOptionalHeader)
+#define NT_OFFSET_MAGIC offsetof(IMAGE_NT_HEADERS32, OptionalHeader.Magic)
+#define NT_OFFSET_SECTIONS offsetof(IMAGE_NT_HEADERS32, OptionalHeader)
+
+//Offsets of IMAGE_DIRECTORY_ENTRY_SECURITY in the NT headers
+#define NT32_OFFSET_SECURITY_DIR (offsetof(IMAGE_NT_HEADERS32, OptionalHeader.DataDirectory) + IMAGE_DIRECTORY_ENTRY_SECURITY * sizeof(IMAGE_DATA_DIRECTORY))
+#define NT64_OFFSET_SECURITY_DIR (offsetof(IMAGE_NT_HEADERS64, OptionalHeader.DataDirectory) + IMAGE_DIRECTORY_ENTRY_SECURITY * sizeof(IMAGE_DATA_DIRECTORY))
+
+
+
+
+void CPEClassifier::Classify(const HEADER_BATCH& batch, const HEADER_MASKS& masks, PE_CLASSIFY_KERNEL kernel)
+{
+	//Sort files into signed, unsigned and not PE by their first pages
+	//INFO: It makes the same decisions as CSigRem::parse_PE_Headers() does for the entire file, so files in the
+	//      'pUnsigned' and 'pNotPE' masks don't need to be opened again. Files that can't be decided from the
+	//      first page alone (or are too large) go into 'pSigned', so that the full path can deal with them.
+	//'batch' = files to classify
+	//'masks' = receives masks with HDRCLS_MASK_DWORDS(batch.nCount) DWORDs each
+	//'kernel' = implementation to use (must be supported by this CPU)
+	if (kernel == PCLK_Auto)
+		kernel = GetBestKernel();
+
+	assert(IsKernelSupported(kernel));
+
+	size_t szcbMask = HDRCLS_MASK_DWORDS(batch.nCount) * sizeof(DWORD);
+	memset(masks.pSigned, 0, szcbMask);
+	memset(masks.pUnsigned, 0, szcbMask);
+	memset(masks.pNotPE, 0, szcbMask);
+
+	size_t nDone = 0;
+	if (kernel == PCLK_AVX2)
+	{
+		nDone = classify_AVX2(batch, masks);
+	}
+
+	//Remaining files
+	classify_Scalar(batch, nDone, masks);
+}
+
+
+PE_CLASSIFY_KERNEL CPEClassifier::GetBestKernel()
+{
+	//RETURN:
+	//		= Fastest kernel supported by this CPU
+	static PE_CLASSIFY_KERNEL kernel = CPEChecksum::IsAVX2Supported() ? PCLK_AVX2 : PCLK_Scalar;
+	return kernel;
+}
+
+
+BOOL CPEClassifier::IsKernelSupported(PE_CLASSIFY_KERNEL kernel)
+{
+	switch (kernel)
+	{
+	case PCLK_Auto:
+	case PCLK_Scalar:
+		return TRUE;
+
+	case PCLK_AVX2:
+		return CPEChecksum::IsAVX2Supported();
+
+	default:
+		break;
+	}
+
+	return FALSE;
+}
+
+
+LPCTSTR CPEClassifier::GetKernelName(PE_CLASSIFY_KERNEL kernel)
+{
+	switch (kernel)
+	{
+	case PCLK_Auto:
+		return L"auto";
+	case PCLK_Scalar:
+		return L"scalar";
+	case PCLK_AVX2:
+		return L"avx2";
+	default:
+		break;
+	}
+
+	assert(false);
+	return L"";
+}
+
+
+void CPEClassifier::classify_Scalar(const HEADER_BATCH& batch, size_t nFrom, const HEADER_MASKS& masks)
+{
+	//Classify files one at a time
+	//'nFrom' = index of the first file to classify
+	for (size_t i = nFrom; i < batch.nCount; i++)
+	{
+		const BYTE* pPage = batch.pPages + i * HDRCLS_PAGE_SIZE;
+		ULONG szcbFile = batch.pFileSizes[i];
+
+		DWORD* pMask = masks.pSigned;
+
+		if (szcbFile >= INT_MAX)
+		{
+			//Too large - let the full path report it
+		}
+		else if (szcbFile < sizeof(IMAGE_NT_HEADERS64))
+		{
+			pMask = masks.pNotPE;
+		}
+		else
+		{
+			ULONG uiNtOffset = (ULONG)((const IMAGE_DOS_HEADER*)pPage)->e_lfanew;
+			if (uiNtOffset > szcbFile - sizeof(IMAGE_NT_HEADERS64))
+			{
+				//NT headers don't fit into the file (assuming 64-bit, as parse_PE_Headers does)
+				pMask = masks.pNotPE;
+			}
+			else if (uiNtOffset <= HDRCLS_PAGE_SIZE - sizeof(IMAGE_NT_HEADERS64))
+			{
+				//NT headers are in the first page
+				const IMAGE_NT_HEADERS32* pNtHdr = (const IMAGE_NT_HEADERS32*)(pPage + uiNtOffset);
+				const IMAGE_DATA_DIRECTORY* pID = NULL;
+
+				pMask = masks.pNotPE;
+
+#ifndef FUZZING_BUILD
+				if (pNtHdr->Signature == IMAGE_NT_SIGNATURE)
+#endif
+				{
+					//First section header must fit into the file
+					if (uiNtOffset + NT_OFFSET_SECTIONS + pNtHdr->FileHeader.SizeOfOptionalHeader + sizeof(IMAGE_SECTION_HEADER) < szcbFile)
+					{
+						switch (pNtHdr->OptionalHeader.Magic)
+						{
+						case IMAGE_NT_OPTIONAL_HDR32_MAGIC:
+							pID = (const IMAGE_DATA_DIRECTORY*)(pPage + uiNtOffset + NT32_OFFSET_SECURITY_DIR);
+							break;
+
+						case IMAGE_NT_OPTIONAL_HDR64_MAGIC:
+							if (uiNtOffset + sizeof(IMAGE_NT_HEADERS64) < szcbFile)
+								pID = (const IMAGE_DATA_DIRECTORY*)(pPage + uiNtOffset + NT64_OFFSET_SECURITY_DIR);
+							break;
+						}
+					}
+				}
+
+				if (pID)
+				{
+					pMask = pID->Size || pID->VirtualAddress ? masks.pSigned : masks.pUnsigned;
+				}
+			}
+		}
+
+		pMask[i / 32] |= 1u << (i % 32);
+	}
+}
+
+
+size_t CPEClassifier::classify_AVX2(const HEADER_BATCH& batch, const HEADER_MASKS& masks)
+{
+	//Classify HDRCLS_LANES files at a time (it's the scalar logic without branches, where each field is gathered from all pages at once)
+	//RETURN:
+	//		= Number of files classified (the rest is less than HDRCLS_LANES)
+	static_assert(HDRCLS_LANES == 8 && 32 % HDRCLS_LANES == 0, "Lanes must fill mask DWORDs");
+	static_assert((ULONGLONG)HDRCLS_PAGE_SIZE * HDRCLS_LANES < INT_MAX, "Gather indexes must fit into 32 bits");
+
+	const __m256i vOnes = _mm256_set1_epi32(-1);
+	const __m256i vZero = _mm256_setzero_si256();
+	const __m256i vPageOffsets = _mm256_setr_epi32(0, HDRCLS_PAGE_SIZE, HDRCLS_PAGE_SIZE * 2, HDRCLS_PAGE_SIZE * 3,
+		HDRCLS_PAGE_SIZE * 4, HDRCLS_PAGE_SIZE * 5, HDRCLS_PAGE_SIZE * 6, HDRCLS_PAGE_SIZE * 7);
+	const __m256i vIntMax = _mm256_set1_epi32(INT_MAX);
+	const __m256i vNtHdrSz = _mm256_set1_epi32(sizeof(IMAGE_NT_HEADERS64));
+	const __m256i vMaxNtInPage = _mm256_set1_epi32(HDRCLS_PAGE_SIZE - sizeof(IMAGE_NT_HEADERS64));
+	const __m256i vNtSignature = _mm256_set1_epi32(IMAGE_NT_SIGNATURE);
+	const __m256i vLoWord = _mm256_set1_epi32(0xFFFF);
+	const __m256i vMagic32 = _mm256_set1_epi32(IMAGE_NT_OPTIONAL_HDR32_MAGIC);
+	const __m256i vMagic64 = _mm256_set1_epi32(IMAGE_NT_OPTIONAL_HDR64_MAGIC);
+	const __m256i vSecDir32 = _mm256_set1_epi32(NT32_OFFSET_SECURITY_DIR);
+	const __m256i vSecDir64 = _mm256_set1_epi32(NT64_OFFSET_SECURITY_DIR);
+	const __m256i vFirstSectEnd = _mm256_set1_epi32(NT_OFFSET_SECTIONS + sizeof(IMAGE_SECTION_HEADER));
+
+	size_t i = 0;
+	for (; i + HDRCLS_LANES <= batch.nCount; i += HDRCLS_LANES)
+	{
+		const int* pBase = (const int*)(batch.pPages + i * HDRCLS_PAGE_SIZE);
+		__m256i vSz = _mm256_loadu_si256((const __m256i*)(batch.pFileSizes + i));
+
+		//Files of INT_MAX or larger are negative here
+		__m256i vTooLarge = _mm256_or_si256(_mm256_cmpgt_epi32(vZero, vSz), _mm256_cmpeq_epi32(vSz, vIntMax));
+		__m256i vTooSmall = _mm256_cmpgt_epi32(vNtHdrSz, vSz);
+
+		//e_lfanew (unsigned, so compare with max)
+		__m256i vNt = _mm256_i32gather_epi32(pBase, _mm256_add_epi32(vPageOffsets, _mm256_set1_epi32(offsetof(IMAGE_DOS_HEADER, e_lfanew))), 1);
+
+		__m256i vMaxNtInFile = _mm256_sub_epi32(vSz, vNtHdrSz);
+		__m256i vNtPastEnd = _mm256_xor_si256(_mm256_cmpeq_epi32(_mm256_max_epu32(vNt, vMaxNtInFile), vMaxNtInFile), vOnes);
+		__m256i vNtInPage = _mm256_cmpeq_epi32(_mm256_max_epu32(vNt, vMaxNtInPage), vMaxNtInPage);
+
+		//Lanes with NT headers outside of the page read from the beginning of it (and are not used)
+		__m256i vNtOffsets = _mm256_add_epi32(vPageOffsets, _mm256_and_si256(vNt, vNtInPage));
+		vNt = _mm256_and_si256(vNt, vNtInPage);
+
+		__m256i vSizeOfOptHdr = _mm256_and_si256(_mm256_i32gather_epi32(pBase, _mm256_add_epi32(vNtOffsets, _mm256_set1_epi32(NT_OFFSET_SIZE_OF_OPT_HDR)), 1), vLoWord);
+		__m256i vMagic = _mm256_and_si256(_mm256_i32gather_epi32(pBase, _mm256_add_epi32(vNtOffsets, _mm256_set1_epi32(NT_OFFSET_MAGIC)), 1), vLoWord);
+
+		__m256i vIs32 = _mm256_cmpeq_epi32(vMagic, vMagic32);
+		__m256i vIs64 = _mm256_cmpeq_epi32(vMagic, vMagic64);
+
+		__m256i vSecOffsets = _mm256_add_epi32(vNtOffsets, _mm256_blendv_epi8(vSecDir32, vSecDir64, vIs64));
+		__m256i vSecVA = _mm256_i32gather_epi32(pBase, vSecOffsets, 1);
+		__m256i vSecSz = _mm256_i32gather_epi32(pBase, _mm256_add_epi32(vSecOffsets, _mm256_set1_epi32(sizeof(DWORD))), 1);
+
+		//Same checks as in the scalar kernel (all values are small here, so signed compares work)
+		__m256i vBadHdr = _mm256_xor_si256(_mm256_or_si256(vIs32, vIs64), vOnes);
+
+#ifndef FUZZING_BUILD
+		__m256i vSig = _mm256_i32gather_epi32(pBase, vNtOffsets, 1);
+		vBadHdr = _mm256_or_si256(vBadHdr, _mm256_xor_si256(_mm256_cmpeq_epi32(vSig, vNtSignature), vOnes));
+#endif
+
+		__m256i vSectEnd = _mm256_add_epi32(_mm256_add_epi32(vNt, vSizeOfOptHdr), vFirstSectEnd);
+		vBadHdr = _mm256_or_si256(vBadHdr, _mm256_xor_si256(_mm256_cmpgt_epi32(vSz, vSectEnd), vOnes));
+
+		__m256i vNt64End = _mm256_add_epi32(vNt, vNtHdrSz);
+		vBadHdr = _mm256_or_si256(vBadHdr, _mm256_andnot_si256(_mm256_cmpgt_epi32(vSz, vNt64End), vIs64));
+
+		__m256i vNotPE = _mm256_andnot_si256(vTooLarge,
+			_mm256_or_si256(_mm256_or_si256(vTooSmall, vNtPastEnd), _mm256_and_si256(vNtInPage, vBadHdr)));
+
+		__m256i vNoSig = _mm256_and_si256(_mm256_cmpeq_epi32(vSecVA, vZero), _mm256_cmpeq_epi32(vSecSz, vZero));
+		__m256i vUnsigned = _mm256_andnot_si256(_mm256_or_si256(vTooLarge, vNotPE), _mm256_and_si256(vNtInPage, vNoSig));
+
+		DWORD dwNotPE = (DWORD)_mm256_movemask_ps(_mm256_castsi256_ps(vNotPE));
+		DWORD dwUnsigned = (DWORD)_mm256_movemask_ps(_mm256_castsi256_ps(vUnsigned));
+		DWORD dwSigned = ~(dwNotPE | dwUnsigned) & ((1u << HDRCLS_LANES) - 1);
+
+		int nShift = (int)(i % 32);
+		masks.pSigned[i / 32] |= dwSigned << nShift;
+		masks.pUnsigned[i / 32] |= dwUnsigned << nShift;
+		masks.pNotPE[i / 32] |= dwNotPE << nShift;
+	}
+
+	return i;
+}
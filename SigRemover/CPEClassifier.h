@@ -0,0 +1,81 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+
+//Classification of many files at once by their PE headers (from the first page of each file)
+#pragma once
+
+#include "CSigRem.h"
+#include "CPEChecksum.h"
+
+
+
+#define HDRCLS_PAGE_SIZE 0x1000			//Size of the first page of each file that is classified, in BYTEs
+#define HDRCLS_LANES 8					//Number of files classified in one step by the AVX2 kernel
+
+#define HDRCLS_MASK_DWORDS(n) (((n) + 31) / 32)			//Number of DWORDs in a mask for 'n' files
+
+
+
+enum PE_CLASSIFY_KERNEL {
+	PCLK_Auto,							//Pick the fastest kernel that this CPU supports
+	PCLK_Scalar,						//Plain C++
+	PCLK_AVX2,							//256-bit gathers (needs CPU and OS support)
+
+	PCLK_Count							//Number of kernels (must be last)
+};
+
+
+struct HEADER_BATCH
+{
+	//Files are laid out as arrays of their fields (file 'i' uses element 'i' of each)
+	const BYTE* pPages;					//First pages of all files, HDRCLS_PAGE_SIZE BYTEs each (BYTEs past the end of a smaller file must be 0)
+	const ULONG* pFileSizes;			//Sizes of all files in BYTEs (use ULONG_MAX if unknown)
+	size_t nCount;						//Number of files
+};
+
+
+struct HEADER_MASKS
+{
+	//Bit 'i' (in DWORD 'i / 32') is for file 'i' - each file is in exactly one mask
+	DWORD* pSigned;						//Files that need the full path: they have a signature, or the first page was not enough to tell
+	DWORD* pUnsigned;					//PE files without a signature (CSigRem would return XC_BinaryHasNoSignature)
+	DWORD* pNotPE;						//Files that are not PE (CSigRem would return XC_Not_PE_File)
+};
+
+
+
+class CPEClassifier
+{
+public:
+	static void Classify(const HEADER_BATCH& batch, const HEADER_MASKS& masks, PE_CLASSIFY_KERNEL kernel = PCLK_Auto);
+	static PE_CLASSIFY_KERNEL GetBestKernel();
+	static BOOL IsKernelSupported(PE_CLASSIFY_KERNEL kernel);
+	static LPCTSTR GetKernelName(PE_CLASSIFY_KERNEL kernel);
+
+protected:
+	static void classify_Scalar(const HEADER_BATCH& batch, size_t nFrom, const HEADER_MASKS& masks);
+	static size_t classify_AVX2(const HEADER_BATCH& batch, const HEADER_MASKS& masks);
+};
@@ -1,585 +1,969 @@
-//  
-//    Binary File Digital Signature Remover App
-//    "Utility to remove digital code signature from binary PE files in Windows."
-//    Copyright (c) 2021 www.dennisbabkin.com
-//    
-//        https://dennisbabkin.com/sigremover
-//
-//        https://dennisbabkin.com/blog/?i=AAA10400
-//
-//    Licensed under the Apache License, Version 2.0 (the "License");
-//    you may not use this file except in compliance with the License.
-//    You may obtain a copy of the License at
-//    
-//        https://www.apache.org/licenses/LICENSE-2.0
-//    
-//    Unless required by applicable law or agreed to in writing, software
-//    distributed under the License is distributed on an "AS IS" BASIS,
-//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
-//    See the License for the specific language governing permissions and
-//    limitations under the License.
-//  
-//
-
-
-#include "CSigRem.h"
-
-
-
-
-EXIT_CODES CSigRem::RemoveDigitalSignature(LPCTSTR pStrFilePath, LPCTSTR pStrOutputFile)
-{
-	//'pStrFilePath' = input path for PE file to remove signature from
-	//'pStrOutputFile' = if not NULL, and not L"", file path to save resulting PE file (or use file suffix on existing file)
-	EXIT_CODES nResult = XC_FailedToOpen;
-
-	//Open file for reading
-	HANDLE hFile = ::CreateFile(pStrFilePath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-	if (hFile != INVALID_HANDLE_VALUE)
-	{
-		LARGE_INTEGER liFileSz = {};
-		if (::GetFileSizeEx(hFile, &liFileSz))
-		{
-			//Make sure the file is not too large
-			if ((ULONGLONG)liFileSz.QuadPart < INT_MAX)
-			{
-				//Reserve memory for the file data
-				ULONG dwcbFileSz = (ULONG)liFileSz.QuadPart;
-				BYTE* pFileMem = new (std::nothrow) BYTE[dwcbFileSz];
-				if (pFileMem)
-				{
-					//Read data into memory
-					DWORD dwcbRead = -1;
-					if (::ReadFile(hFile, pFileMem, dwcbFileSz, &dwcbRead, NULL))
-					{
-						if (dwcbRead == dwcbFileSz)
-						{
-							int nOSErr = -1;
-							ULONG uicbNewFileSz = 0;
-							nResult = process_PE_File(pFileMem, dwcbRead, uicbNewFileSz, nOSErr);
-
-							switch (nResult)
-							{
-							case XC_Success:
-							{
-								//All good - need to save new file with data from 'pFileMem' of size 'uicbNewFileSz' bytes
-								assert((int)uicbNewFileSz > 0);
-
-#ifndef FUZZING_BUILD
-								//Assume failure
-								nResult = XC_FailedFileWrite;
-
-								WCHAR* pNewFileName = NULL;
-
-
-								//Do we need to make an output file
-								if (!pStrOutputFile ||
-									!pStrOutputFile[0])
-								{
-									//Need to generate output file name
-									pStrOutputFile = NULL;
-
-									//Set new file name
-									size_t szchLnFileName = wcslen(pStrFilePath);
-									size_t szchLnNewFileName = szchLnFileName + 1 + SIZEOF_TEXT(SUFFIX_FILE_NAME);		//Account for terminating null
-									pNewFileName = new (std::nothrow) WCHAR[szchLnNewFileName];
-									if (pNewFileName)
-									{
-										//Find extension
-										LPCTSTR pStrExt = ::PathFindExtension(pStrFilePath);
-										intptr_t nExtOffset = pStrExt - pStrFilePath;
-										assert(nExtOffset >= 0);
-
-										//Make new file name
-										HRESULT hr = ::StringCchPrintf(pNewFileName, szchLnNewFileName,
-											L"%.*s%s%s"
-											,
-											nExtOffset, pStrFilePath,
-											SUFFIX_FILE_NAME,
-											pStrFilePath + nExtOffset
-										);
-										if (SUCCEEDED(hr))
-										{
-											//Use it
-											pStrOutputFile = pNewFileName;
-										}
-										else
-										{
-											//Error
-											assert(false);
-											ReportOSError((int)hr, L"Failed to make new file name for: \"%s\"", pStrFilePath);
-										}
-
-									}
-									else
-									{
-										//Error
-										assert(false);
-										ReportOSError(ERROR_OUTOFMEMORY, L"Failed to reserve memory for new file name");
-									}
-								}
-
-
-								//Only if we have an output file
-								if (pStrOutputFile)
-								{
-									//Create new file
-									HANDLE hFile2 = ::CreateFile(pStrOutputFile, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-									if (hFile2 != INVALID_HANDLE_VALUE)
-									{
-										//Write into file
-										DWORD dwcbWrtn = 0;
-										if (::WriteFile(hFile2, pFileMem, uicbNewFileSz, &dwcbWrtn, NULL))
-										{
-											//Make sure all data has been written
-											if (dwcbWrtn == uicbNewFileSz)
-											{
-												//We are all done
-												nResult = XC_Success;
-
-												wprintf(L"SUCCESS creating new binary file without signature:\n\"%s\"\n", pStrOutputFile);
-											}
-											else
-											{
-												//Error
-												ReportOSError(4635, L"Failed to write all data to destination file: %s", pStrOutputFile);
-											}
-										}
-										else
-										{
-											//Error
-											ReportOSError(::GetLastError(), L"Failed to write to destination file: %s", pStrOutputFile);
-										}
-
-										//Close file
-										verify(::CloseHandle(hFile2));
-
-
-#ifdef _DEBUG
-										if (nResult == XC_Success)
-										{
-											//Check that checksum was calculated correctly
-											DWORD dwCheckSum1, dwCheckSum2;
-											DWORD dwResChecksum = MapFileAndCheckSum(pStrOutputFile, &dwCheckSum1, &dwCheckSum2);
-											assert(dwResChecksum == CHECKSUM_SUCCESS);
-											assert(dwCheckSum1 == dwCheckSum2);
-										}
-#endif
-									}
-									else
-									{
-										//Error
-										ReportOSError(::GetLastError(), L"Failed to create destination file: %s", pStrOutputFile);
-									}
-								}
-
-
-								//Free mem
-								if (pNewFileName)
-								{
-									//Free mem
-									delete[] pNewFileName;
-									pNewFileName = NULL;
-								}
-#endif
-
-							}
-							break;
-
-							case XC_BinaryHasNoSignature:
-								wprintf(L"Binary file has no digital signature: %s\n", pStrFilePath);
-								break;
-
-							case XC_BadSignature:
-								ReportOSError(nOSErr, L"Specified file has incompatible digital signature: %s", pStrFilePath);
-								break;
-
-							case XC_FailedChecksum:
-								ReportOSError(nOSErr, L"Failed to compute a checksum on the new file: %s", pStrFilePath);
-								break;
-
-							case XC_Not_PE_File:
-								ReportOSError(nOSErr, L"Specified file is not a valid PE binary: %s", pStrFilePath);
-								break;
-
-							default:
-								assert(nResult == XC_FailedToOpen);
-								ReportOSError(nOSErr, L"Failed to process specified binary file: %s", pStrFilePath);
-								break;
-							}
-						}
-						else
-							ReportOSError(707, L"Didn't read all file data: %s", pStrFilePath);
-					}
-					else
-						ReportOSError(::GetLastError(), L"Failed to read data from file: %s", pStrFilePath);
-
-					//Free mem
-					delete[] pFileMem;
-					pFileMem = NULL;
-				}
-				else
-					ReportOSError(ERROR_OUTOFMEMORY, L"Failed to reserve memory to read file: %s", pStrFilePath);
-			}
-			else
-				ReportOSError(8312, L"File is too large: %s", pStrFilePath);
-		}
-		else
-			ReportOSError(::GetLastError(), L"Failed to get file size: %s", pStrFilePath);
-
-		//Close handle
-		verify(::CloseHandle(hFile));
-	}
-	else
-	{
-		//Error
-		ReportOSError(::GetLastError(), L"Failed to open binary file: %s", pStrFilePath);
-	}
-
-	return nResult;
-}
-
-
-void CSigRem::ReportOSError(int nOSError, LPCTSTR pStrFmt, ...)
-{
-	//Pick the right format for the error code
-	WCHAR buffErrCode[32];
-	buffErrCode[0] = 0;
-	if ((UINT)nOSError & 0xC0000000)
-	{
-		//Hex
-		verify(SUCCEEDED(::StringCchPrintf(buffErrCode, _countof(buffErrCode), L"0x%X", nOSError)));
-	}
-	else
-	{
-		//Unsigned int
-		verify(SUCCEEDED(::StringCchPrintf(buffErrCode, _countof(buffErrCode), L"%u", nOSError)));
-	}
-
-	buffErrCode[_countof(buffErrCode) - 1] = 0;
-
-	//Format error message
-	WCHAR buffError[1024];
-	buffError[0] = 0;
-	getFormattedErrorMsg(nOSError, buffError, _countof(buffError));
-
-	//Do we have a user message?
-	if (pStrFmt &&
-		pStrFmt[0])
-	{
-		//We have a user message
-		va_list argList;
-		va_start(argList, pStrFmt);
-
-		//Get length
-		int nLnBuff = _vscwprintf(pStrFmt, argList);
-
-		//Reserve a buffer
-		WCHAR* pBuff = new (std::nothrow) WCHAR[nLnBuff + 1];
-		if (pBuff)
-		{
-			//Do formatting
-			vswprintf_s(pBuff, nLnBuff + 1, pStrFmt, argList);
-			pBuff[nLnBuff] = 0;
-
-			wprintf(L"%s\n"
-				L"ERROR: (%s) %s\n"
-				, 
-				pBuff, 
-				buffErrCode, 
-				buffError);
-
-			//Free mem
-			delete[] pBuff;
-			pBuff = NULL;
-		}
-		else
-			assert(false);
-
-		va_end(argList);
-	}
-	else
-	{
-		//No user message
-		wprintf(L"ERROR: (%s) %s\n", buffErrCode, buffError);
-	}
-
-	//Restore last error
-	::SetLastError(nOSError);
-}
-
-
-const WCHAR* CSigRem::getFormattedErrorMsg(int nOSError, WCHAR* pBuffer, size_t szchBuffer)
-{
-	//'pBuffer' = buffer to fill in with error description
-	//'szchBuffer' = size of 'pBuffer' in WCHARs
-	//RETURN:
-	//		= Pointer to 'pBuffer' (always NULL-terminated)
-	int nPrev_OSError = ::GetLastError();
-
-	if (szchBuffer)
-	{
-		if (nOSError)
-		{
-			LPVOID lpMsgBuf = NULL;
-			DWORD dwRes;
-
-			pBuffer[0] = 0;
-
-			dwRes = FormatMessage(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
-				NULL,
-				nOSError,
-				MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
-				(LPTSTR)&lpMsgBuf, 0, NULL);
-
-			if (lpMsgBuf)
-			{
-				verify(SUCCEEDED(::StringCchCopy(pBuffer, szchBuffer, (LPCTSTR)lpMsgBuf)));
-				::LocalFree(lpMsgBuf);
-				lpMsgBuf = NULL;
-			}
-
-			//Safety null
-			pBuffer[szchBuffer - 1] = 0;
-
-			//Remove all \n and \r chars
-			for (WCHAR* pS = pBuffer; ; pS++)
-			{
-				WCHAR z = *pS;
-				if (!z)
-					break;
-
-				if (z == L'\n' || z == L'\r')
-					*pS = L' ';
-			}
-		}
-		else
-		{
-			//No errors
-			pBuffer[0] = 0;
-		}
-	}
-	else
-		assert(false);
-
-	::SetLastError(nPrev_OSError);
-	return pBuffer;
-}
-
-
-EXIT_CODES CSigRem::process_PE_File(BYTE* pBaseAddr, ULONG szcbMem, ULONG& uicbNewFileSz, int& nOSErr)
-{
-	//'pBaseAddr' = pointer to the beginning of the PE file (it should not be mapped!)
-	//'szcbMem' = size of 'pBaseAddr' in BYTEs
-	//'uicbNewFileSz' = receives new file size in BYTEs after signature has been removed (valid only if result is XC_Success)
-	//'nOSErr' = receives OS error code, if any
-	BYTE* pEndAddr = pBaseAddr + szcbMem;
-
-	if ((LONG)szcbMem < sizeof(IMAGE_DOS_HEADER))
-	{
-		//Error
-		nOSErr = ERROR_BAD_EXE_FORMAT;
-		return XC_Not_PE_File;
-	}
-
-	//Define DOS header
-	IMAGE_DOS_HEADER* pDosHdr = (IMAGE_DOS_HEADER*)pBaseAddr;
-	size_t szcbNtHdr = (ULONG)pDosHdr->e_lfanew + sizeof(IMAGE_NT_HEADERS64);		//Assume the worst case (or 64-bit)
-
-	if (szcbNtHdr > szcbMem)
-	{
-		//Error
-		nOSErr = ERROR_BAD_EXE_FORMAT;
-		return XC_Not_PE_File;
-	}
-
-	//Define NT headers
-	IMAGE_NT_HEADERS* pNtHdr = (IMAGE_NT_HEADERS*)(pBaseAddr + (ULONG)pDosHdr->e_lfanew);
-	if (pNtHdr->Signature != IMAGE_NT_SIGNATURE)
-	{
-#ifndef FUZZING_BUILD
-		//Error
-		nOSErr = ERROR_BAD_EXE_FORMAT;
-		return XC_Not_PE_File;
-#endif
-	}
-
-	//Get to sections
-	IMAGE_SECTION_HEADER* pSections = (IMAGE_SECTION_HEADER*)(IMAGE_FIRST_SECTION(pNtHdr));
-	if (CHECK_PTR_4_OVERRUN(pSections, pEndAddr))
-	{
-		//Error
-		nOSErr = ERROR_BAD_EXE_FORMAT;
-		return XC_Not_PE_File;
-	}
-
-
-	//Determine bitness and get some other info from the headers
-	IMAGE_NT_HEADERS32* pNtHdr32 = NULL;
-	IMAGE_NT_HEADERS64* pNtHdr64 = NULL;
-	IMAGE_DATA_DIRECTORY* pDataDirectories = NULL;
-	DWORD* pdwChecksum = NULL;
-
-	switch (pNtHdr->OptionalHeader.Magic)
-	{
-		case IMAGE_NT_OPTIONAL_HDR32_MAGIC:
-		{
-			//32-bit
-			pNtHdr32 = (IMAGE_NT_HEADERS32*)pNtHdr;
-			IMAGE_OPTIONAL_HEADER32* pIOH32 = &pNtHdr32->OptionalHeader;
-			if (CHECK_PTR_4_OVERRUN(pIOH32, pEndAddr))
-			{
-				//Error
-				nOSErr = ERROR_BAD_EXE_FORMAT;
-				return XC_Not_PE_File;
-			}
-
-			pDataDirectories = pIOH32->DataDirectory;
-			pdwChecksum = &pIOH32->CheckSum;
-		}
-		break;
-
-		case IMAGE_NT_OPTIONAL_HDR64_MAGIC:
-		{
-			//64-bit
-			pNtHdr64 = (IMAGE_NT_HEADERS64*)pNtHdr;
-			IMAGE_OPTIONAL_HEADER64* pIOH64 = &pNtHdr64->OptionalHeader;
-			if (CHECK_PTR_4_OVERRUN(pIOH64, pEndAddr))
-			{
-				//Error
-				nOSErr = ERROR_BAD_EXE_FORMAT;
-				return XC_Not_PE_File;
-			}
-
-			pDataDirectories = pIOH64->DataDirectory;
-			pdwChecksum = &pIOH64->CheckSum;
-		}
-		break;
-
-		default:
-		{
-			//Error
-			nOSErr = ERROR_BAD_EXE_FORMAT;
-			return XC_Not_PE_File;
-		}
-	}
-
-
-	assert(pDataDirectories);
-	assert(pdwChecksum);
-
-
-	//We need to examine IMAGE_DIRECTORY_ENTRY_SECURITY
-	IMAGE_DATA_DIRECTORY* pID = &pDataDirectories[IMAGE_DIRECTORY_ENTRY_SECURITY];
-	if (CHECK_PTR_4_OVERRUN(pID, pEndAddr))
-	{
-		//Error
-		nOSErr = ERROR_BAD_EXE_FORMAT;
-		return XC_Not_PE_File;
-	}
-
-
-	//See if we have any signature?
-	if (!pID->Size &&
-		!pID->VirtualAddress)
-	{
-		//No signature
-		return XC_BinaryHasNoSignature;
-	}
-
-
-	//We will assume that the signature is always at the end of the binary file
-	if (pID->VirtualAddress + pID->Size != szcbMem)
-	{
-		//Signature is not at the end of file
-		nOSErr = 1466;
-		return XC_BadSignature;
-	}
-
-
-
-	//Now start modifying the binary
-	////////////////////////////////////////////////
-
-	//Set new file size
-	uicbNewFileSz = pID->VirtualAddress;
-
-	//Remove digital signature from the PE header directory
-	pID->Size = 0;
-	pID->VirtualAddress = 0;
-
-	//Update file checksum
-	DWORD dwOrigCheckSum = 0, dwNewCheckSum = 0;
-	PIMAGE_NT_HEADERS pIH = CheckSumMappedFile(pBaseAddr, uicbNewFileSz, &dwOrigCheckSum, &dwNewCheckSum);
-	if (!pIH)
-	{
-		//Failed to compute new checksum
-		nOSErr = ::GetLastError();
-		return XC_FailedChecksum;
-	}
-
-	//Set new checksum in memory
-	assert(pdwChecksum);
-	*pdwChecksum = dwNewCheckSum;
-
-	return XC_Success;
-}
-
-
-BOOL CSigRem::IsCmdLineParam(LPCTSTR pCmd, LPCTSTR pToCheck)
-{
-	//RETURN:
-	//		= TRUE if 'pToCheck' is 'pCmd' command line parameter (case insensitive)
-
-	if (pCmd &&
-		pCmd[0] &&
-		pToCheck &&
-		pToCheck[0])
-	{
-		//Command must start with a letter only
-		assert((pToCheck[0] >= 'a' && pToCheck[0] <= 'z') || (pToCheck[0] >= 'A' && pToCheck[0] <= 'Z') || pToCheck[0] == '?');
-
-		WCHAR z = pCmd[0];
-		if (z == '-' ||
-			z == '/' ||
-			z == '\\')
-		{
-			return ::CompareString(LOCALE_USER_DEFAULT, NORM_IGNORECASE, pCmd + 1, -1, pToCheck, -1) == CSTR_EQUAL;
-		}
-	}
-
-	return FALSE;
-}
-
-
-void CSigRem::ShowHelpInfo()
-{
-	//Show help info to the console
-
-	//Get current exe file name (without extension)
-	WCHAR buffThis[MAX_PATH] = {};
-	::GetModuleFileName(NULL, buffThis, _countof(buffThis));
-	*::PathFindExtension(buffThis) = 0;
-	LPCTSTR pThisFile = ::PathFindFileName(buffThis);
-
-	wprintf(
-		L"%s -i <File> [-o <File>]\n"
-		L"\n"
-		L"where:\n"
-		L" -i  = specifies PE file to remove signature from:\n"
-		L"        <File> = File path to read PE binary.\n"
-		L" -o  = [optional] specifies destination PE file:\n"
-		L"        If omitted, the new file name will have%s suffix in the same folder.\n"
-		L"        <File> = File path to create new PE binary.\n"
-		L"\n"
-		L"Examples:\n"
-		L" %s -i \"path-to\\file.exe\"\n"
-		L" %s -i \"path-to\\file.exe\" -o \"path-to\\result.exe\"\n"
-		L"\n"
-		,
-		pThisFile,
-		SUFFIX_FILE_NAME,
-		pThisFile,
-		pThisFile
-	);
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+#include "CSigRem.h"
+#include "CBuffPool.h"
+
+
+
+
+EXIT_CODES CSigRem::RemoveDigitalSignature(LPCTSTR pStrFilePath, LPCTSTR pStrOutputFile, SIGREM_RESULTS* pOutResults, const SIGREM_PARAMS* pParams)
+{
+	//'pStrFilePath' = input path for PE file to remove signature from
+	//'pStrOutputFile' = if not NULL, and not L"", file path to save resulting PE file (or use file suffix on existing file)
+	//'pOutResults' = if not NULL, receives file sizes for the operation
+	//'pParams' = if not NULL, optional parameters for the operation
+	EXIT_CODES nResult = XC_FailedToOpen;
+
+	if (pOutResults)
+	{
+		pOutResults->uicbInputSz = 0;
+		pOutResults->uicbOutputSz = 0;
+	}
+
+	SIGREM_PARAMS params = {};
+	if (pParams)
+		params = *pParams;
+
+	//Open file for reading (the way the I/O policy wants it)
+	HANDLE hFile = ::CreateFile(pStrFilePath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | GetIoPolicyFileFlags(params.ioPolicy), NULL);
+	if (hFile != INVALID_HANDLE_VALUE)
+	{
+		//Process it
+		params.dwFlags |= SRF_HANDLE_HAS_IO_POLICY;
+		nResult = RemoveDigitalSignatureFromHandle(hFile, pStrFilePath, pStrOutputFile, pOutResults, &params);
+
+		//Close handle
+		verify(::CloseHandle(hFile));
+	}
+	else
+	{
+		//Error
+		ReportOSError(::GetLastError(), L"Failed to open binary file: %s", pStrFilePath);
+	}
+
+	return nResult;
+}
+
+
+EXIT_CODES CSigRem::RemoveDigitalSignatureFromHandle(HANDLE hFile, LPCTSTR pStrFilePath, LPCTSTR pStrOutputFile, SIGREM_RESULTS* pOutResults, const SIGREM_PARAMS* pParams)
+{
+	//'hFile' = handle of the PE file to remove signature from (it must be opened for reading, its file pointer will be moved)
+	//'pStrFilePath' = input path of 'hFile' (used to make the output file name and for error messages)
+	//'pStrOutputFile' = if not NULL, and not L"", file path to save resulting PE file (or use file suffix on existing file)
+	//'pOutResults' = if not NULL, receives file sizes for the operation
+	//'pParams' = if not NULL, optional parameters for the operation
+	CBuffPool* pBuffPool = pParams ? pParams->pBuffPool : NULL;
+	DWORD dwFlags = pParams ? pParams->dwFlags : 0;
+	SIGREM_IO_POLICY ioPolicy = pParams ? pParams->ioPolicy : SIP_Buffered;
+
+	if (pOutResults)
+	{
+		pOutResults->uicbInputSz = 0;
+		pOutResults->uicbOutputSz = 0;
+	}
+
+	BOOL bUnbufferedRead = ioPolicy == SIP_Direct;
+	HANDLE hFileReopened = INVALID_HANDLE_VALUE;
+
+	if (ioPolicy != SIP_Buffered &&
+		!(dwFlags & SRF_HANDLE_HAS_IO_POLICY))
+	{
+		//Get another handle to the same file that follows the I/O policy
+		hFileReopened = ::ReOpenFile(hFile, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, GetIoPolicyFileFlags(ioPolicy));
+		if (hFileReopened != INVALID_HANDLE_VALUE)
+		{
+			hFile = hFileReopened;
+		}
+		else
+		{
+			//Can't do it with this handle - read it with buffered I/O then
+			bUnbufferedRead = FALSE;
+		}
+	}
+
+	EXIT_CODES nResult = process_File(hFile, pStrFilePath, pStrOutputFile, pOutResults, pBuffPool, dwFlags, ioPolicy, bUnbufferedRead);
+
+	if (hFileReopened != INVALID_HANDLE_VALUE)
+	{
+		verify(::CloseHandle(hFileReopened));
+		hFileReopened = INVALID_HANDLE_VALUE;
+	}
+
+	return nResult;
+}
+
+
+EXIT_CODES CSigRem::process_File(HANDLE hFile, LPCTSTR pStrFilePath, LPCTSTR pStrOutputFile, SIGREM_RESULTS* pOutResults,
+	CBuffPool* pBuffPool, DWORD dwFlags, SIGREM_IO_POLICY ioPolicy, BOOL bUnbufferedRead)
+{
+	//Read PE file from 'hFile', remove its signature and write the result into a new file
+	//'bUnbufferedRead' = TRUE if 'hFile' was opened with FILE_FLAG_NO_BUFFERING
+	//INFO: See RemoveDigitalSignatureFromHandle() for other parameters
+	EXIT_CODES nResult = XC_FailedToOpen;
+
+	//Read from the beginning of the file
+	LARGE_INTEGER liPos = {};
+	if (!::SetFilePointerEx(hFile, liPos, NULL, FILE_BEGIN))
+	{
+		//Error
+		ReportOSError(::GetLastError(), L"Failed to set position in file: %s", pStrFilePath);
+		return nResult;
+	}
+
+	LARGE_INTEGER liFileSz = {};
+	if (::GetFileSizeEx(hFile, &liFileSz))
+	{
+		if (pOutResults)
+			pOutResults->uicbInputSz = (ULONGLONG)liFileSz.QuadPart;
+
+		//Make sure the file is not too large
+		if ((ULONGLONG)liFileSz.QuadPart < INT_MAX)
+		{
+			//Reserve memory for the file data
+			//INFO: Unbuffered I/O needs page-aligned memory, and it reads and writes whole sectors, so round the size up
+			ULONG dwcbFileSz = (ULONG)liFileSz.QuadPart;
+			BOOL bAligned = bUnbufferedRead || ioPolicy == SIP_Direct;
+			ULONG dwcbBuffSz = bAligned ? ALIGN_UP(dwcbFileSz ? dwcbFileSz : 1, SIGREM_DIRECT_IO_ALIGN) : dwcbFileSz;
+
+			BYTE* pFileMem;
+			if (pBuffPool)
+				pFileMem = pBuffPool->Get(dwcbBuffSz);
+			else if (bAligned)
+				pFileMem = (BYTE*)::VirtualAlloc(NULL, dwcbBuffSz, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+			else
+				pFileMem = new (std::nothrow) BYTE[dwcbBuffSz];
+
+			if (pFileMem)
+			{
+				assert(!bAligned || ((ULONG_PTR)pFileMem & (SIGREM_DIRECT_IO_ALIGN - 1)) == 0);
+
+				//Read data into memory (unbuffered read of the whole last sector stops at the end of the file)
+				DWORD dwcbRead = -1;
+				if (::ReadFile(hFile, pFileMem, bUnbufferedRead ? dwcbBuffSz : dwcbFileSz, &dwcbRead, NULL))
+				{
+					if (dwcbRead == dwcbFileSz)
+					{
+						int nOSErr = -1;
+						ULONG uicbNewFileSz = 0;
+						nResult = process_PE_File(pFileMem, dwcbRead, uicbNewFileSz, nOSErr);
+
+						switch (nResult)
+						{
+						case XC_Success:
+						{
+							//All good - need to save new file with data from 'pFileMem' of size 'uicbNewFileSz' bytes
+							assert((int)uicbNewFileSz > 0);
+
+#ifndef FUZZING_BUILD
+							//Assume failure
+							nResult = XC_FailedFileWrite;
+
+							WCHAR* pNewFileName = NULL;
+
+
+							//Do we need to make an output file
+							if (!pStrOutputFile ||
+								!pStrOutputFile[0])
+							{
+								//Need to generate output file name
+								pNewFileName = MakeOutputFileName(pStrFilePath);
+								pStrOutputFile = pNewFileName;
+							}
+
+
+							//Only if we have an output file
+							if (pStrOutputFile)
+							{
+								//Create new file (remove the existing one first, and don't write through it - it may be
+								//a hard link that batch mode made for a duplicate input, and other outputs share its data)
+								HANDLE hFile2 = INVALID_HANDLE_VALUE;
+								if (::DeleteFile(pStrOutputFile) ||
+									::GetLastError() == ERROR_FILE_NOT_FOUND)
+								{
+									hFile2 = ::CreateFile(pStrOutputFile, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+										FILE_ATTRIBUTE_NORMAL | GetIoPolicyFileFlags(ioPolicy), NULL);
+								}
+
+								if (hFile2 != INVALID_HANDLE_VALUE)
+								{
+									//Unbuffered write must be in whole sectors, so pad the last one with zeros (and cut it off below)
+									DWORD dwcbToWrite = uicbNewFileSz;
+									if (ioPolicy == SIP_Direct)
+									{
+										dwcbToWrite = ALIGN_UP(uicbNewFileSz, SIGREM_DIRECT_IO_ALIGN);
+										assert(dwcbToWrite <= dwcbBuffSz);
+
+										memset(pFileMem + uicbNewFileSz, 0, dwcbToWrite - uicbNewFileSz);
+									}
+
+									//Write into file
+									DWORD dwcbWrtn = 0;
+									if (::WriteFile(hFile2, pFileMem, dwcbToWrite, &dwcbWrtn, NULL))
+									{
+										//Make sure all data has been written
+										if (dwcbWrtn == dwcbToWrite)
+										{
+											LARGE_INTEGER liNewFileSz;
+											liNewFileSz.QuadPart = uicbNewFileSz;
+
+											if (dwcbToWrite == uicbNewFileSz ||
+												(::SetFilePointerEx(hFile2, liNewFileSz, NULL, FILE_BEGIN) &&
+												::SetEndOfFile(hFile2)))
+											{
+												//We are all done
+												nResult = XC_Success;
+
+												if (pOutResults)
+													pOutResults->uicbOutputSz = uicbNewFileSz;
+
+												if (!(dwFlags & SRF_QUIET_SUCCESS))
+													wprintf(L"SUCCESS creating new binary file without signature:\n\"%s\"\n", pStrOutputFile);
+											}
+											else
+											{
+												//Error
+												ReportOSError(::GetLastError(), L"Failed to set size of destination file: %s", pStrOutputFile);
+											}
+										}
+										else
+										{
+											//Error
+											ReportOSError(4635, L"Failed to write all data to destination file: %s", pStrOutputFile);
+										}
+									}
+									else
+									{
+										//Error
+										ReportOSError(::GetLastError(), L"Failed to write to destination file: %s", pStrOutputFile);
+									}
+
+									//Close file
+									verify(::CloseHandle(hFile2));
+
+
+#ifdef _DEBUG
+									if (nResult == XC_Success)
+									{
+										//Check that checksum was calculated correctly
+										DWORD dwCheckSum1, dwCheckSum2;
+										DWORD dwResChecksum = MapFileAndCheckSum(pStrOutputFile, &dwCheckSum1, &dwCheckSum2);
+										assert(dwResChecksum == CHECKSUM_SUCCESS);
+										assert(dwCheckSum1 == dwCheckSum2);
+									}
+#endif
+								}
+								else
+								{
+									//Error
+									ReportOSError(::GetLastError(), L"Failed to create destination file: %s", pStrOutputFile);
+								}
+							}
+
+
+							//Free mem
+							if (pNewFileName)
+							{
+								//Free mem
+								delete[] pNewFileName;
+								pNewFileName = NULL;
+							}
+#endif
+
+						}
+						break;
+
+						case XC_BinaryHasNoSignature:
+							if (!(dwFlags & SRF_QUIET_SKIPPED))
+								wprintf(L"Binary file has no digital signature: %s\n", pStrFilePath);
+							break;
+
+						case XC_BadSignature:
+							ReportOSError(nOSErr, L"Specified file has incompatible digital signature: %s", pStrFilePath);
+							break;
+
+						case XC_FailedChecksum:
+							ReportOSError(nOSErr, L"Failed to compute a checksum on the new file: %s", pStrFilePath);
+							break;
+
+						case XC_Not_PE_File:
+							if (!(dwFlags & SRF_QUIET_SKIPPED))
+								ReportOSError(nOSErr, L"Specified file is not a valid PE binary: %s", pStrFilePath);
+							break;
+
+						default:
+							assert(nResult == XC_FailedToOpen);
+							ReportOSError(nOSErr, L"Failed to process specified binary file: %s", pStrFilePath);
+							break;
+						}
+					}
+					else
+						ReportOSError(707, L"Didn't read all file data: %s", pStrFilePath);
+				}
+				else
+					ReportOSError(::GetLastError(), L"Failed to read data from file: %s", pStrFilePath);
+
+				//Free mem
+				if (pBuffPool)
+					pBuffPool->Release(pFileMem);
+				else if (bAligned)
+					verify(::VirtualFree(pFileMem, 0, MEM_RELEASE));
+				else
+					delete[] pFileMem;
+
+				pFileMem = NULL;
+			}
+			else
+				ReportOSError(ERROR_OUTOFMEMORY, L"Failed to reserve memory to read file: %s", pStrFilePath);
+		}
+		else
+			ReportOSError(8312, L"File is too large: %s", pStrFilePath);
+	}
+	else
+		ReportOSError(::GetLastError(), L"Failed to get file size: %s", pStrFilePath);
+
+	return nResult;
+}
+
+
+EXIT_CODES CSigRem::RemoveDigitalSignatureFromMemory(BYTE* pFileMem, ULONG szcbFileMem, ULONG& uicbNewFileSz, int& nOSErr)
+{
+	//Remove digital signature from a PE file that was read into memory (nothing is reported to the console)
+	//'pFileMem' = contents of the PE file - it will be modified (it should not be mapped!)
+	//'szcbFileMem' = size of 'pFileMem' in BYTEs
+	//'uicbNewFileSz' = receives new file size in BYTEs - the new file is the first 'uicbNewFileSz' BYTEs of 'pFileMem' (valid only if result is XC_Success)
+	//'nOSErr' = receives OS error code, if any
+	//RETURN:
+	//		= Result of the operation
+	return process_PE_File(pFileMem, szcbFileMem, uicbNewFileSz, nOSErr);
+}
+
+
+WCHAR* CSigRem::MakeOutputFileName(LPCTSTR pStrFilePath)
+{
+	//Make output file name by adding SUFFIX_FILE_NAME to 'pStrFilePath' (before its extension)
+	//RETURN:
+	//		= New file path - must be released with delete[]
+	//		= NULL if error (it will be reported)
+	WCHAR* pNewFileName = NULL;
+
+	size_t szchLnFileName = wcslen(pStrFilePath);
+	size_t szchLnNewFileName = szchLnFileName + 1 + SIZEOF_TEXT(SUFFIX_FILE_NAME);		//Account for terminating null
+	pNewFileName = new (std::nothrow) WCHAR[szchLnNewFileName];
+	if (pNewFileName)
+	{
+		//Find extension
+		LPCTSTR pStrExt = ::PathFindExtension(pStrFilePath);
+		intptr_t nExtOffset = pStrExt - pStrFilePath;
+		assert(nExtOffset >= 0);
+
+		//Make new file name
+		HRESULT hr = ::StringCchPrintf(pNewFileName, szchLnNewFileName,
+			L"%.*s%s%s"
+			,
+			nExtOffset, pStrFilePath,
+			SUFFIX_FILE_NAME,
+			pStrFilePath + nExtOffset
+		);
+		if (FAILED(hr))
+		{
+			//Error
+			assert(false);
+			ReportOSError((int)hr, L"Failed to make new file name for: \"%s\"", pStrFilePath);
+
+			delete[] pNewFileName;
+			pNewFileName = NULL;
+		}
+	}
+	else
+	{
+		//Error
+		assert(false);
+		ReportOSError(ERROR_OUTOFMEMORY, L"Failed to reserve memory for new file name");
+	}
+
+	return pNewFileName;
+}
+
+
+void CSigRem::ReportOSError(int nOSError, LPCTSTR pStrFmt, ...)
+{
+	//Pick the right format for the error code
+	WCHAR buffErrCode[32];
+	buffErrCode[0] = 0;
+	if ((UINT)nOSError & 0xC0000000)
+	{
+		//Hex
+		verify(SUCCEEDED(::StringCchPrintf(buffErrCode, _countof(buffErrCode), L"0x%X", nOSError)));
+	}
+	else
+	{
+		//Unsigned int
+		verify(SUCCEEDED(::StringCchPrintf(buffErrCode, _countof(buffErrCode), L"%u", nOSError)));
+	}
+
+	buffErrCode[_countof(buffErrCode) - 1] = 0;
+
+	//Format error message
+	WCHAR buffError[1024];
+	buffError[0] = 0;
+	getFormattedErrorMsg(nOSError, buffError, _countof(buffError));
+
+	//Do we have a user message?
+	if (pStrFmt &&
+		pStrFmt[0])
+	{
+		//We have a user message
+		va_list argList;
+		va_start(argList, pStrFmt);
+
+		//Get length
+		int nLnBuff = _vscwprintf(pStrFmt, argList);
+
+		//Reserve a buffer
+		WCHAR* pBuff = new (std::nothrow) WCHAR[nLnBuff + 1];
+		if (pBuff)
+		{
+			//Do formatting
+			vswprintf_s(pBuff, nLnBuff + 1, pStrFmt, argList);
+			pBuff[nLnBuff] = 0;
+
+			wprintf(L"%s\n"
+				L"ERROR: (%s) %s\n"
+				, 
+				pBuff, 
+				buffErrCode, 
+				buffError);
+
+			//Free mem
+			delete[] pBuff;
+			pBuff = NULL;
+		}
+		else
+			assert(false);
+
+		va_end(argList);
+	}
+	else
+	{
+		//No user message
+		wprintf(L"ERROR: (%s) %s\n", buffErrCode, buffError);
+	}
+
+	//Restore last error
+	::SetLastError(nOSError);
+}
+
+
+const WCHAR* CSigRem::getFormattedErrorMsg(int nOSError, WCHAR* pBuffer, size_t szchBuffer)
+{
+	//'pBuffer' = buffer to fill in with error description
+	//'szchBuffer' = size of 'pBuffer' in WCHARs
+	//RETURN:
+	//		= Pointer to 'pBuffer' (always NULL-terminated)
+	int nPrev_OSError = ::GetLastError();
+
+	if (szchBuffer)
+	{
+		if (nOSError)
+		{
+			LPVOID lpMsgBuf = NULL;
+			DWORD dwRes;
+
+			pBuffer[0] = 0;
+
+			dwRes = FormatMessage(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
+				NULL,
+				nOSError,
+				MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
+				(LPTSTR)&lpMsgBuf, 0, NULL);
+
+			if (lpMsgBuf)
+			{
+				verify(SUCCEEDED(::StringCchCopy(pBuffer, szchBuffer, (LPCTSTR)lpMsgBuf)));
+				::LocalFree(lpMsgBuf);
+				lpMsgBuf = NULL;
+			}
+
+			//Safety null
+			pBuffer[szchBuffer - 1] = 0;
+
+			//Remove all \n and \r chars
+			for (WCHAR* pS = pBuffer; ; pS++)
+			{
+				WCHAR z = *pS;
+				if (!z)
+					break;
+
+				if (z == L'\n' || z == L'\r')
+					*pS = L' ';
+			}
+		}
+		else
+		{
+			//No errors
+			pBuffer[0] = 0;
+		}
+	}
+	else
+		assert(false);
+
+	::SetLastError(nPrev_OSError);
+	return pBuffer;
+}
+
+
+EXIT_CODES CSigRem::parse_PE_Headers(BYTE* pBaseAddr, ULONG szcbMem, PE_HEADERS_INFO& info, int& nOSErr)
+{
+	//Parse and validate PE headers (does not modify them)
+	//'pBaseAddr' = pointer to the beginning of the PE file, or to its first bytes that include all PE headers (it should not be mapped!)
+	//'szcbMem' = size of 'pBaseAddr' in BYTEs
+	//'info' = receives pointers into 'pBaseAddr' for the parsed headers (valid only if result is XC_Success)
+	//'nOSErr' = receives OS error code, if any
+	//RETURN:
+	//		= XC_Success if headers are valid
+	//		= XC_Not_PE_File if not a PE file, or if 'szcbMem' is too small to contain all headers
+	BYTE* pEndAddr = pBaseAddr + szcbMem;
+
+	if ((LONG)szcbMem < sizeof(IMAGE_DOS_HEADER))
+	{
+		//Error
+		nOSErr = ERROR_BAD_EXE_FORMAT;
+		return XC_Not_PE_File;
+	}
+
+	//Define DOS header
+	IMAGE_DOS_HEADER* pDosHdr = (IMAGE_DOS_HEADER*)pBaseAddr;
+	size_t szcbNtHdr = (ULONG)pDosHdr->e_lfanew + sizeof(IMAGE_NT_HEADERS64);		//Assume the worst case (or 64-bit)
+
+	if (szcbNtHdr > szcbMem)
+	{
+		//Error
+		nOSErr = ERROR_BAD_EXE_FORMAT;
+		return XC_Not_PE_File;
+	}
+
+	//Define NT headers
+	IMAGE_NT_HEADERS* pNtHdr = (IMAGE_NT_HEADERS*)(pBaseAddr + (ULONG)pDosHdr->e_lfanew);
+	if (pNtHdr->Signature != IMAGE_NT_SIGNATURE)
+	{
+#ifndef FUZZING_BUILD
+		//Error
+		nOSErr = ERROR_BAD_EXE_FORMAT;
+		return XC_Not_PE_File;
+#endif
+	}
+
+	//Get to sections
+	IMAGE_SECTION_HEADER* pSections = (IMAGE_SECTION_HEADER*)(IMAGE_FIRST_SECTION(pNtHdr));
+	if (CHECK_PTR_4_OVERRUN(pSections, pEndAddr))
+	{
+		//Error
+		nOSErr = ERROR_BAD_EXE_FORMAT;
+		return XC_Not_PE_File;
+	}
+
+
+	//Determine bitness and get some other info from the headers
+	IMAGE_NT_HEADERS32* pNtHdr32 = NULL;
+	IMAGE_NT_HEADERS64* pNtHdr64 = NULL;
+	IMAGE_DATA_DIRECTORY* pDataDirectories = NULL;
+	DWORD* pdwChecksum = NULL;
+
+	switch (pNtHdr->OptionalHeader.Magic)
+	{
+		case IMAGE_NT_OPTIONAL_HDR32_MAGIC:
+		{
+			//32-bit
+			pNtHdr32 = (IMAGE_NT_HEADERS32*)pNtHdr;
+			IMAGE_OPTIONAL_HEADER32* pIOH32 = &pNtHdr32->OptionalHeader;
+			if (CHECK_PTR_4_OVERRUN(pIOH32, pEndAddr))
+			{
+				//Error
+				nOSErr = ERROR_BAD_EXE_FORMAT;
+				return XC_Not_PE_File;
+			}
+
+			pDataDirectories = pIOH32->DataDirectory;
+			pdwChecksum = &pIOH32->CheckSum;
+		}
+		break;
+
+		case IMAGE_NT_OPTIONAL_HDR64_MAGIC:
+		{
+			//64-bit
+			pNtHdr64 = (IMAGE_NT_HEADERS64*)pNtHdr;
+			IMAGE_OPTIONAL_HEADER64* pIOH64 = &pNtHdr64->OptionalHeader;
+			if (CHECK_PTR_4_OVERRUN(pIOH64, pEndAddr))
+			{
+				//Error
+				nOSErr = ERROR_BAD_EXE_FORMAT;
+				return XC_Not_PE_File;
+			}
+
+			pDataDirectories = pIOH64->DataDirectory;
+			pdwChecksum = &pIOH64->CheckSum;
+		}
+		break;
+
+		default:
+		{
+			//Error
+			nOSErr = ERROR_BAD_EXE_FORMAT;
+			return XC_Not_PE_File;
+		}
+	}
+
+
+	assert(pDataDirectories);
+	assert(pdwChecksum);
+
+
+	//We need to examine IMAGE_DIRECTORY_ENTRY_SECURITY
+	IMAGE_DATA_DIRECTORY* pID = &pDataDirectories[IMAGE_DIRECTORY_ENTRY_SECURITY];
+	if (CHECK_PTR_4_OVERRUN(pID, pEndAddr))
+	{
+		//Error
+		nOSErr = ERROR_BAD_EXE_FORMAT;
+		return XC_Not_PE_File;
+	}
+
+	info.pNtHdr = pNtHdr;
+	info.pSecurityDir = pID;
+	info.pdwChecksum = pdwChecksum;
+
+	return XC_Success;
+}
+
+
+EXIT_CODES CSigRem::process_PE_File(BYTE* pBaseAddr, ULONG szcbMem, ULONG& uicbNewFileSz, int& nOSErr)
+{
+	//'pBaseAddr' = pointer to the beginning of the PE file (it should not be mapped!)
+	//'szcbMem' = size of 'pBaseAddr' in BYTEs
+	//'uicbNewFileSz' = receives new file size in BYTEs after signature has been removed (valid only if result is XC_Success)
+	//'nOSErr' = receives OS error code, if any
+	PE_HEADERS_INFO info;
+	EXIT_CODES nRes = parse_PE_Headers(pBaseAddr, szcbMem, info, nOSErr);
+	if (nRes != XC_Success)
+	{
+		//Error
+		return nRes;
+	}
+
+	IMAGE_DATA_DIRECTORY* pID = info.pSecurityDir;
+	DWORD* pdwChecksum = info.pdwChecksum;
+
+
+	//See if we have any signature?
+	if (!pID->Size &&
+		!pID->VirtualAddress)
+	{
+		//No signature
+		return XC_BinaryHasNoSignature;
+	}
+
+
+	//We will assume that the signature is always at the end of the binary file
+	if (pID->VirtualAddress + pID->Size != szcbMem)
+	{
+		//Signature is not at the end of file
+		nOSErr = 1466;
+		return XC_BadSignature;
+	}
+
+
+
+	//Now start modifying the binary
+	////////////////////////////////////////////////
+
+	//Set new file size
+	uicbNewFileSz = pID->VirtualAddress;
+
+	//Remove digital signature from the PE header directory
+	pID->Size = 0;
+	pID->VirtualAddress = 0;
+
+	//Update file checksum
+	DWORD dwOrigCheckSum = 0, dwNewCheckSum = 0;
+	PIMAGE_NT_HEADERS pIH = CheckSumMappedFile(pBaseAddr, uicbNewFileSz, &dwOrigCheckSum, &dwNewCheckSum);
+	if (!pIH)
+	{
+		//Failed to compute new checksum
+		nOSErr = ::GetLastError();
+		return XC_FailedChecksum;
+	}
+
+	//Set new checksum in memory
+	assert(pdwChecksum);
+	*pdwChecksum = dwNewCheckSum;
+
+	return XC_Success;
+}
+
+
+BOOL CSigRem::IsCmdLineParam(LPCTSTR pCmd, LPCTSTR pToCheck)
+{
+	//RETURN:
+	//		= TRUE if 'pToCheck' is 'pCmd' command line parameter (case insensitive)
+
+	if (pCmd &&
+		pCmd[0] &&
+		pToCheck &&
+		pToCheck[0])
+	{
+		//Command must start with a letter only
+		assert((pToCheck[0] >= 'a' && pToCheck[0] <= 'z') || (pToCheck[0] >= 'A' && pToCheck[0] <= 'Z') || pToCheck[0] == '?');
+
+		WCHAR z = pCmd[0];
+		if (z == '-' ||
+			z == '/' ||
+			z == '\\')
+		{
+			return ::CompareString(LOCALE_USER_DEFAULT, NORM_IGNORECASE, pCmd + 1, -1, pToCheck, -1) == CSTR_EQUAL;
+		}
+	}
+
+	return FALSE;
+}
+
+
+DWORD CSigRem::GetIoPolicyFileFlags(SIGREM_IO_POLICY ioPolicy)
+{
+	//RETURN:
+	//		= Flags for CreateFile() to open files with for the 'ioPolicy'
+	switch (ioPolicy)
+	{
+	case SIP_Sequential:
+		return FILE_FLAG_SEQUENTIAL_SCAN;
+
+	case SIP_Direct:
+		return FILE_FLAG_NO_BUFFERING;
+
+	default:
+		assert(ioPolicy == SIP_Buffered);
+		break;
+	}
+
+	return 0;
+}
+
+
+BOOL CSigRem::ParseIoPolicy(LPCTSTR pStr, SIGREM_IO_POLICY& ioPolicy)
+{
+	//'ioPolicy' = receives the I/O policy for its name in 'pStr' (case insensitive)
+	//RETURN:
+	//		= TRUE if 'pStr' is a known I/O policy name
+	for (int i = 0; i < SIP_Count; i++)
+	{
+		if (pStr &&
+			::CompareString(LOCALE_USER_DEFAULT, NORM_IGNORECASE, pStr, -1, GetIoPolicyName((SIGREM_IO_POLICY)i), -1) == CSTR_EQUAL)
+		{
+			ioPolicy = (SIGREM_IO_POLICY)i;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+
+LPCTSTR CSigRem::GetIoPolicyName(SIGREM_IO_POLICY ioPolicy)
+{
+	//RETURN:
+	//		= Name of the 'ioPolicy' as used on the command line
+	switch (ioPolicy)
+	{
+	case SIP_Buffered:
+		return L"buffered";
+	case SIP_Sequential:
+		return L"sequential";
+	case SIP_Direct:
+		return L"direct";
+	default:
+		break;
+	}
+
+	assert(false);
+	return L"";
+}
+
+
+std::wstring CSigRem::MakePipePath(LPCTSTR pStrPipeName)
+{
+	//RETURN:
+	//		= Full pipe path for 'pStrPipeName' (adds SIGREM_PIPE_PREFIX if it's just a name)
+	if (pStrPipeName[0] == L'\\' &&
+		pStrPipeName[1] == L'\\')
+	{
+		return pStrPipeName;
+	}
+
+	return std::wstring(SIGREM_PIPE_PREFIX) + pStrPipeName;
+}
+
+
+BOOL CSigRem::ParseCmdLineNumber(LPCTSTR pStr, DWORD& dwOutValue)
+{
+	//'dwOutValue' = receives the number parsed from 'pStr'
+	//RETURN:
+	//		= TRUE if 'pStr' is a positive decimal number
+	dwOutValue = 0;
+
+	if (pStr &&
+		pStr[0] >= '0' &&
+		pStr[0] <= '9')
+	{
+		WCHAR* pEnd = NULL;
+		ULONG uiVal = wcstoul(pStr, &pEnd, 10);
+		if (pEnd &&
+			!*pEnd &&
+			uiVal &&
+			uiVal != ULONG_MAX)
+		{
+			dwOutValue = uiVal;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+
+void CSigRem::ShowHelpInfo()
+{
+	//Show help info to the console
+
+	//Get current exe file name (without extension)
+	WCHAR buffThis[MAX_PATH] = {};
+	::GetModuleFileName(NULL, buffThis, _countof(buffThis));
+	*::PathFindExtension(buffThis) = 0;
+	LPCTSTR pThisFile = ::PathFindFileName(buffThis);
+
+	wprintf(
+		L"%s -i <File> [-o <File>] [-io <Policy>]\n"
+		L"%s -d <Folder> [-j <File> [-r]] [-io <Policy>]\n"
+		L"%s -w <Folder> [-o <Folder>] [-io <Policy>]\n"
+		L"%s -s <PipeName> [-io <Policy>]\n"
+		L"%s -c <PipeName> -i <File> [-o <File>] [-ph] [-n <Count> [-t <Threads>]]\n"
+		L"%s -i <File> -bio [-n <Runs>]\n"
+		L"%s -fc <Path>\n"
+		L"%s -a <File> [-o <File>]\n"
+		L"%s -vd <Folder>\n"
+		L"\n"
+		L"where:\n"
+		L" -i  = specifies PE file to remove signature from:\n"
+		L"        <File> = File path to read PE binary.\n"
+		L" -o  = [optional] specifies destination PE file:\n"
+		L"        If omitted, the new file name will have%s suffix in the same folder.\n"
+		L"        <File> = File path to create new PE binary.\n"
+		L" -d  = specifies folder to remove signatures from all PE files in it, and in its subfolders:\n"
+		L"        New file names will have%s suffix in the same folders.\n"
+		L"        Identical input files are processed only once, and the rest of the output\n"
+		L"        files are created as hard links (or copies) of the first one.\n"
+		L"        <Folder> = Folder path with PE binaries.\n"
+		L" -j  = [optional] specifies journal file to record results of the -d batch into:\n"
+		L"        <File> = File path for the journal (new records are appended to it).\n"
+		L" -r  = [optional] resume the -d batch by skipping files that were completed in the\n"
+		L"        -j journal (and were not modified since then).\n"
+		L" -w  = specifies folder to watch, and to remove signatures from PE files as soon as\n"
+		L"        they are written into it (subfolders are not watched). Press Ctrl+C to stop.\n"
+		L"        <Folder> = Folder path to watch.\n"
+		L"        If -o is specified, it is the folder path to create new PE binaries in.\n"
+		L"        Otherwise new file names will have%s suffix in the same folder.\n"
+		L" -s  = run as a server that removes signatures on requests from local clients (see -c).\n"
+		L"        Press Ctrl+C to stop.\n"
+		L"        <PipeName> = Name of the pipe to listen on.\n"
+		L" -c  = send the -i file to the server instead of processing it in this process:\n"
+		L"        <PipeName> = Name of the pipe the server listens on.\n"
+		L" -ph = [optional] pass the open -i file handle to the server instead of its path.\n"
+		L" -n  = [optional] benchmark the server by sending the -c request this many times:\n"
+		L"        <Count> = Number of requests to send.\n"
+		L"        Each connection writes to its own output file, with its number in the name.\n"
+		L" -t  = [optional] number of concurrent connections for the -n benchmark (default is 1):\n"
+		L"        <Threads> = Number of connections.\n"
+		L" -io = [optional] specifies how to read and write files:\n"
+		L"        <Policy> = buffered   - through the file cache (default).\n"
+		L"                   sequential - through the file cache with more read-ahead, and cached\n"
+		L"                                data is reused sooner.\n"
+		L"                   direct     - bypass the file cache, so that bulk runs don't evict\n"
+		L"                                data of other processes from it.\n"
+		L" -fc = repair stale checksums of PE files in place (only the CheckSum field is written,\n"
+		L"        and only if it's wrong):\n"
+		L"        <Path> = PE file path, or folder path to repair all PE files in it, and in its\n"
+		L"                 subfolders (in parallel).\n"
+		L" -a  = remove signatures from PE files inside a ZIP or TAR archive, and write a new archive:\n"
+		L"        <File> = Archive file path.\n"
+		L"        If -o is specified, it is the file path to create the new archive.\n"
+		L"        Otherwise new file name will have%s suffix in the same folder.\n"
+		L"        Changed ZIP entries are stored uncompressed, all other entries are copied as-is.\n"
+		L" -vd = verify that all engines (I/O policies, checksum kernels, checksum repair, header\n"
+		L"        classifier) produce the same results as the reference one, and show their throughput:\n"
+		L"        <Folder> = Folder path with PE files to test on (they are not modified). Each file\n"
+		L"                   is also tested with an extra BYTE at the end, and with only its headers.\n"
+		L" -bio = benchmark each -io policy on the signed -i file, with the file in the cache and not:\n"
+		L"        -n = [optional] number of runs for each case (default is 5).\n"
+		L"\n"
+		L"Examples:\n"
+		L" %s -i \"path-to\\file.exe\"\n"
+		L" %s -i \"path-to\\file.exe\" -o \"path-to\\result.exe\"\n"
+		L" %s -d \"path-to\\folder\"\n"
+		L" %s -d \"path-to\\folder\" -j \"path-to\\journal.bin\" -r\n"
+		L" %s -w \"path-to\\build-output\" -o \"path-to\\unsigned\"\n"
+		L" %s -s SigRemSrv\n"
+		L" %s -c SigRemSrv -i \"path-to\\file.exe\" -n 10000 -t 8\n"
+		L" %s -d \"path-to\\folder\" -io direct\n"
+		L" %s -i \"path-to\\file.exe\" -bio -n 10\n"
+		L" %s -fc \"path-to\\folder\"\n"
+		L" %s -a \"path-to\\package.zip\" -o \"path-to\\unsigned.zip\"\n"
+		L" %s -vd \"path-to\\corpus\"\n"
+		L"\n"
+		,
+		pThisFile,
+		pThisFile,
+		pThisFile,
+		pThisFile,
+		pThisFile,
+		pThisFile,
+		pThisFile,
+		pThisFile,
+		pThisFile,
+		SUFFIX_FILE_NAME,
+		SUFFIX_FILE_NAME,
+		SUFFIX_FILE_NAME,
+		SUFFIX_FILE_NAME,
+		pThisFile,
+		pThisFile,
+		pThisFile,
+		pThisFile,
+		pThisFile,
+		pThisFile,
+		pThisFile,
+		pThisFile,
+		pThisFile,
+		pThisFile,
+		pThisFile,
+		pThisFile
+	);
 }
\ No newline at end of file
@@ -1,65 +1,121 @@
-//  
-//    Binary File Digital Signature Remover App
-//    "Utility to remove digital code signature from binary PE files in Windows."
-//    Copyright (c) 2021 www.dennisbabkin.com
-//    
-//        https://dennisbabkin.com/sigremover
-//
-//        https://dennisbabkin.com/blog/?i=AAA10400
-//
-//    Licensed under the Apache License, Version 2.0 (the "License");
-//    you may not use this file except in compliance with the License.
-//    You may obtain a copy of the License at
-//    
-//        https://www.apache.org/licenses/LICENSE-2.0
-//    
-//    Unless required by applicable law or agreed to in writing, software
-//    distributed under the License is distributed on an "AS IS" BASIS,
-//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
-//    See the License for the specific language governing permissions and
-//    limitations under the License.
-//  
-//
-
-
-//SigRemover main functionality
-#pragma once
-
-#include <tchar.h>
-#include <Windows.h>
-#include <strsafe.h>
-#include <assert.h>
-#include <new>
-
-#include <imagehlp.h>
-#pragma comment(lib, "Imagehlp.lib")
-
-#include <shlwapi.h>
-#pragma comment(lib, "Shlwapi.lib")
-
-
-#include "Types.h"
-
-
-
-#ifdef _DEBUG
-#define verify(f) assert(f)
-#else
-#define verify(f) (f)
-#endif
-
-#define SUFFIX_FILE_NAME L" (NoSig)"
-
-
-class CSigRem
-{
-public:
-	static EXIT_CODES RemoveDigitalSignature(LPCTSTR pStrFilePath, LPCTSTR pStrOutputFile = NULL);
-	static BOOL IsCmdLineParam(LPCTSTR pCmd, LPCTSTR pToCheck);
-	static void ReportOSError(int nOSError = ::GetLastError(), LPCTSTR pStrFmt = NULL, ...);
-	static void ShowHelpInfo();
-protected:
-	static const WCHAR* getFormattedErrorMsg(int nOSError, WCHAR* pBuffer, size_t szchBuffer);
-	static EXIT_CODES process_PE_File(BYTE* pBaseAddr, ULONG szcbMem, ULONG& uicbNewFileSz, int& nOSErr);
-};
-
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+//SigRemover main functionality
+#pragma once
+
+#include <tchar.h>
+#include <Windows.h>
+#include <strsafe.h>
+#include <assert.h>
+#include <new>
+#include <string>
+
+#include <imagehlp.h>
+#pragma comment(lib, "Imagehlp.lib")
+
+#include <shlwapi.h>
+#pragma comment(lib, "Shlwapi.lib")
+
+
+#include "Types.h"
+
+
+
+#ifdef _DEBUG
+#define verify(f) assert(f)
+#else
+#define verify(f) (f)
+#endif
+
+#define SUFFIX_FILE_NAME L" (NoSig)"
+
+
+struct SIGREM_RESULTS
+{
+	ULONGLONG uicbInputSz;				//Size of the input file in BYTEs
+	ULONGLONG uicbOutputSz;				//Size of the new file in BYTEs (valid only if result is XC_Success)
+};
+
+
+class CBuffPool;
+
+
+enum SIGREM_FLAGS {
+	SRF_QUIET_SKIPPED = 0x1,			//Don't report files that are not PE binaries, or have no signature
+	SRF_QUIET_SUCCESS = 0x2,			//Don't report files that were created successfully
+	SRF_HANDLE_HAS_IO_POLICY = 0x4,		//Input file handle was already opened with flags for the I/O policy (see CSigRem::GetIoPolicyFileFlags)
+};
+
+
+enum SIGREM_IO_POLICY {
+	SIP_Buffered,						//Regular I/O through the file cache (default)
+	SIP_Sequential,						//I/O through the file cache with a sequential access hint (more read-ahead, cached pages are reused sooner)
+	SIP_Direct,							//Unbuffered I/O that bypasses the file cache (with sizes and buffers aligned to SIGREM_DIRECT_IO_ALIGN)
+
+	SIP_Count							//Number of policies (must be last)
+};
+
+#define SIGREM_DIRECT_IO_ALIGN 0x1000	//Alignment of file offsets, sizes and buffers for SIP_Direct, in BYTEs (covers 512 and 4K sectors)
+
+
+struct SIGREM_PARAMS
+{
+	CBuffPool* pBuffPool;				//If not NULL, pool to get the buffer for the file data from
+	DWORD dwFlags;						//Combination of SIGREM_FLAGS
+	SIGREM_IO_POLICY ioPolicy;			//How to read and write files
+};
+
+
+struct PE_HEADERS_INFO
+{
+	IMAGE_NT_HEADERS* pNtHdr;			//NT headers (use OptionalHeader.Magic to determine bitness)
+	IMAGE_DATA_DIRECTORY* pSecurityDir;	//IMAGE_DIRECTORY_ENTRY_SECURITY data directory
+	DWORD* pdwChecksum;					//CheckSum in the optional header
+};
+
+
+class CSigRem
+{
+public:
+	static EXIT_CODES RemoveDigitalSignature(LPCTSTR pStrFilePath, LPCTSTR pStrOutputFile = NULL, SIGREM_RESULTS* pOutResults = NULL, const SIGREM_PARAMS* pParams = NULL);
+	static EXIT_CODES RemoveDigitalSignatureFromHandle(HANDLE hFile, LPCTSTR pStrFilePath, LPCTSTR pStrOutputFile = NULL, SIGREM_RESULTS* pOutResults = NULL, const SIGREM_PARAMS* pParams = NULL);
+	static EXIT_CODES RemoveDigitalSignatureFromMemory(BYTE* pFileMem, ULONG szcbFileMem, ULONG& uicbNewFileSz, int& nOSErr);
+	static WCHAR* MakeOutputFileName(LPCTSTR pStrFilePath);
+	static EXIT_CODES parse_PE_Headers(BYTE* pBaseAddr, ULONG szcbMem, PE_HEADERS_INFO& info, int& nOSErr);
+	static DWORD GetIoPolicyFileFlags(SIGREM_IO_POLICY ioPolicy);
+	static BOOL ParseIoPolicy(LPCTSTR pStr, SIGREM_IO_POLICY& ioPolicy);
+	static LPCTSTR GetIoPolicyName(SIGREM_IO_POLICY ioPolicy);
+	static std::wstring MakePipePath(LPCTSTR pStrPipeName);
+	static BOOL ParseCmdLineNumber(LPCTSTR pStr, DWORD& dwOutValue);
+	static BOOL IsCmdLineParam(LPCTSTR pCmd, LPCTSTR pToCheck);
+	static void ReportOSError(int nOSError = ::GetLastError(), LPCTSTR pStrFmt = NULL, ...);
+	static void ShowHelpInfo();
+protected:
+	static const WCHAR* getFormattedErrorMsg(int nOSError, WCHAR* pBuffer, size_t szchBuffer);
+	static EXIT_CODES process_File(HANDLE hFile, LPCTSTR pStrFilePath, LPCTSTR pStrOutputFile, SIGREM_RESULTS* pOutResults,
+		CBuffPool* pBuffPool, DWORD dwFlags, SIGREM_IO_POLICY ioPolicy, BOOL bUnbufferedRead);
+	static EXIT_CODES process_PE_File(BYTE* pBaseAddr, ULONG szcbMem, ULONG& uicbNewFileSz, int& nOSErr);
+};
+
@@ -0,0 +1,1064 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+
+#include "CSigRemArchive.h"
+#include "CInflate.h"
+
+#include <algorithm>
+
+
+
+
+CSigRemArchive::CSigRemArchive()
+{
+	_hIn = INVALID_HANDLE_VALUE;
+	_hOut = INVALID_HANDLE_VALUE;
+	_uicbInSz = 0;
+	_uiOutPos = 0;
+	_nOutBuffUsed = 0;
+	_dwFlags = 0;
+
+	_pOutBuff = new (std::nothrow) BYTE[ARCHIVE_IO_BUFF_SIZE];
+	_pCopyBuff = new (std::nothrow) BYTE[ARCHIVE_IO_BUFF_SIZE];
+
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+
+CSigRemArchive::~CSigRemArchive()
+{
+	assert(_hIn == INVALID_HANDLE_VALUE);
+	assert(_hOut == INVALID_HANDLE_VALUE);
+
+	if (_pOutBuff)
+	{
+		delete[] _pOutBuff;
+		_pOutBuff = NULL;
+	}
+
+	if (_pCopyBuff)
+	{
+		delete[] _pCopyBuff;
+		_pCopyBuff = NULL;
+	}
+}
+
+
+EXIT_CODES CSigRemArchive::ProcessArchive(LPCTSTR pStrFilePath, LPCTSTR pStrOutputFile, DWORD dwFlags)
+{
+	//Remove digital signatures from PE files in a ZIP or TAR archive, and write a new archive
+	//INFO: Entries that are not changed are copied as-is (without recompression). Changed ZIP entries are stored uncompressed.
+	//'pStrFilePath' = input archive path
+	//'pStrOutputFile' = if not NULL, and not L"", path for the new archive (or use file suffix on the input file)
+	//'dwFlags' = combination of SIGREM_FLAGS (SRF_QUIET_SUCCESS also hides entries and the summary)
+	//RETURN:
+	//		= XC_Success if all signed PE files in the archive were processed
+	//		= XC_BinaryHasNoSignature if there were no signed PE files in the archive (new archive is not created)
+	//		= Other value if error
+	memset(&_stats, 0, sizeof(_stats));
+	_uiOutPos = 0;
+	_nOutBuffUsed = 0;
+	_dwFlags = dwFlags;
+
+	if (!_pOutBuff ||
+		!_pCopyBuff)
+	{
+		//Error
+		CSigRem::ReportOSError(ERROR_OUTOFMEMORY, L"Failed to reserve memory for archive processing");
+		return XC_GEN_FAILURE;
+	}
+
+	_strInputFile = pStrFilePath;
+
+	if (pStrOutputFile &&
+		pStrOutputFile[0])
+	{
+		_strOutputFile = pStrOutputFile;
+	}
+	else
+	{
+		WCHAR* pNewFileName = CSigRem::MakeOutputFileName(pStrFilePath);
+		if (!pNewFileName)
+		{
+			//Error was reported
+			return XC_GEN_FAILURE;
+		}
+
+		_strOutputFile = pNewFileName;
+		delete[] pNewFileName;
+	}
+
+	EXIT_CODES nResult = XC_FailedToOpen;
+
+	_hIn = ::CreateFile(pStrFilePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (_hIn != INVALID_HANDLE_VALUE)
+	{
+		LARGE_INTEGER liFileSz = {};
+		if (::GetFileSizeEx(_hIn, &liFileSz))
+		{
+			_uicbInSz = (ULONGLONG)liFileSz.QuadPart;
+
+			ARCHIVE_TYPE type = detectType();
+			if (type != AT_Unknown)
+			{
+				_hOut = ::CreateFile(_strOutputFile.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+				if (_hOut != INVALID_HANDLE_VALUE)
+				{
+					nResult = type == AT_Zip ? processZip() : processTar();
+
+					if (nResult == XC_Success &&
+						!flush())
+					{
+						//Error was reported
+						nResult = XC_FailedFileWrite;
+					}
+
+					verify(::CloseHandle(_hOut));
+					_hOut = INVALID_HANDLE_VALUE;
+
+					if (nResult == XC_Success)
+					{
+						if (!_stats.nStripped)
+						{
+							//Don't leave a copy of the same archive
+							nResult = _stats.nFailed ? XC_GEN_FAILURE : XC_BinaryHasNoSignature;
+						}
+						else if (_stats.nFailed)
+						{
+							nResult = XC_GEN_FAILURE;
+						}
+					}
+
+					if (nResult == XC_Success ||
+						(nResult == XC_GEN_FAILURE && _stats.nStripped))
+					{
+						if (!(_dwFlags & SRF_QUIET_SUCCESS))
+							wprintf(L"SUCCESS creating new archive:\n\"%s\"\n", _strOutputFile.c_str());
+					}
+					else
+					{
+						//Remove what we've written
+						::DeleteFile(_strOutputFile.c_str());
+					}
+
+					if (!(_dwFlags & SRF_QUIET_SUCCESS))
+						showSummary();
+				}
+				else
+					CSigRem::ReportOSError(::GetLastError(), L"Failed to create destination file: %s", _strOutputFile.c_str());
+			}
+			else
+			{
+				CSigRem::ReportOSError(ERROR_BAD_FORMAT, L"Specified file is not a ZIP or TAR archive: %s", pStrFilePath);
+				nResult = XC_Not_PE_File;
+			}
+		}
+		else
+			CSigRem::ReportOSError(::GetLastError(), L"Failed to get file size: %s", pStrFilePath);
+
+		verify(::CloseHandle(_hIn));
+		_hIn = INVALID_HANDLE_VALUE;
+	}
+	else
+		CSigRem::ReportOSError(::GetLastError(), L"Failed to open archive file: %s", pStrFilePath);
+
+	return nResult;
+}
+
+
+DWORD CSigRemArchive::Crc32(DWORD dwCrc, const BYTE* pData, size_t szcbData)
+{
+	//Compute CRC-32 (as used in ZIP files) with 8 BYTEs per step
+	//'dwCrc' = CRC of the preceding data, or 0 to start
+	//RETURN:
+	//		= CRC of the preceding data and 'pData'
+	struct CRC_TABLES
+	{
+		DWORD t[8][256];
+
+		CRC_TABLES()
+		{
+			for (DWORD i = 0; i < 256; i++)
+			{
+				DWORD c = i;
+				for (int k = 0; k < 8; k++)
+				{
+					c = (c >> 1) ^ (c & 1 ? 0xEDB88320 : 0);
+				}
+
+				t[0][i] = c;
+			}
+
+			for (DWORD i = 0; i < 256; i++)
+			{
+				for (int s = 1; s < 8; s++)
+				{
+					t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+				}
+			}
+		}
+	};
+
+	//Built once (thread-safe)
+	static const CRC_TABLES tables;
+	const DWORD (*t)[256] = tables.t;
+
+	DWORD c = ~dwCrc;
+
+	while (szcbData >= 8)
+	{
+		DWORD dwLo = c ^ (pData[0] | (pData[1] << 8) | (pData[2] << 16) | ((DWORD)pData[3] << 24));
+		DWORD dwHi = pData[4] | (pData[5] << 8) | (pData[6] << 16) | ((DWORD)pData[7] << 24);
+
+		c = t[7][dwLo & 0xFF] ^ t[6][(dwLo >> 8) & 0xFF] ^ t[5][(dwLo >> 16) & 0xFF] ^ t[4][dwLo >> 24] ^
+			t[3][dwHi & 0xFF] ^ t[2][(dwHi >> 8) & 0xFF] ^ t[1][(dwHi >> 16) & 0xFF] ^ t[0][dwHi >> 24];
+
+		pData += 8;
+		szcbData -= 8;
+	}
+
+	while (szcbData--)
+	{
+		c = (c >> 8) ^ t[0][(c ^ *pData++) & 0xFF];
+	}
+
+	return ~c;
+}
+
+
+ARCHIVE_TYPE CSigRemArchive::detectType()
+{
+	//RETURN:
+	//		= Type of the input archive
+	BYTE buff[TAR_BLOCK_SIZE] = {};
+	DWORD dwcbHdr = _uicbInSz < sizeof(buff) ? (DWORD)_uicbInSz : sizeof(buff);
+	if (dwcbHdr < sizeof(DWORD) ||
+		!readAt(0, buff, dwcbHdr))
+	{
+		return AT_Unknown;
+	}
+
+	DWORD dwSig = *(DWORD*)buff;
+	if (dwSig == ZIP_SIG_LOCAL_HEADER ||
+		dwSig == ZIP_SIG_END_OF_CD)
+	{
+		return AT_Zip;
+	}
+
+	if (dwcbHdr == TAR_BLOCK_SIZE &&
+		isTarHeaderValid(*(TAR_HEADER*)buff))
+	{
+		return AT_Tar;
+	}
+
+	//ZIP archives may have something else in front (like self-extracting stubs) - but they must have the end record
+	ZIP_END_OF_CD eocd;
+	if (_uicbInSz >= sizeof(eocd) &&
+		readAt(_uicbInSz - sizeof(eocd), &eocd, sizeof(eocd)) &&
+		eocd.dwSignature == ZIP_SIG_END_OF_CD)
+	{
+		return AT_Zip;
+	}
+
+	return AT_Unknown;
+}
+
+
+EXIT_CODES CSigRemArchive::processZip()
+{
+	//Write new ZIP archive from the input one
+	//RETURN:
+	//		= XC_Success if the new archive was written
+	//		= Other value if error (it will be reported)
+
+	//Find the end of central directory record (it's followed by a comment of up to 64K)
+	size_t szcbTail = (size_t)std::min<ULONGLONG>(_uicbInSz, sizeof(ZIP_END_OF_CD) + 0xFFFF);
+	std::vector<BYTE> arrTail(szcbTail);
+	if (szcbTail < sizeof(ZIP_END_OF_CD) ||
+		!readAt(_uicbInSz - szcbTail, arrTail.data(), (DWORD)szcbTail))
+	{
+		CSigRem::ReportOSError(ERROR_BAD_FORMAT, L"Failed to read ZIP archive: %s", _strInputFile.c_str());
+		return XC_FailedToOpen;
+	}
+
+	const ZIP_END_OF_CD* pEocd = NULL;
+	for (size_t i = szcbTail - sizeof(ZIP_END_OF_CD) + 1; i-- > 0; )
+	{
+		const ZIP_END_OF_CD* p = (const ZIP_END_OF_CD*)(arrTail.data() + i);
+		if (p->dwSignature == ZIP_SIG_END_OF_CD &&
+			i + sizeof(ZIP_END_OF_CD) + p->wcbComment <= szcbTail)
+		{
+			pEocd = p;
+			break;
+		}
+	}
+
+	if (!pEocd)
+	{
+		CSigRem::ReportOSError(ERROR_BAD_FORMAT, L"Failed to find ZIP central directory: %s", _strInputFile.c_str());
+		return XC_FailedToOpen;
+	}
+
+	if (pEocd->wDisk != 0 ||
+		pEocd->wDiskWithCD != 0 ||
+		pEocd->wEntriesOnDisk != pEocd->wEntries)
+	{
+		CSigRem::ReportOSError(ERROR_NOT_SUPPORTED, L"Multi-volume ZIP archives are not supported: %s", _strInputFile.c_str());
+		return XC_FailedToOpen;
+	}
+
+	if (pEocd->wEntries == 0xFFFF ||
+		pEocd->dwcbCD == 0xFFFFFFFF ||
+		pEocd->dwCDOffset == 0xFFFFFFFF)
+	{
+		CSigRem::ReportOSError(ERROR_NOT_SUPPORTED, L"ZIP64 archives are not supported: %s", _strInputFile.c_str());
+		return XC_FailedToOpen;
+	}
+
+	if ((ULONGLONG)pEocd->dwCDOffset + pEocd->dwcbCD > _uicbInSz)
+	{
+		CSigRem::ReportOSError(ERROR_BAD_FORMAT, L"ZIP central directory is corrupted: %s", _strInputFile.c_str());
+		return XC_FailedToOpen;
+	}
+
+	ZIP_END_OF_CD eocd = *pEocd;
+	std::vector<BYTE> arrComment((const BYTE*)(pEocd + 1), (const BYTE*)(pEocd + 1) + pEocd->wcbComment);
+
+	//Read central directory
+	std::vector<BYTE> arrCD(eocd.dwcbCD);
+	if (eocd.dwcbCD &&
+		!readAt(eocd.dwCDOffset, arrCD.data(), eocd.dwcbCD))
+	{
+		CSigRem::ReportOSError(::GetLastError(), L"Failed to read ZIP central directory: %s", _strInputFile.c_str());
+		return XC_FailedToOpen;
+	}
+
+	std::vector<ZIP_ENTRY> arrEntries;
+	arrEntries.reserve(eocd.wEntries);
+
+	for (size_t nPos = 0; arrEntries.size() < eocd.wEntries; )
+	{
+		const ZIP_CENTRAL_HEADER* pCH = (const ZIP_CENTRAL_HEADER*)(arrCD.data() + nPos);
+		if (nPos + sizeof(ZIP_CENTRAL_HEADER) > arrCD.size() ||
+			pCH->dwSignature != ZIP_SIG_CENTRAL_HEADER ||
+			nPos + sizeof(ZIP_CENTRAL_HEADER) + pCH->wcbFileName + pCH->wcbExtra + pCH->wcbComment > arrCD.size())
+		{
+			CSigRem::ReportOSError(ERROR_BAD_FORMAT, L"ZIP central directory is corrupted: %s", _strInputFile.c_str());
+			return XC_FailedToOpen;
+		}
+
+		ZIP_ENTRY entry;
+		entry.nCDOffset = nPos;
+		entry.dwLocalHeaderOffset = pCH->dwLocalHeaderOffset;
+		arrEntries.push_back(entry);
+
+		nPos += sizeof(ZIP_CENTRAL_HEADER) + pCH->wcbFileName + pCH->wcbExtra + pCH->wcbComment;
+	}
+
+	_stats.nEntries = arrEntries.size();
+
+	//Write entries in the order of their data (central directory keeps its own order)
+	std::vector<size_t> arrOrder(arrEntries.size());
+	for (size_t i = 0; i < arrOrder.size(); i++)
+		arrOrder[i] = i;
+
+	std::sort(arrOrder.begin(), arrOrder.end(), [&arrEntries](size_t a, size_t b)
+	{
+		return arrEntries[a].dwLocalHeaderOffset < arrEntries[b].dwLocalHeaderOffset;
+	});
+
+	//Keep whatever was in front of the first entry (like a self-extracting stub), so that offsets stay the same
+	ULONGLONG uicbPrefix = arrOrder.empty() ? eocd.dwCDOffset : arrEntries[arrOrder[0]].dwLocalHeaderOffset;
+	if (!copyRange(0, uicbPrefix))
+		return XC_FailedFileWrite;
+
+	std::vector<BYTE> arrLocal;
+	std::vector<BYTE> arrData;
+	std::vector<BYTE> arrPlain;
+
+	for (size_t o = 0; o < arrOrder.size(); o++)
+	{
+		ZIP_ENTRY& entry = arrEntries[arrOrder[o]];
+		ZIP_CENTRAL_HEADER* pCH = (ZIP_CENTRAL_HEADER*)(arrCD.data() + entry.nCDOffset);
+
+		std::wstring strName = entryName((const char*)(pCH + 1), pCH->wcbFileName,
+			pCH->wFlags & ZIP_FLAG_UTF8 ? CP_UTF8 : CP_OEMCP);
+
+		//Read local header with its file name and extra field
+		ZIP_LOCAL_HEADER lh;
+		if (!readAt(entry.dwLocalHeaderOffset, &lh, sizeof(lh)) ||
+			lh.dwSignature != ZIP_SIG_LOCAL_HEADER)
+		{
+			CSigRem::ReportOSError(ERROR_BAD_FORMAT, L"ZIP local header is corrupted for \"%s\" in: %s", strName.c_str(), _strInputFile.c_str());
+			return XC_FailedToOpen;
+		}
+
+		size_t szcbLocal = sizeof(lh) + lh.wcbFileName + lh.wcbExtra;
+		arrLocal.resize(szcbLocal);
+		memcpy(arrLocal.data(), &lh, sizeof(lh));
+
+		ULONGLONG uiDataOffset = (ULONGLONG)entry.dwLocalHeaderOffset + szcbLocal;
+		ULONGLONG uicbData = pCH->dwcbCompressed;
+
+		if ((szcbLocal > sizeof(lh) &&
+			!readAt(entry.dwLocalHeaderOffset + sizeof(lh), arrLocal.data() + sizeof(lh), (DWORD)(szcbLocal - sizeof(lh)))) ||
+			uiDataOffset + uicbData > _uicbInSz)
+		{
+			CSigRem::ReportOSError(ERROR_BAD_FORMAT, L"ZIP entry is corrupted \"%s\" in: %s", strName.c_str(), _strInputFile.c_str());
+			return XC_FailedToOpen;
+		}
+
+		//Data descriptor follows the data, with or without its signature
+		ULONGLONG uicbDescriptor = 0;
+		if (lh.wFlags & ZIP_FLAG_DATA_DESCRIPTOR)
+		{
+			DWORD dwSig = 0;
+			uicbDescriptor = uiDataOffset + uicbData + sizeof(dwSig) <= _uicbInSz &&
+				readAt(uiDataOffset + uicbData, &dwSig, sizeof(dwSig)) &&
+				dwSig == ZIP_SIG_DATA_DESCRIPTOR ? 16 : 12;
+		}
+
+		//See if it's a PE file that we can work with
+		BOOL bCandidate = !(pCH->wFlags & ZIP_FLAG_ENCRYPTED) &&
+			(pCH->wMethod == ZIP_METHOD_STORED || pCH->wMethod == ZIP_METHOD_DEFLATED) &&
+			pCH->dwcbCompressed != 0xFFFFFFFF &&
+			pCH->dwcbUncompressed < INT_MAX &&
+			pCH->dwcbUncompressed >= sizeof(IMAGE_DOS_HEADER) &&
+			pCH->dwcbCompressed < INT_MAX;
+
+		BOOL bHaveData = FALSE;
+		if (bCandidate)
+		{
+			//Look at the beginning of the data first, so that we don't read other files into memory
+			DWORD dwcbPeek = (DWORD)std::min<ULONGLONG>(uicbData, pCH->wMethod == ZIP_METHOD_STORED ? sizeof(WORD) : ARCHIVE_PEEK_SIZE);
+			arrData.resize(dwcbPeek);
+			if (!readAt(uiDataOffset, arrData.data(), dwcbPeek))
+			{
+				CSigRem::ReportOSError(::GetLastError(), L"Failed to read ZIP entry \"%s\" in: %s", strName.c_str(), _strInputFile.c_str());
+				return XC_FailedToOpen;
+			}
+
+			BYTE mz[sizeof(WORD)] = {};
+			size_t szcbMz = 0;
+			if (pCH->wMethod == ZIP_METHOD_STORED)
+			{
+				szcbMz = std::min<size_t>(dwcbPeek, sizeof(mz));
+				memcpy(mz, arrData.data(), szcbMz);
+			}
+			else
+			{
+				//This fails when it runs out of either buffer, but it still gives us what it decompressed
+				CInflate::Inflate(arrData.data(), dwcbPeek, mz, sizeof(mz), szcbMz);
+			}
+
+			bCandidate = szcbMz == sizeof(mz) &&
+				*(WORD*)mz == IMAGE_DOS_SIGNATURE;
+
+			if (bCandidate)
+			{
+				//Read all of it
+				arrData.resize((size_t)uicbData);
+				if (!readAt(uiDataOffset, arrData.data(), (DWORD)uicbData))
+				{
+					CSigRem::ReportOSError(::GetLastError(), L"Failed to read ZIP entry \"%s\" in: %s", strName.c_str(), _strInputFile.c_str());
+					return XC_FailedToOpen;
+				}
+
+				bHaveData = TRUE;
+			}
+		}
+
+		BOOL bStripped = FALSE;
+		if (bCandidate)
+		{
+			//Work on a copy, so that we can still write the original entry if this fails
+			ULONG dwcbPlain = pCH->dwcbUncompressed;
+			arrPlain.resize(dwcbPlain);
+			BYTE* pPlain = arrPlain.data();
+
+			BOOL bPlainOK;
+			if (pCH->wMethod == ZIP_METHOD_STORED)
+			{
+				bPlainOK = pCH->dwcbCompressed == dwcbPlain;
+				if (bPlainOK)
+					memcpy(pPlain, arrData.data(), dwcbPlain);
+			}
+			else
+			{
+				size_t szcbOut = 0;
+				bPlainOK = CInflate::Inflate(arrData.data(), arrData.size(), pPlain, dwcbPlain, szcbOut) &&
+					szcbOut == dwcbPlain;
+			}
+
+			bPlainOK = bPlainOK &&
+				Crc32(0, pPlain, dwcbPlain) == pCH->dwCrc32;
+
+			if (bPlainOK)
+			{
+				ULONG uicbNewSz = 0;
+				if (stripEntry(pPlain, dwcbPlain, uicbNewSz, strName.c_str()) == XC_Success)
+				{
+					//Write new entry (stored)
+					DWORD dwCrc = Crc32(0, pPlain, uicbNewSz);
+					WORD wFlags = pCH->wFlags & ~(ZIP_FLAG_DATA_DESCRIPTOR | ZIP_FLAG_DEFLATE_OPTIONS);
+
+					ZIP_LOCAL_HEADER* pLH = (ZIP_LOCAL_HEADER*)arrLocal.data();
+					pLH->wFlags = wFlags;
+					pLH->wMethod = ZIP_METHOD_STORED;
+					pLH->dwCrc32 = dwCrc;
+					pLH->dwcbCompressed = uicbNewSz;
+					pLH->dwcbUncompressed = uicbNewSz;
+
+					pCH->wFlags = wFlags;
+					pCH->wMethod = ZIP_METHOD_STORED;
+					pCH->dwCrc32 = dwCrc;
+					pCH->dwcbCompressed = uicbNewSz;
+					pCH->dwcbUncompressed = uicbNewSz;
+
+					if (_uiOutPos + arrLocal.size() + uicbNewSz >= 0xFFFFFFFF)
+					{
+						CSigRem::ReportOSError(ERROR_NOT_SUPPORTED, L"New archive would need ZIP64, which is not supported: %s", _strOutputFile.c_str());
+						return XC_FailedFileWrite;
+					}
+
+					pCH->dwLocalHeaderOffset = (DWORD)_uiOutPos;
+
+					if (!write(arrLocal.data(), arrLocal.size()) ||
+						!write(pPlain, uicbNewSz))
+					{
+						return XC_FailedFileWrite;
+					}
+
+					bStripped = TRUE;
+				}
+			}
+			else
+			{
+				CSigRem::ReportOSError(ERROR_INVALID_DATA, L"Data is corrupted for \"%s\" in: %s", strName.c_str(), _strInputFile.c_str());
+				_stats.nFailed++;
+			}
+		}
+
+		if (!bStripped)
+		{
+			//Copy it as-is
+			if (_uiOutPos + arrLocal.size() + uicbData + uicbDescriptor >= 0xFFFFFFFF)
+			{
+				CSigRem::ReportOSError(ERROR_NOT_SUPPORTED, L"New archive would need ZIP64, which is not supported: %s", _strOutputFile.c_str());
+				return XC_FailedFileWrite;
+			}
+
+			pCH->dwLocalHeaderOffset = (DWORD)_uiOutPos;
+
+			if (!write(arrLocal.data(), arrLocal.size()) ||
+				!(bHaveData ? write(arrData.data(), (size_t)uicbData) : copyRange(uiDataOffset, uicbData)) ||
+				!copyRange(uiDataOffset + uicbData, uicbDescriptor))
+			{
+				return XC_FailedFileWrite;
+			}
+		}
+	}
+
+	//Write central directory and its end record
+	if (_uiOutPos + arrCD.size() >= 0xFFFFFFFF)
+	{
+		CSigRem::ReportOSError(ERROR_NOT_SUPPORTED, L"New archive would need ZIP64, which is not supported: %s", _strOutputFile.c_str());
+		return XC_FailedFileWrite;
+	}
+
+	eocd.dwCDOffset = (DWORD)_uiOutPos;
+	eocd.dwcbCD = (DWORD)arrCD.size();
+
+	if (!write(arrCD.data(), arrCD.size()) ||
+		!write(&eocd, sizeof(eocd)) ||
+		!write(arrComment.data(), arrComment.size()))
+	{
+		return XC_FailedFileWrite;
+	}
+
+	return XC_Success;
+}
+
+
+EXIT_CODES CSigRemArchive::processTar()
+{
+	//Write new TAR archive from the input one
+	//RETURN:
+	//		= XC_Success if the new archive was written
+	//		= Other value if error (it will be reported)
+	std::vector<BYTE> arrData;
+	ULONGLONG uiPos = 0;
+	ULONGLONG uiPaxSize = 0;
+	BOOL bPaxSize = FALSE;
+
+	for (;;)
+	{
+		TAR_HEADER hdr;
+		if (uiPos + sizeof(hdr) > _uicbInSz)
+		{
+			//Archive ends without the end-of-archive blocks - keep whatever is left
+			return copyRange(uiPos, _uicbInSz - uiPos) ? XC_Success : XC_FailedFileWrite;
+		}
+
+		if (!readAt(uiPos, &hdr, sizeof(hdr)))
+		{
+			CSigRem::ReportOSError(::GetLastError(), L"Failed to read TAR archive: %s", _strInputFile.c_str());
+			return XC_FailedToOpen;
+		}
+
+		//Zero block marks the end of the archive - keep the rest as-is
+		BOOL bZero = TRUE;
+		for (size_t i = 0; i < sizeof(hdr); i++)
+		{
+			if (((const BYTE*)&hdr)[i])
+			{
+				bZero = FALSE;
+				break;
+			}
+		}
+
+		if (bZero)
+		{
+			return copyRange(uiPos, _uicbInSz - uiPos) ? XC_Success : XC_FailedFileWrite;
+		}
+
+		ULONGLONG uicbData = 0;
+		if (!isTarHeaderValid(hdr) ||
+			!parseTarNumber(hdr.size, sizeof(hdr.size), uicbData))
+		{
+			CSigRem::ReportOSError(ERROR_BAD_FORMAT, L"TAR header is corrupted at offset %llu in: %s", uiPos, _strInputFile.c_str());
+			return XC_FailedToOpen;
+		}
+
+		//Size from a preceding PAX header overrides the one in the header
+		BOOL bSizeOverridden = bPaxSize;
+		if (bPaxSize)
+		{
+			uicbData = uiPaxSize;
+			bPaxSize = FALSE;
+		}
+
+		ULONGLONG uiDataOffset = uiPos + sizeof(hdr);
+		ULONGLONG uicbPadded = (uicbData + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE * TAR_BLOCK_SIZE;
+		if (uiDataOffset + uicbData > _uicbInSz)
+		{
+			CSigRem::ReportOSError(ERROR_BAD_FORMAT, L"TAR archive is truncated: %s", _strInputFile.c_str());
+			return XC_FailedToOpen;
+		}
+
+		//Regular files only (pseudo-entries like PAX and GNU long name headers are not counted)
+		BOOL bFile = hdr.typeflag == '0' || hdr.typeflag == '\0' || hdr.typeflag == '7';
+		if (bFile)
+			_stats.nEntries++;
+
+		if (hdr.typeflag == 'x')
+		{
+			//PAX extended header for the next entry - see if it has its size ("<len> size=<value>\n" records)
+			if (uicbData < INT_MAX)
+			{
+				arrData.resize((size_t)uicbData);
+				if (uicbData &&
+					!readAt(uiDataOffset, arrData.data(), (DWORD)uicbData))
+				{
+					CSigRem::ReportOSError(::GetLastError(), L"Failed to read TAR archive: %s", _strInputFile.c_str());
+					return XC_FailedToOpen;
+				}
+
+				for (size_t nRec = 0; nRec < arrData.size(); )
+				{
+					size_t nLen = 0;
+					size_t i = nRec;
+					for (; i < arrData.size() && arrData[i] >= '0' && arrData[i] <= '9'; i++)
+					{
+						nLen = nLen * 10 + (arrData[i] - '0');
+					}
+
+					if (!nLen ||
+						nRec + nLen > arrData.size() ||
+						i >= nRec + nLen ||
+						arrData[i] != ' ')
+					{
+						//Malformed - ignore the rest
+						break;
+					}
+
+					static const char kSize[] = "size=";
+					if (nRec + nLen - (i + 1) > SIZEOF_TEXT(kSize) &&
+						memcmp(&arrData[i + 1], kSize, SIZEOF_TEXT(kSize)) == 0)
+					{
+						ULONGLONG uiVal = 0;
+						for (size_t d = i + 1 + SIZEOF_TEXT(kSize); d < nRec + nLen && arrData[d] >= '0' && arrData[d] <= '9'; d++)
+						{
+							uiVal = uiVal * 10 + (arrData[d] - '0');
+						}
+
+						uiPaxSize = uiVal;
+						bPaxSize = TRUE;
+					}
+
+					nRec += nLen;
+				}
+			}
+		}
+
+		BOOL bStripped = FALSE;
+		if (bFile &&
+			!bSizeOverridden &&
+			uicbData >= sizeof(IMAGE_DOS_HEADER) &&
+			uicbData < INT_MAX)
+		{
+			//Look at the beginning of the data first, so that we don't read other files into memory
+			WORD wMagic = 0;
+			if (!readAt(uiDataOffset, &wMagic, sizeof(wMagic)))
+			{
+				CSigRem::ReportOSError(::GetLastError(), L"Failed to read TAR archive: %s", _strInputFile.c_str());
+				return XC_FailedToOpen;
+			}
+
+			if (wMagic == IMAGE_DOS_SIGNATURE)
+			{
+				arrData.resize((size_t)uicbPadded);
+				if (!readAt(uiDataOffset, arrData.data(), (DWORD)uicbData))
+				{
+					CSigRem::ReportOSError(::GetLastError(), L"Failed to read TAR archive: %s", _strInputFile.c_str());
+					return XC_FailedToOpen;
+				}
+
+				//Name is the prefix and the name (for POSIX archives)
+				std::string strRawName;
+				if (memcmp(hdr.magic, "ustar", 5) == 0 &&
+					hdr.prefix[0])
+				{
+					strRawName.assign(hdr.prefix, strnlen(hdr.prefix, sizeof(hdr.prefix)));
+					strRawName += '/';
+				}
+
+				strRawName.append(hdr.name, strnlen(hdr.name, sizeof(hdr.name)));
+				std::wstring strName = entryName(strRawName.c_str(), strRawName.size(), CP_UTF8);
+
+				ULONG uicbNewSz = 0;
+				if (stripEntry(arrData.data(), (ULONG)uicbData, uicbNewSz, strName.c_str()) == XC_Success)
+				{
+					//Write new header and data (padded with zeros to the block size)
+					TAR_HEADER hdrNew = hdr;
+					verify(SUCCEEDED(::StringCchPrintfA(hdrNew.size, sizeof(hdrNew.size), "%011o", uicbNewSz)));
+					setTarChecksum(hdrNew);
+
+					size_t szcbNewPadded = (uicbNewSz + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE * TAR_BLOCK_SIZE;
+					memset(arrData.data() + uicbNewSz, 0, szcbNewPadded - uicbNewSz);
+
+					if (!write(&hdrNew, sizeof(hdrNew)) ||
+						!write(arrData.data(), szcbNewPadded))
+					{
+						return XC_FailedFileWrite;
+					}
+
+					bStripped = TRUE;
+				}
+			}
+		}
+
+		if (!bStripped)
+		{
+			//Copy it as-is (last block may be cut short in a truncated archive)
+			if (!copyRange(uiPos, std::min<ULONGLONG>(sizeof(hdr) + uicbPadded, _uicbInSz - uiPos)))
+				return XC_FailedFileWrite;
+		}
+
+		uiPos = uiDataOffset + uicbPadded;
+	}
+}
+
+
+EXIT_CODES CSigRemArchive::stripEntry(BYTE* pData, ULONG szcbData, ULONG& uicbNewSz, LPCTSTR pStrEntryName)
+{
+	//Remove digital signature from an archive entry in memory, and update stats
+	//'pData' = contents of the entry - it will be modified
+	//'szcbData' = size of 'pData' in BYTEs
+	//'uicbNewSz' = receives new size of the entry in BYTEs (only if result is XC_Success)
+	//'pStrEntryName' = name of the entry in the archive (for messages)
+	//RETURN:
+	//		= Result of CSigRem::RemoveDigitalSignatureFromMemory()
+	int nOSErr = 0;
+	EXIT_CODES nResult = CSigRem::RemoveDigitalSignatureFromMemory(pData, szcbData, uicbNewSz, nOSErr);
+
+	switch (nResult)
+	{
+	case XC_Success:
+		_stats.nStripped++;
+		_stats.uicbSaved += szcbData - uicbNewSz;
+		if (!(_dwFlags & SRF_QUIET_SUCCESS))
+			wprintf(L"  Removed signature: %s\n", pStrEntryName);
+		break;
+
+	case XC_BinaryHasNoSignature:
+		_stats.nNoSignature++;
+		break;
+
+	case XC_Not_PE_File:
+		break;
+
+	default:
+		_stats.nFailed++;
+		CSigRem::ReportOSError(nOSErr, L"Failed to remove signature from \"%s\" in: %s", pStrEntryName, _strInputFile.c_str());
+		break;
+	}
+
+	return nResult;
+}
+
+
+BOOL CSigRemArchive::readAt(ULONGLONG uiOffset, void* pBuff, DWORD dwcbSz)
+{
+	//Read exactly 'dwcbSz' BYTEs from the input archive at 'uiOffset'
+	//RETURN:
+	//		= TRUE if success
+	OVERLAPPED ov = {};
+	ov.Offset = (DWORD)uiOffset;
+	ov.OffsetHigh = (DWORD)(uiOffset >> 32);
+
+	DWORD dwcbRead = 0;
+	if (!::ReadFile(_hIn, pBuff, dwcbSz, &dwcbRead, &ov))
+		return FALSE;
+
+	if (dwcbRead != dwcbSz)
+	{
+		::SetLastError(ERROR_HANDLE_EOF);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+
+BOOL CSigRemArchive::write(const void* pData, size_t szcbData)
+{
+	//Append data to the output archive (through '_pOutBuff')
+	//RETURN:
+	//		= TRUE if success (errors are reported)
+	const BYTE* pSrc = (const BYTE*)pData;
+
+	while (szcbData)
+	{
+		if (!_nOutBuffUsed &&
+			szcbData >= ARCHIVE_IO_BUFF_SIZE)
+		{
+			//Large chunk - no need to copy it
+			DWORD dwcbChunk = (DWORD)std::min<size_t>(szcbData, 0x40000000);
+			DWORD dwcbWrtn = 0;
+			if (!::WriteFile(_hOut, pSrc, dwcbChunk, &dwcbWrtn, NULL) ||
+				dwcbWrtn != dwcbChunk)
+			{
+				CSigRem::ReportOSError(::GetLastError(), L"Failed to write to destination file: %s", _strOutputFile.c_str());
+				return FALSE;
+			}
+
+			_uiOutPos += dwcbChunk;
+			pSrc += dwcbChunk;
+			szcbData -= dwcbChunk;
+			continue;
+		}
+
+		size_t szcbCopy = std::min<size_t>(szcbData, ARCHIVE_IO_BUFF_SIZE - _nOutBuffUsed);
+		memcpy(_pOutBuff + _nOutBuffUsed, pSrc, szcbCopy);
+
+		_nOutBuffUsed += szcbCopy;
+		_uiOutPos += szcbCopy;
+		pSrc += szcbCopy;
+		szcbData -= szcbCopy;
+
+		if (_nOutBuffUsed == ARCHIVE_IO_BUFF_SIZE &&
+			!flush())
+		{
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+
+BOOL CSigRemArchive::flush()
+{
+	//Write out '_pOutBuff'
+	//RETURN:
+	//		= TRUE if success (errors are reported)
+	if (_nOutBuffUsed)
+	{
+		DWORD dwcbWrtn = 0;
+		if (!::WriteFile(_hOut, _pOutBuff, (DWORD)_nOutBuffUsed, &dwcbWrtn, NULL) ||
+			dwcbWrtn != _nOutBuffUsed)
+		{
+			CSigRem::ReportOSError(::GetLastError(), L"Failed to write to destination file: %s", _strOutputFile.c_str());
+			return FALSE;
+		}
+
+		_nOutBuffUsed = 0;
+	}
+
+	return TRUE;
+}
+
+
+BOOL CSigRemArchive::copyRange(ULONGLONG uiOffset, ULONGLONG uicbSz)
+{
+	//Copy data from the input archive to the output one
+	//RETURN:
+	//		= TRUE if success (errors are reported)
+	while (uicbSz)
+	{
+		DWORD dwcbChunk = (DWORD)std::min<ULONGLONG>(uicbSz, ARCHIVE_IO_BUFF_SIZE);
+		if (!readAt(uiOffset, _pCopyBuff, dwcbChunk))
+		{
+			CSigRem::ReportOSError(::GetLastError(), L"Failed to read from archive: %s", _strInputFile.c_str());
+			return FALSE;
+		}
+
+		if (!write(_pCopyBuff, dwcbChunk))
+			return FALSE;
+
+		uiOffset += dwcbChunk;
+		uicbSz -= dwcbChunk;
+	}
+
+	return TRUE;
+}
+
+
+std::wstring CSigRemArchive::entryName(const char* pName, size_t szcbName, UINT nCodePage)
+{
+	//RETURN:
+	//		= Entry name from the archive converted from 'nCodePage'
+	std::wstring strName;
+
+	int nchLen = ::MultiByteToWideChar(nCodePage, 0, pName, (int)szcbName, NULL, 0);
+	if (nchLen > 0)
+	{
+		strName.resize(nchLen);
+		::MultiByteToWideChar(nCodePage, 0, pName, (int)szcbName, &strName[0], nchLen);
+	}
+
+	return strName;
+}
+
+
+BOOL CSigRemArchive::parseTarNumber(const char* pField, size_t szcbField, ULONGLONG& uiValue)
+{
+	//Parse numeric field of a TAR header
+	//RETURN:
+	//		= TRUE if success
+	uiValue = 0;
+
+	if ((BYTE)pField[0] & 0x80)
+	{
+		//Base-256 (GNU) - big-endian number after the marker bit (we don't take negative ones)
+		if ((BYTE)pField[0] & 0x40)
+			return FALSE;
+
+		for (size_t i = 0; i < szcbField; i++)
+		{
+			if (uiValue >> 56)
+				return FALSE;
+
+			uiValue = (uiValue << 8) | (BYTE)(i ? pField[i] : pField[i] & 0x7F);
+		}
+
+		return TRUE;
+	}
+
+	//Octal, optionally padded with spaces and terminated with a space or null
+	size_t i = 0;
+	for (; i < szcbField && pField[i] == ' '; i++);
+
+	for (; i < szcbField && pField[i] >= '0' && pField[i] <= '7'; i++)
+	{
+		uiValue = (uiValue << 3) | (pField[i] - '0');
+	}
+
+	return i == szcbField || pField[i] == ' ' || pField[i] == '\0';
+}
+
+
+BOOL CSigRemArchive::isTarHeaderValid(const TAR_HEADER& hdr)
+{
+	//RETURN:
+	//		= TRUE if checksum of the header is correct
+	ULONGLONG uiChecksum = 0;
+	if (!parseTarNumber(hdr.chksum, sizeof(hdr.chksum), uiChecksum))
+		return FALSE;
+
+	//Sum of all BYTEs with the checksum field taken as spaces (some old archives used signed chars)
+	ULONGLONG uiSum = 0;
+	LONGLONG iSum = 0;
+	const BYTE* p = (const BYTE*)&hdr;
+	for (size_t i = 0; i < sizeof(hdr); i++)
+	{
+		BOOL bChkSum = i >= offsetof(TAR_HEADER, chksum) && i < offsetof(TAR_HEADER, chksum) + sizeof(hdr.chksum);
+		uiSum += bChkSum ? ' ' : p[i];
+		iSum += bChkSum ? ' ' : (signed char)p[i];
+	}
+
+	return uiChecksum == uiSum ||
+		(LONGLONG)uiChecksum == iSum;
+}
+
+
+void CSigRemArchive::setTarChecksum(TAR_HEADER& hdr)
+{
+	//Recompute header checksum after it was modified
+	memset(hdr.chksum, ' ', sizeof(hdr.chksum));
+
+	DWORD dwSum = 0;
+	const BYTE* p = (const BYTE*)&hdr;
+	for (size_t i = 0; i < sizeof(hdr); i++)
+	{
+		dwSum += p[i];
+	}
+
+	//Six octal digits, null and space (the way tar writes it)
+	verify(SUCCEEDED(::StringCchPrintfA(hdr.chksum, sizeof(hdr.chksum), "%06o", dwSum)));
+	hdr.chksum[7] = ' ';
+}
+
+
+void CSigRemArchive::showSummary()
+{
+	//Output archive results to the console
+	wprintf(
+		L"\n"
+		L"Files in archive:       %llu\n"
+		L"Signatures removed:     %llu\n"
+		L"PE without signature:   %llu\n"
+		L"Failed:                 %llu\n"
+		L"Bytes removed:          %llu\n"
+		,
+		_stats.nEntries,
+		_stats.nStripped,
+		_stats.nNoSignature,
+		_stats.nFailed,
+		_stats.uicbSaved
+	);
+}
@@ -0,0 +1,199 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+//Remove digital signatures from PE files inside ZIP and TAR archives, without extracting them to disk
+#pragma once
+
+#include "CSigRem.h"
+
+#include <string>
+#include <vector>
+
+
+
+#define ARCHIVE_IO_BUFF_SIZE 0x100000		//Size of the buffers for reading and writing archives, in BYTEs
+#define ARCHIVE_PEEK_SIZE 0x10000			//Max size of compressed data to read to see if an entry is a PE file, in BYTEs
+#define TAR_BLOCK_SIZE 512					//TAR archives consist of blocks of this size, in BYTEs
+
+#define ZIP_SIG_LOCAL_HEADER 0x04034b50
+#define ZIP_SIG_CENTRAL_HEADER 0x02014b50
+#define ZIP_SIG_END_OF_CD 0x06054b50
+#define ZIP_SIG_DATA_DESCRIPTOR 0x08074b50
+
+#define ZIP_FLAG_ENCRYPTED 0x1				//Entry is encrypted
+#define ZIP_FLAG_DEFLATE_OPTIONS 0x6		//Compression options for deflate
+#define ZIP_FLAG_DATA_DESCRIPTOR 0x8		//CRC and sizes follow the data (and are 0 in the local header)
+#define ZIP_FLAG_UTF8 0x800					//File name is in UTF-8
+
+#define ZIP_METHOD_STORED 0
+#define ZIP_METHOD_DEFLATED 8
+
+
+
+#pragma pack(push, 1)
+
+struct ZIP_LOCAL_HEADER
+{
+	DWORD dwSignature;						//ZIP_SIG_LOCAL_HEADER
+	WORD wVersionNeeded;
+	WORD wFlags;							//Combination of ZIP_FLAG_*
+	WORD wMethod;							//ZIP_METHOD_*
+	WORD wModTime;
+	WORD wModDate;
+	DWORD dwCrc32;
+	DWORD dwcbCompressed;
+	DWORD dwcbUncompressed;
+	WORD wcbFileName;						//Size of the file name that follows, in BYTEs
+	WORD wcbExtra;							//Size of the extra field that follows the file name, in BYTEs
+};
+
+struct ZIP_CENTRAL_HEADER
+{
+	DWORD dwSignature;						//ZIP_SIG_CENTRAL_HEADER
+	WORD wVersionMadeBy;
+	WORD wVersionNeeded;
+	WORD wFlags;							//Combination of ZIP_FLAG_*
+	WORD wMethod;							//ZIP_METHOD_*
+	WORD wModTime;
+	WORD wModDate;
+	DWORD dwCrc32;
+	DWORD dwcbCompressed;
+	DWORD dwcbUncompressed;
+	WORD wcbFileName;						//Size of the file name that follows, in BYTEs
+	WORD wcbExtra;							//Size of the extra field that follows the file name, in BYTEs
+	WORD wcbComment;						//Size of the comment that follows the extra field, in BYTEs
+	WORD wDiskStart;
+	WORD wInternalAttrs;
+	DWORD dwExternalAttrs;
+	DWORD dwLocalHeaderOffset;				//Offset of the ZIP_LOCAL_HEADER from the beginning of the archive
+};
+
+struct ZIP_END_OF_CD
+{
+	DWORD dwSignature;						//ZIP_SIG_END_OF_CD
+	WORD wDisk;
+	WORD wDiskWithCD;
+	WORD wEntriesOnDisk;
+	WORD wEntries;
+	DWORD dwcbCD;							//Size of the central directory, in BYTEs
+	DWORD dwCDOffset;						//Offset of the central directory from the beginning of the archive
+	WORD wcbComment;						//Size of the archive comment that follows, in BYTEs
+};
+
+struct TAR_HEADER
+{
+	char name[100];
+	char mode[8];
+	char uid[8];
+	char gid[8];
+	char size[12];							//Octal, or base-256 if the high bit of the first BYTE is set
+	char mtime[12];
+	char chksum[8];							//Octal sum of all header BYTEs, with this field taken as spaces
+	char typeflag;
+	char linkname[100];
+	char magic[6];							//"ustar" for POSIX archives
+	char version[2];
+	char uname[32];
+	char gname[32];
+	char devmajor[8];
+	char devminor[8];
+	char prefix[155];						//Path prefix for 'name' (POSIX archives only)
+	char pad[12];
+};
+
+#pragma pack(pop)
+
+
+static_assert(sizeof(ZIP_LOCAL_HEADER) == 30, "Bad ZIP_LOCAL_HEADER");
+static_assert(sizeof(ZIP_CENTRAL_HEADER) == 46, "Bad ZIP_CENTRAL_HEADER");
+static_assert(sizeof(ZIP_END_OF_CD) == 22, "Bad ZIP_END_OF_CD");
+static_assert(sizeof(TAR_HEADER) == TAR_BLOCK_SIZE, "Bad TAR_HEADER");
+
+
+
+enum ARCHIVE_TYPE {
+	AT_Unknown,
+	AT_Zip,
+	AT_Tar,
+};
+
+
+struct ARCHIVE_STATS
+{
+	ULONGLONG nEntries;						//Number of entries in the archive
+	ULONGLONG nStripped;					//Number of PE entries with removed signature
+	ULONGLONG nNoSignature;					//Number of PE entries without a signature
+	ULONGLONG nFailed;						//Number of PE entries that failed to process (they are copied as-is)
+	ULONGLONG uicbSaved;					//Number of BYTEs removed from stripped entries (before compression)
+};
+
+
+struct ZIP_ENTRY
+{
+	size_t nCDOffset;						//Offset of its ZIP_CENTRAL_HEADER in the central directory
+	DWORD dwLocalHeaderOffset;				//Offset of its ZIP_LOCAL_HEADER in the archive
+};
+
+
+
+class CSigRemArchive
+{
+public:
+	CSigRemArchive();
+	~CSigRemArchive();
+
+	EXIT_CODES ProcessArchive(LPCTSTR pStrFilePath, LPCTSTR pStrOutputFile = NULL, DWORD dwFlags = 0);
+
+	static DWORD Crc32(DWORD dwCrc, const BYTE* pData, size_t szcbData);
+
+protected:
+	ARCHIVE_TYPE detectType();
+	EXIT_CODES processZip();
+	EXIT_CODES processTar();
+	EXIT_CODES stripEntry(BYTE* pData, ULONG szcbData, ULONG& uicbNewSz, LPCTSTR pStrEntryName);
+	BOOL readAt(ULONGLONG uiOffset, void* pBuff, DWORD dwcbSz);
+	BOOL write(const void* pData, size_t szcbData);
+	BOOL flush();
+	BOOL copyRange(ULONGLONG uiOffset, ULONGLONG uicbSz);
+	static std::wstring entryName(const char* pName, size_t szcbName, UINT nCodePage);
+	static BOOL parseTarNumber(const char* pField, size_t szcbField, ULONGLONG& uiValue);
+	static BOOL isTarHeaderValid(const TAR_HEADER& hdr);
+	static void setTarChecksum(TAR_HEADER& hdr);
+	void showSummary();
+
+private:
+	std::wstring _strInputFile;				//Input archive path
+	std::wstring _strOutputFile;			//Output archive path
+	DWORD _dwFlags;							//Combination of SIGREM_FLAGS
+	HANDLE _hIn;							//Input archive, or INVALID_HANDLE_VALUE
+	HANDLE _hOut;							//Output archive, or INVALID_HANDLE_VALUE
+	ULONGLONG _uicbInSz;					//Size of the input archive in BYTEs
+	ULONGLONG _uiOutPos;					//Number of BYTEs written into the output archive (including '_pOutBuff')
+	BYTE* _pOutBuff;						//Buffer for writing the output archive
+	size_t _nOutBuffUsed;					//Number of BYTEs in '_pOutBuff'
+	BYTE* _pCopyBuff;						//Buffer for copying data from input to output
+	ARCHIVE_STATS _stats;
+};
+
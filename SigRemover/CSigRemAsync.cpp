@@ -0,0 +1,690 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+
+#include "CSigRemAsync.h"
+
+
+
+
+CSigRemAsync::CSigRemAsync()
+{
+	::InitializeSRWLock(&_lock);
+	_uiLastID = 0;
+	_nOpen = 0;
+	_nMaxOpen = ASYNC_DEFAULT_MAX_OPEN;
+
+	//Signaled while there are no operations
+	_hIdleEvent = ::CreateEvent(NULL, TRUE, TRUE, NULL);
+	assert(_hIdleEvent);
+}
+
+
+CSigRemAsync::~CSigRemAsync()
+{
+	Close();
+
+	if (_hIdleEvent)
+	{
+		verify(::CloseHandle(_hIdleEvent));
+		_hIdleEvent = NULL;
+	}
+}
+
+
+BOOL CSigRemAsync::Init(DWORD nThreads, DWORD nMaxOpen)
+{
+	//Start threads that will run all operations (they don't block on I/O, so a few are enough for many operations)
+	//'nThreads' = number of threads, or 0 to use CWorkerPool::GetDefaultThreadCount()
+	//'nMaxOpen' = number of operations that may have files open and buffers allocated at once, or 0 for ASYNC_DEFAULT_MAX_OPEN
+	//RETURN:
+	//		= TRUE if success
+	Close();
+
+	if (!_hIdleEvent)
+	{
+		::SetLastError(ERROR_OUTOFMEMORY);
+		return FALSE;
+	}
+
+	_nMaxOpen = nMaxOpen ? nMaxOpen : ASYNC_DEFAULT_MAX_OPEN;
+
+	return _workers.Init(nThreads);
+}
+
+
+SIGREM_ASYNC_ID CSigRemAsync::Submit(LPCTSTR pStrInputFile, LPCTSTR pStrOutputFile, PFN_SIGREM_ASYNC_DONE pfnDone, PVOID pContext, DWORD dwTimeoutMs)
+{
+	//Start removing digital signature from a file (nothing is reported to the console)
+	//INFO: 'pfnDone' is always invoked once for an accepted operation, and it may be invoked even before this function returns.
+	//'pStrInputFile' = input PE file path
+	//'pStrOutputFile' = output file path (it is created when the input was read, and deleted if the operation fails after that)
+	//'pfnDone' = callback to invoke when the operation is done
+	//'pContext' = context for 'pfnDone'
+	//'dwTimeoutMs' = deadline from now, in ms, after which the operation is stopped with XC_TimedOut, or INFINITE for none
+	//RETURN:
+	//		= ID of the operation (for Cancel())
+	//		= 0 if error (check GetLastError() for info) - 'pfnDone' will not be invoked
+	PTP_CALLBACK_ENVIRON pEnv = _workers.GetEnvironment();
+	if (!pEnv)
+	{
+		//Not initialized
+		assert(false);
+		::SetLastError(ERROR_INVALID_STATE);
+		return 0;
+	}
+
+	if (!pStrInputFile ||
+		!pStrInputFile[0] ||
+		!pStrOutputFile ||
+		!pStrOutputFile[0] ||
+		!pfnDone)
+	{
+		::SetLastError(ERROR_INVALID_PARAMETER);
+		return 0;
+	}
+
+	SIGREM_ASYNC_OP* pOp = new (std::nothrow) SIGREM_ASYNC_OP;
+	if (!pOp)
+	{
+		::SetLastError(ERROR_OUTOFMEMORY);
+		return 0;
+	}
+
+	pOp->pThis = this;
+	pOp->uiID = 0;
+	pOp->strInputFile = pStrInputFile;
+	pOp->strOutputFile = pStrOutputFile;
+	pOp->pfnDone = pfnDone;
+	pOp->pContext = pContext;
+
+	::InitializeSRWLock(&pOp->lock);
+	pOp->nStopResult = 0;
+	pOp->stage = AOS_Queued;
+	pOp->bHasSlot = FALSE;
+	pOp->pTimer = NULL;
+	pOp->hFile = INVALID_HANDLE_VALUE;
+	pOp->pIo = NULL;
+	memset(&pOp->ov, 0, sizeof(pOp->ov));
+	pOp->pBuff = NULL;
+	pOp->uicbSize = 0;
+	pOp->uicbDone = 0;
+	memset(&pOp->results, 0, sizeof(pOp->results));
+
+	if (dwTimeoutMs != INFINITE)
+	{
+		pOp->pTimer = ::CreateThreadpoolTimer(onDeadline, pOp, pEnv);
+		if (!pOp->pTimer)
+		{
+			//Error
+			int nOSErr = ::GetLastError();
+			delete pOp;
+			::SetLastError(nOSErr);
+			return 0;
+		}
+	}
+
+	::AcquireSRWLockExclusive(&_lock);
+
+	SIGREM_ASYNC_ID uiID = ++_uiLastID;
+	pOp->uiID = uiID;
+	_mapOps[uiID] = pOp;
+
+	::ResetEvent(_hIdleEvent);
+
+	//Start the deadline now, so that it includes time in the queue (it can't fire until we release the lock)
+	if (pOp->pTimer)
+	{
+		ULARGE_INTEGER uliDue;
+		uliDue.QuadPart = (ULONGLONG)(-(LONGLONG)dwTimeoutMs * 10000);		//Relative, in 100 ns units
+
+		FILETIME ftDue;
+		ftDue.dwLowDateTime = uliDue.LowPart;
+		ftDue.dwHighDateTime = uliDue.HighPart;
+
+		::SetThreadpoolTimer(pOp->pTimer, &ftDue, 0, 0);
+	}
+
+	BOOL bStart = _nOpen < _nMaxOpen;
+	if (bStart)
+	{
+		_nOpen++;
+		pOp->bHasSlot = TRUE;
+	}
+	else
+	{
+		_queWaiting.push_back(pOp);
+	}
+
+	::ReleaseSRWLockExclusive(&_lock);
+
+	//(Don't touch 'pOp' after this point)
+	if (bStart &&
+		!dispatchOp(pOp))
+	{
+		//Error
+		finishOp(pOp, XC_GEN_FAILURE, ::GetLastError());
+	}
+
+	return uiID;
+}
+
+
+BOOL CSigRemAsync::Cancel(SIGREM_ASYNC_ID uiID)
+{
+	//Stop an operation - it will finish with XC_Cancelled (unless it's finishing already)
+	//RETURN:
+	//		= TRUE if the operation was found
+	BOOL bRes = FALSE;
+
+	::AcquireSRWLockExclusive(&_lock);
+
+	std::map<SIGREM_ASYNC_ID, SIGREM_ASYNC_OP*>::iterator it = _mapOps.find(uiID);
+	if (it != _mapOps.end())
+	{
+		stopOp(it->second, XC_Cancelled);
+		bRes = TRUE;
+	}
+
+	::ReleaseSRWLockExclusive(&_lock);
+
+	return bRes;
+}
+
+
+void CSigRemAsync::CancelAll()
+{
+	//Stop all operations - they will finish with XC_Cancelled (unless they are finishing already)
+	::AcquireSRWLockExclusive(&_lock);
+
+	for (std::map<SIGREM_ASYNC_ID, SIGREM_ASYNC_OP*>::iterator it = _mapOps.begin(); it != _mapOps.end(); ++it)
+	{
+		stopOp(it->second, XC_Cancelled);
+	}
+
+	::ReleaseSRWLockExclusive(&_lock);
+}
+
+
+void CSigRemAsync::WaitAll()
+{
+	//Wait for all operations to finish, including their callbacks (must not be called from a callback)
+	if (_hIdleEvent)
+	{
+		verify(::WaitForSingleObject(_hIdleEvent, INFINITE) == WAIT_OBJECT_0);
+	}
+}
+
+
+void CSigRemAsync::Close()
+{
+	//Wait for all operations to finish and stop the threads (call CancelAll() first to not wait for them)
+	if (_workers.GetEnvironment())
+	{
+		WaitAll();
+		_workers.Close();
+	}
+
+	assert(_mapOps.empty());
+	assert(_queWaiting.empty());
+}
+
+
+size_t CSigRemAsync::GetPendingCount()
+{
+	//RETURN:
+	//		= Number of operations that did not finish yet
+	::AcquireSRWLockShared(&_lock);
+	size_t nCount = _mapOps.size();
+	::ReleaseSRWLockShared(&_lock);
+
+	return nCount;
+}
+
+
+VOID CALLBACK CSigRemAsync::onStart(PTP_CALLBACK_INSTANCE Instance, PVOID pContext)
+{
+	UNREFERENCED_PARAMETER(Instance);
+
+	SIGREM_ASYNC_OP* pOp = (SIGREM_ASYNC_OP*)pContext;
+	pOp->pThis->startOp(pOp);
+}
+
+
+VOID CALLBACK CSigRemAsync::onIoDone(PTP_CALLBACK_INSTANCE Instance, PVOID pContext, PVOID pOverlapped, ULONG nIoResult, ULONG_PTR nBytesTransferred, PTP_IO pIo)
+{
+	UNREFERENCED_PARAMETER(Instance);
+	UNREFERENCED_PARAMETER(pIo);
+
+	SIGREM_ASYNC_OP* pOp = (SIGREM_ASYNC_OP*)pContext;
+	assert(pOverlapped == &pOp->ov);
+	UNREFERENCED_PARAMETER(pOverlapped);
+
+	pOp->pThis->ioDone(pOp, nIoResult, (ULONG)nBytesTransferred);
+}
+
+
+VOID CALLBACK CSigRemAsync::onDeadline(PTP_CALLBACK_INSTANCE Instance, PVOID pContext, PTP_TIMER pTimer)
+{
+	UNREFERENCED_PARAMETER(Instance);
+	UNREFERENCED_PARAMETER(pTimer);
+
+	//INFO: finishOp() waits for this callback before it frees the operation
+	SIGREM_ASYNC_OP* pOp = (SIGREM_ASYNC_OP*)pContext;
+	CSigRemAsync* pThis = pOp->pThis;
+
+	::AcquireSRWLockExclusive(&pThis->_lock);
+	pThis->stopOp(pOp, XC_TimedOut);
+	::ReleaseSRWLockExclusive(&pThis->_lock);
+}
+
+
+void CSigRemAsync::startOp(SIGREM_ASYNC_OP* pOp)
+{
+	//Open the input file and start reading it (on a pool thread)
+	if (pOp->nStopResult)
+	{
+		//Stopped before it started
+		finishOp(pOp, (EXIT_CODES)pOp->nStopResult, ERROR_OPERATION_ABORTED);
+		return;
+	}
+
+	int nOSErr = 0;
+
+	HANDLE hFile = ::CreateFile(pOp->strInputFile.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (hFile != INVALID_HANDLE_VALUE)
+	{
+		LARGE_INTEGER liFileSz = {};
+		if (::GetFileSizeEx(hFile, &liFileSz))
+		{
+			pOp->results.uicbInputSz = (ULONGLONG)liFileSz.QuadPart;
+
+			//Make sure the file is not too large
+			if ((ULONGLONG)liFileSz.QuadPart < INT_MAX)
+			{
+				ULONG dwcbFileSz = (ULONG)liFileSz.QuadPart;
+
+				pOp->pBuff = new (std::nothrow) BYTE[dwcbFileSz ? dwcbFileSz : 1];
+				if (pOp->pBuff)
+				{
+					if (!dwcbFileSz)
+					{
+						//Nothing to read
+						verify(::CloseHandle(hFile));
+						processData(pOp);
+						return;
+					}
+
+					//(It takes 'hFile')
+					if (beginStage(pOp, AOS_Reading, hFile, dwcbFileSz, nOSErr))
+					{
+						//Reading - don't touch 'pOp' after this point
+						return;
+					}
+
+					hFile = INVALID_HANDLE_VALUE;
+				}
+				else
+					nOSErr = ERROR_OUTOFMEMORY;
+			}
+			else
+				nOSErr = 8312;
+		}
+		else
+			nOSErr = ::GetLastError();
+
+		if (hFile != INVALID_HANDLE_VALUE)
+		{
+			verify(::CloseHandle(hFile));
+		}
+	}
+	else
+		nOSErr = ::GetLastError();
+
+	finishOp(pOp, pOp->nStopResult ? (EXIT_CODES)pOp->nStopResult : XC_FailedToOpen, nOSErr);
+}
+
+
+void CSigRemAsync::ioDone(SIGREM_ASYNC_OP* pOp, ULONG nIoResult, ULONG uicbTransferred)
+{
+	//Read or write has completed (on a pool thread)
+	//'nIoResult' = OS error code for the I/O
+	//'uicbTransferred' = number of BYTEs read or written
+	EXIT_CODES nFailure = pOp->stage == AOS_Reading ? XC_FailedToOpen : XC_FailedFileWrite;
+
+	if (nIoResult != NO_ERROR)
+	{
+		//Error (or it was stopped)
+		finishOp(pOp, pOp->nStopResult ? (EXIT_CODES)pOp->nStopResult : nFailure, nIoResult);
+		return;
+	}
+
+	if (!uicbTransferred)
+	{
+		//Input file got shorter, or the disk is full
+		finishOp(pOp, nFailure, pOp->stage == AOS_Reading ? ERROR_HANDLE_EOF : ERROR_DISK_FULL);
+		return;
+	}
+
+	pOp->uicbDone += uicbTransferred;
+	assert(pOp->uicbDone <= pOp->uicbSize);
+
+	if (pOp->uicbDone < pOp->uicbSize)
+	{
+		//Next chunk
+		int nOSErr = 0;
+		if (!issueIo(pOp, nOSErr))
+		{
+			finishOp(pOp, pOp->nStopResult ? (EXIT_CODES)pOp->nStopResult : nFailure, nOSErr);
+		}
+
+		return;
+	}
+
+	//Done with this file
+	closeFile(pOp);
+
+	if (pOp->stage == AOS_Reading)
+	{
+		processData(pOp);
+	}
+	else
+	{
+		finishOp(pOp, XC_Success, 0);
+	}
+}
+
+
+void CSigRemAsync::processData(SIGREM_ASYNC_OP* pOp)
+{
+	//Remove signature from the input file data, and start writing the output file (on a pool thread)
+	if (pOp->nStopResult)
+	{
+		finishOp(pOp, (EXIT_CODES)pOp->nStopResult, ERROR_OPERATION_ABORTED);
+		return;
+	}
+
+	ULONG uicbNewFileSz = 0;
+	int nOSErr = 0;
+	EXIT_CODES nResult = CSigRem::RemoveDigitalSignatureFromMemory(pOp->pBuff, (ULONG)pOp->results.uicbInputSz, uicbNewFileSz, nOSErr);
+	if (nResult != XC_Success)
+	{
+		finishOp(pOp, nResult, nOSErr);
+		return;
+	}
+
+	pOp->results.uicbOutputSz = uicbNewFileSz;
+
+	//Remove the existing output first (don't write through it - it may be a hard link shared with other outputs)
+	HANDLE hFile = INVALID_HANDLE_VALUE;
+	if (::DeleteFile(pOp->strOutputFile.c_str()) ||
+		::GetLastError() == ERROR_FILE_NOT_FOUND)
+	{
+		hFile = ::CreateFile(pOp->strOutputFile.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, NULL);
+	}
+
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		finishOp(pOp, XC_FailedFileWrite, ::GetLastError());
+		return;
+	}
+
+	//(It takes 'hFile')
+	if (!beginStage(pOp, AOS_Writing, hFile, uicbNewFileSz, nOSErr))
+	{
+		finishOp(pOp, pOp->nStopResult ? (EXIT_CODES)pOp->nStopResult : XC_FailedFileWrite, nOSErr);
+	}
+
+	//Writing - don't touch 'pOp' after this point
+}
+
+
+BOOL CSigRemAsync::beginStage(SIGREM_ASYNC_OP* pOp, ASYNC_OP_STAGE stage, HANDLE hFile, ULONG uicbSize, int& nOSErr)
+{
+	//Bind 'hFile' to the pool and issue the first read or write for the 'stage'
+	//INFO: 'hFile' is owned by 'pOp' after this call (even if it fails)
+	//RETURN:
+	//		= TRUE if I/O was issued - 'pOp' may be finished on another thread already
+	//		= FALSE if error (check 'nOSErr' for info)
+	assert(uicbSize);
+
+	PTP_IO pIo = ::CreateThreadpoolIo(hFile, onIoDone, pOp, _workers.GetEnvironment());
+
+	::AcquireSRWLockExclusive(&pOp->lock);
+
+	pOp->stage = stage;
+	pOp->hFile = hFile;
+	pOp->pIo = pIo;
+	pOp->uicbSize = uicbSize;
+	pOp->uicbDone = 0;
+
+	::ReleaseSRWLockExclusive(&pOp->lock);
+
+	if (!pIo)
+	{
+		//Error
+		nOSErr = ::GetLastError();
+		return FALSE;
+	}
+
+	return issueIo(pOp, nOSErr);
+}
+
+
+BOOL CSigRemAsync::issueIo(SIGREM_ASYNC_OP* pOp, int& nOSErr)
+{
+	//Issue the next read or write for the current stage
+	//RETURN:
+	//		= TRUE if I/O was issued - 'pOp' may be finished on another thread already
+	//		= FALSE if error, or if the operation was stopped (check 'nOSErr' for info)
+	BOOL bRes = FALSE;
+
+	//Hold the lock, so that stopOp() either sees the I/O to cancel it, or we see that it was stopped
+	::AcquireSRWLockExclusive(&pOp->lock);
+
+	if (!pOp->nStopResult)
+	{
+		memset(&pOp->ov, 0, sizeof(pOp->ov));
+		pOp->ov.Offset = pOp->uicbDone;
+
+		DWORD dwcbChunk = pOp->uicbSize - pOp->uicbDone;
+		if (dwcbChunk > ASYNC_IO_CHUNK)
+			dwcbChunk = ASYNC_IO_CHUNK;
+
+		::StartThreadpoolIo(pOp->pIo);
+
+		BYTE* pChunk = pOp->pBuff + pOp->uicbDone;
+		BOOL bIssued = pOp->stage == AOS_Reading ?
+			::ReadFile(pOp->hFile, pChunk, dwcbChunk, NULL, &pOp->ov) :
+			::WriteFile(pOp->hFile, pChunk, dwcbChunk, NULL, &pOp->ov);
+
+		if (bIssued ||
+			::GetLastError() == ERROR_IO_PENDING)
+		{
+			//Completion will be queued either way
+			bRes = TRUE;
+		}
+		else
+		{
+			//Error
+			nOSErr = ::GetLastError();
+			::CancelThreadpoolIo(pOp->pIo);
+		}
+	}
+	else
+		nOSErr = ERROR_OPERATION_ABORTED;
+
+	::ReleaseSRWLockExclusive(&pOp->lock);
+
+	return bRes;
+}
+
+
+void CSigRemAsync::closeFile(SIGREM_ASYNC_OP* pOp)
+{
+	//Close the file of the current stage (it must not have I/O in progress)
+	::AcquireSRWLockExclusive(&pOp->lock);
+
+	HANDLE hFile = pOp->hFile;
+	PTP_IO pIo = pOp->pIo;
+
+	pOp->hFile = INVALID_HANDLE_VALUE;
+	pOp->pIo = NULL;
+
+	::ReleaseSRWLockExclusive(&pOp->lock);
+
+	if (pIo)
+	{
+		::CloseThreadpoolIo(pIo);
+	}
+
+	if (hFile != INVALID_HANDLE_VALUE)
+	{
+		verify(::CloseHandle(hFile));
+	}
+}
+
+
+void CSigRemAsync::stopOp(SIGREM_ASYNC_OP* pOp, EXIT_CODES nStopResult)
+{
+	//Make the operation finish with 'nStopResult' as soon as possible
+	//INFO: '_lock' must be held by the caller
+	if (::InterlockedCompareExchange(&pOp->nStopResult, nStopResult, 0) != 0)
+	{
+		//Already stopped
+		return;
+	}
+
+	if (!pOp->bHasSlot)
+	{
+		//Still in the queue - let it finish now instead of waiting for a slot
+		std::deque<SIGREM_ASYNC_OP*>::iterator it = std::find(_queWaiting.begin(), _queWaiting.end(), pOp);
+		if (it != _queWaiting.end())
+		{
+			_queWaiting.erase(it);
+
+			if (!dispatchOp(pOp))
+			{
+				//It will finish when it gets a slot then
+				_queWaiting.push_front(pOp);
+			}
+		}
+	}
+	else
+	{
+		//Cancel I/O in progress (its completion will finish the operation)
+		::AcquireSRWLockExclusive(&pOp->lock);
+
+		if (pOp->hFile != INVALID_HANDLE_VALUE)
+		{
+			::CancelIoEx(pOp->hFile, NULL);
+		}
+
+		::ReleaseSRWLockExclusive(&pOp->lock);
+	}
+}
+
+
+void CSigRemAsync::finishOp(SIGREM_ASYNC_OP* pOp, EXIT_CODES nResult, int nOSErr)
+{
+	//Release everything that the operation holds, invoke its callback and free it
+	//INFO: No locks may be held by the caller
+	if (pOp->pTimer)
+	{
+		//Make sure the deadline callback is not running (or will not run) before we free 'pOp'
+		::SetThreadpoolTimer(pOp->pTimer, NULL, 0, 0);
+		::WaitForThreadpoolTimerCallbacks(pOp->pTimer, TRUE);
+		::CloseThreadpoolTimer(pOp->pTimer);
+		pOp->pTimer = NULL;
+	}
+
+	closeFile(pOp);
+
+	if (nResult != XC_Success &&
+		pOp->stage == AOS_Writing)
+	{
+		//Don't leave a partial output
+		::DeleteFile(pOp->strOutputFile.c_str());
+	}
+
+	if (pOp->pBuff)
+	{
+		delete[] pOp->pBuff;
+		pOp->pBuff = NULL;
+	}
+
+	pOp->pfnDone(pOp->uiID, nResult, pOp->results, nResult == XC_Success ? 0 : nOSErr, pOp->pContext);
+
+	//Give its slot to the next operation in the queue
+	SIGREM_ASYNC_OP* pNext = NULL;
+
+	::AcquireSRWLockExclusive(&_lock);
+
+	_mapOps.erase(pOp->uiID);
+
+	if (pOp->bHasSlot)
+	{
+		if (!_queWaiting.empty())
+		{
+			pNext = _queWaiting.front();
+			_queWaiting.pop_front();
+
+			pNext->bHasSlot = TRUE;
+		}
+		else
+		{
+			assert(_nOpen);
+			_nOpen--;
+		}
+	}
+
+	if (_mapOps.empty())
+	{
+		::SetEvent(_hIdleEvent);
+	}
+
+	::ReleaseSRWLockExclusive(&_lock);
+
+	delete pOp;
+	pOp = NULL;
+
+	if (pNext &&
+		!dispatchOp(pNext))
+	{
+		//Error
+		finishOp(pNext, XC_GEN_FAILURE, ::GetLastError());
+	}
+}
+
+
+BOOL CSigRemAsync::dispatchOp(SIGREM_ASYNC_OP* pOp)
+{
+	//Queue the operation to start on a pool thread
+	//RETURN:
+	//		= TRUE if success
+	return ::TrySubmitThreadpoolCallback(onStart, pOp, _workers.GetEnvironment());
+}
@@ -0,0 +1,126 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+
+//Asynchronous signature removal for callers that can't block a thread per file (like event-loop services)
+#pragma once
+
+#include "CSigRem.h"
+#include "CWorkerPool.h"
+
+#include <string>
+#include <map>
+#include <deque>
+#include <algorithm>
+
+
+
+#define ASYNC_IO_CHUNK 0x100000				//Size of each read and write, in BYTEs
+#define ASYNC_DEFAULT_MAX_OPEN 256			//Default number of operations that may have files open and buffers allocated at once (others wait in a queue)
+
+
+
+typedef ULONGLONG SIGREM_ASYNC_ID;			//ID of an asynchronous operation (never 0)
+
+//Callback for a completed operation (it runs on one of the pool threads, and it must not block for long)
+//'nResult' = result of the operation (XC_Cancelled or XC_TimedOut if it was stopped)
+//'results' = sizes of the input and output files
+//'nOSErr' = OS error code, if any
+typedef void (CALLBACK *PFN_SIGREM_ASYNC_DONE)(SIGREM_ASYNC_ID uiID, EXIT_CODES nResult, const SIGREM_RESULTS& results, int nOSErr, PVOID pContext);
+
+
+enum ASYNC_OP_STAGE {
+	AOS_Queued,								//Waiting for a free slot (see ASYNC_DEFAULT_MAX_OPEN)
+	AOS_Reading,							//Reading the input file
+	AOS_Writing,							//Writing the output file
+};
+
+
+class CSigRemAsync;
+
+struct SIGREM_ASYNC_OP
+{
+	CSigRemAsync* pThis;
+	SIGREM_ASYNC_ID uiID;
+	std::wstring strInputFile;				//Input file path
+	std::wstring strOutputFile;				//Output file path
+	PFN_SIGREM_ASYNC_DONE pfnDone;			//Callback to invoke when the operation is done
+	PVOID pContext;							//Context for 'pfnDone'
+
+	SRWLOCK lock;							//Protects 'hFile' from being closed while the operation is being stopped
+	volatile LONG nStopResult;				//XC_Cancelled or XC_TimedOut once the operation was stopped, or 0 if not
+	ASYNC_OP_STAGE stage;
+	BOOL bHasSlot;							//TRUE if the operation is counted in '_nOpen'
+	PTP_TIMER pTimer;						//Deadline timer, or NULL if none
+	HANDLE hFile;							//File for the current stage, or INVALID_HANDLE_VALUE
+	PTP_IO pIo;								//Thread pool I/O for 'hFile', or NULL
+	OVERLAPPED ov;							//Overlapped structure for the pending read or write
+	BYTE* pBuff;							//File data, or NULL
+	ULONG uicbSize;							//Number of BYTEs to read or write in the current stage
+	ULONG uicbDone;							//Number of BYTEs read or written so far in the current stage
+	SIGREM_RESULTS results;
+};
+
+
+
+class CSigRemAsync
+{
+	//INFO: This class is thread-safe
+public:
+	CSigRemAsync();
+	~CSigRemAsync();
+
+	BOOL Init(DWORD nThreads = 0, DWORD nMaxOpen = ASYNC_DEFAULT_MAX_OPEN);
+	SIGREM_ASYNC_ID Submit(LPCTSTR pStrInputFile, LPCTSTR pStrOutputFile, PFN_SIGREM_ASYNC_DONE pfnDone, PVOID pContext, DWORD dwTimeoutMs = INFINITE);
+	BOOL Cancel(SIGREM_ASYNC_ID uiID);
+	void CancelAll();
+	void WaitAll();
+	void Close();
+	size_t GetPendingCount();
+
+protected:
+	static VOID CALLBACK onStart(PTP_CALLBACK_INSTANCE Instance, PVOID pContext);
+	static VOID CALLBACK onIoDone(PTP_CALLBACK_INSTANCE Instance, PVOID pContext, PVOID pOverlapped, ULONG nIoResult, ULONG_PTR nBytesTransferred, PTP_IO pIo);
+	static VOID CALLBACK onDeadline(PTP_CALLBACK_INSTANCE Instance, PVOID pContext, PTP_TIMER pTimer);
+	void startOp(SIGREM_ASYNC_OP* pOp);
+	void ioDone(SIGREM_ASYNC_OP* pOp, ULONG nIoResult, ULONG uicbTransferred);
+	BOOL beginStage(SIGREM_ASYNC_OP* pOp, ASYNC_OP_STAGE stage, HANDLE hFile, ULONG uicbSize, int& nOSErr);
+	BOOL issueIo(SIGREM_ASYNC_OP* pOp, int& nOSErr);
+	void processData(SIGREM_ASYNC_OP* pOp);
+	void closeFile(SIGREM_ASYNC_OP* pOp);
+	void stopOp(SIGREM_ASYNC_OP* pOp, EXIT_CODES nStopResult);
+	void finishOp(SIGREM_ASYNC_OP* pOp, EXIT_CODES nResult, int nOSErr);
+	BOOL dispatchOp(SIGREM_ASYNC_OP* pOp);
+
+private:
+	SRWLOCK _lock;
+	std::map<SIGREM_ASYNC_ID, SIGREM_ASYNC_OP*> _mapOps;		//All operations that were not finished (protected by '_lock')
+	std::deque<SIGREM_ASYNC_OP*> _queWaiting;					//Operations waiting for a slot (protected by '_lock')
+	SIGREM_ASYNC_ID _uiLastID;									//Last ID given out (protected by '_lock')
+	DWORD _nOpen;												//Number of operations that have a slot (protected by '_lock')
+	DWORD _nMaxOpen;											//Maximum for '_nOpen'
+	HANDLE _hIdleEvent;											//Manual-reset event that is set when there are no operations
+	CWorkerPool _workers;
+};
@@ -0,0 +1,778 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+
+#include "CSigRemBatch.h"
+
+
+
+
+CSigRemBatch::CSigRemBatch()
+{
+	_hAlgSha256 = NULL;
+	NTSTATUS status = ::BCryptOpenAlgorithmProvider(&_hAlgSha256, BCRYPT_SHA256_ALGORITHM, NULL, 0);
+	if (!BCRYPT_SUCCESS(status))
+	{
+		//Error - we'll process files without deduplication
+		CSigRem::ReportOSError((int)status, L"Failed to open SHA-256 provider, duplicate files will not be detected");
+		_hAlgSha256 = NULL;
+	}
+
+	_pReadBuff = new (std::nothrow) BYTE[SIZE_READ_CHUNK];
+	_hdrs.pPages = new (std::nothrow) BYTE[BATCH_CLASSIFY_COUNT * HDRCLS_PAGE_SIZE];
+	_ioPolicy = SIP_Buffered;
+
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+
+CSigRemBatch::~CSigRemBatch()
+{
+	if (_hAlgSha256)
+	{
+		verify(BCRYPT_SUCCESS(::BCryptCloseAlgorithmProvider(_hAlgSha256, 0)));
+		_hAlgSha256 = NULL;
+	}
+
+	if (_pReadBuff)
+	{
+		delete[] _pReadBuff;
+		_pReadBuff = NULL;
+	}
+
+	if (_hdrs.pPages)
+	{
+		delete[] _hdrs.pPages;
+		_hdrs.pPages = NULL;
+	}
+}
+
+
+EXIT_CODES CSigRemBatch::ProcessFolder(LPCTSTR pStrFolderPath, CSigRemJournal* pJournal, SIGREM_IO_POLICY ioPolicy)
+{
+	//Remove digital signatures from all PE files in a folder and its subfolders
+	//'pStrFolderPath' = folder to process
+	//'pJournal' = if not NULL, opened journal to record results into, and to skip files that were already completed in it
+	//'ioPolicy' = how to read and write files
+	//RETURN:
+	//		= XC_Success if all signed files were processed
+	//		= XC_BinaryHasNoSignature if there were no signed files in the folder
+	//		= XC_FailedToOpen if failed to enumerate the folder
+	//		= XC_GEN_FAILURE if some files failed to process
+	memset(&_stats, 0, sizeof(_stats));
+	_mapDedup.clear();
+	_ioPolicy = ioPolicy;
+
+	if (!_pReadBuff ||
+		!_hdrs.pPages)
+	{
+		//Error
+		CSigRem::ReportOSError(ERROR_OUTOFMEMORY, L"Failed to reserve memory for batch processing");
+		return XC_GEN_FAILURE;
+	}
+
+	//Use full path, so that journal records don't depend on the current directory
+	WCHAR buffFolder[MAX_PATH * 4];
+	DWORD dwchFolder = ::GetFullPathName(pStrFolderPath, _countof(buffFolder), buffFolder, NULL);
+	if (!dwchFolder ||
+		dwchFolder >= _countof(buffFolder))
+	{
+		//Error
+		CSigRem::ReportOSError(dwchFolder ? ERROR_INSUFFICIENT_BUFFER : ::GetLastError(), L"Failed to get full path for folder: %s", pStrFolderPath);
+		return XC_FailedToOpen;
+	}
+
+	//Collect all files first, so that we don't pick up our own output files
+	std::vector<BATCH_FILE> arrFiles;
+	if (!EnumFolder(buffFolder, arrFiles))
+	{
+		//Error was reported
+		return XC_FailedToOpen;
+	}
+
+	_stats.nFiles = arrFiles.size();
+
+	if (pJournal &&
+		pJournal->GetCompletedCount())
+	{
+		wprintf(L"Resuming with %llu completed records in the journal\n", pJournal->GetCompletedCount());
+	}
+
+	std::vector<size_t> arrGroup;
+	arrGroup.reserve(BATCH_CLASSIFY_COUNT);
+
+	for (size_t i = 0; i < arrFiles.size(); )
+	{
+		//Take the next group of files
+		arrGroup.clear();
+		for (; i < arrFiles.size() && arrGroup.size() < BATCH_CLASSIFY_COUNT; i++)
+		{
+			const BATCH_FILE& file = arrFiles[i];
+
+			//Skip files that were completed in a previous run
+			if (pJournal &&
+				pJournal->IsCompleted(file.strPath.c_str(), file.uicbFileSz, file.ftLastWrite))
+			{
+				_stats.nResumed++;
+				continue;
+			}
+
+			arrGroup.push_back(i);
+		}
+
+		//Sort them out by their headers, so that only signed files go through the full processing
+		classifyFiles(arrFiles, arrGroup);
+
+		for (size_t g = 0; g < arrGroup.size(); g++)
+		{
+			const BATCH_FILE& file = arrFiles[arrGroup[g]];
+			DWORD dwBit = 1u << (g % 32);
+
+			std::wstring strOutputFile;
+			ULONGLONG uicbOutputSz = 0;
+			EXIT_CODES nResult;
+
+			if (_hdrs.maskNotPE[g / 32] & dwBit)
+			{
+				//Skip it
+				_stats.nNotPE++;
+				nResult = XC_Not_PE_File;
+			}
+			else if (_hdrs.maskUnsigned[g / 32] & dwBit)
+			{
+				//Nothing to do
+				_stats.nNoSignature++;
+				nResult = XC_BinaryHasNoSignature;
+			}
+			else
+			{
+				nResult = processFile(file.strPath.c_str(), strOutputFile, uicbOutputSz);
+			}
+
+			if (pJournal)
+			{
+				pJournal->Append(file.strPath.c_str(), file.uicbFileSz, file.ftLastWrite,
+					nResult, strOutputFile.empty() ? NULL : strOutputFile.c_str(), uicbOutputSz);
+			}
+		}
+	}
+
+	if (pJournal)
+	{
+		pJournal->Commit();
+	}
+
+	showSummary();
+
+	if (_stats.nFailed)
+		return XC_GEN_FAILURE;
+
+	return _stats.nSuccess || _stats.nResumed ? XC_Success : XC_BinaryHasNoSignature;
+}
+
+
+BOOL CSigRemBatch::EnumFolder(LPCTSTR pStrFolderPath, std::vector<BATCH_FILE>& arrFiles)
+{
+	//'pStrFolderPath' = folder to enumerate (including its subfolders)
+	//'arrFiles' = receives all files found
+	//RETURN:
+	//		= TRUE if 'pStrFolderPath' was enumerated (errors in its subfolders are reported but are not fatal)
+	std::wstring strFolder = pStrFolderPath;
+	if (!strFolder.empty() &&
+		strFolder.back() != L'\\' &&
+		strFolder.back() != L'/')
+	{
+		strFolder += L'\\';
+	}
+
+	WIN32_FIND_DATA wfd = {};
+	HANDLE hFind = ::FindFirstFile((strFolder + L"*").c_str(), &wfd);
+	if (hFind == INVALID_HANDLE_VALUE)
+	{
+		//Error
+		CSigRem::ReportOSError(::GetLastError(), L"Failed to enumerate folder: %s", pStrFolderPath);
+		return FALSE;
+	}
+
+	do
+	{
+		if (wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			//Skip . and .. as well as junctions and symlinks (to avoid loops)
+			if (wcscmp(wfd.cFileName, L".") != 0 &&
+				wcscmp(wfd.cFileName, L"..") != 0 &&
+				!(wfd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT))
+			{
+				EnumFolder((strFolder + wfd.cFileName).c_str(), arrFiles);
+			}
+		}
+		else
+		{
+			BATCH_FILE file;
+			file.strPath = strFolder + wfd.cFileName;
+			file.uicbFileSz = ((ULONGLONG)wfd.nFileSizeHigh << 32) | wfd.nFileSizeLow;
+			file.ftLastWrite = wfd.ftLastWriteTime;
+
+			arrFiles.push_back(file);
+		}
+	}
+	while (::FindNextFile(hFind, &wfd));
+
+	int nOSErr = ::GetLastError();
+	if (nOSErr != ERROR_NO_MORE_FILES)
+	{
+		//Error - but keep what we've found so far
+		CSigRem::ReportOSError(nOSErr, L"Failed to enumerate all files in folder: %s", pStrFolderPath);
+	}
+
+	verify(::FindClose(hFind));
+
+	return TRUE;
+}
+
+
+EXIT_CODES CSigRemBatch::processFile(LPCTSTR pStrFilePath, std::wstring& strOutputFile, ULONGLONG& uicbOutputSz)
+{
+	//Remove digital signature from one file in a batch, or materialize its output from an identical file processed earlier
+	//'pStrFilePath' = input file path
+	//'strOutputFile' = receives output file path (only if result is XC_Success)
+	//'uicbOutputSz' = receives size of 'strOutputFile' in BYTEs (only if result is XC_Success)
+	//RETURN:
+	//		= Result of processing
+	int nOSErr = 0;
+	FILE_FINGERPRINT fp;
+	EXIT_CODES nResFp = getFingerprint(pStrFilePath, fp, nOSErr);
+
+	switch (nResFp)
+	{
+	case XC_BinaryHasNoSignature:
+		//Nothing to do
+		_stats.nNoSignature++;
+		return nResFp;
+
+	case XC_Not_PE_File:
+		//Skip it
+		_stats.nNotPE++;
+		return nResFp;
+
+	default:
+		break;
+	}
+
+	WCHAR* pOutputFile = CSigRem::MakeOutputFileName(pStrFilePath);
+	if (!pOutputFile)
+	{
+		//Error was reported
+		_stats.nFailed++;
+		return XC_GEN_FAILURE;
+	}
+
+	EXIT_CODES nResult = XC_GEN_FAILURE;
+	BOOL bDone = FALSE;
+
+	if (nResFp == XC_Success)
+	{
+		//See if we already processed an identical file
+		std::pair<std::multimap<FILE_FINGERPRINT, DEDUP_ENTRY>::iterator, std::multimap<FILE_FINGERPRINT, DEDUP_ENTRY>::iterator> range =
+			_mapDedup.equal_range(fp);
+
+		if (range.first != range.second)
+		{
+			//Fingerprints collided - confirm it with the full hash
+			BYTE fullHash[SIZE_HASH_SHA256];
+			if (getFullHash(pStrFilePath, fullHash, nOSErr))
+			{
+				for (std::multimap<FILE_FINGERPRINT, DEDUP_ENTRY>::iterator it = range.first; it != range.second; ++it)
+				{
+					DEDUP_ENTRY& entry = it->second;
+					if (!entry.bHaveFullHash)
+					{
+						if (!getFullHash(entry.strInputFile.c_str(), entry.fullHash, nOSErr))
+						{
+							//Can't compare with this one
+							continue;
+						}
+
+						entry.bHaveFullHash = true;
+					}
+
+					if (memcmp(entry.fullHash, fullHash, sizeof(fullHash)) == 0)
+					{
+						//Identical input - reuse its output
+						BOOL bLinked = FALSE;
+						if (materializeDuplicate(entry.strOutputFile.c_str(), pOutputFile, bLinked))
+						{
+							nResult = XC_Success;
+
+							_stats.nSuccess++;
+							_stats.nDuplicates++;
+
+							if (bLinked)
+							{
+								_stats.uicbSaved += entry.uicbOutputSz;
+							}
+
+							strOutputFile = pOutputFile;
+							uicbOutputSz = entry.uicbOutputSz;
+
+							wprintf(L"SUCCESS %s duplicate binary file without signature:\n\"%s\"\n",
+								bLinked ? L"linking" : L"copying",
+								pOutputFile);
+						}
+						else
+						{
+							//Error was reported
+							nResult = XC_FailedFileWrite;
+							_stats.nFailed++;
+						}
+
+						bDone = TRUE;
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	if (!bDone)
+	{
+		//Process it the regular way
+		SIGREM_PARAMS params = {};
+		params.ioPolicy = _ioPolicy;
+
+		SIGREM_RESULTS results = {};
+		nResult = CSigRem::RemoveDigitalSignature(pStrFilePath, pOutputFile, &results, &params);
+
+		switch (nResult)
+		{
+		case XC_Success:
+		{
+			_stats.nSuccess++;
+
+			strOutputFile = pOutputFile;
+			uicbOutputSz = results.uicbOutputSz;
+
+			if (nResFp == XC_Success)
+			{
+				//Remember it for deduplication
+				DEDUP_ENTRY entry;
+				entry.strInputFile = pStrFilePath;
+				entry.strOutputFile = pOutputFile;
+				entry.uicbOutputSz = results.uicbOutputSz;
+				entry.bHaveFullHash = false;
+
+				_mapDedup.insert(std::make_pair(fp, entry));
+			}
+		}
+		break;
+
+		case XC_BinaryHasNoSignature:
+			_stats.nNoSignature++;
+			break;
+
+		case XC_Not_PE_File:
+			_stats.nNotPE++;
+			break;
+
+		default:
+			_stats.nFailed++;
+			break;
+		}
+	}
+
+	//Free mem
+	delete[] pOutputFile;
+	pOutputFile = NULL;
+
+	return nResult;
+}
+
+
+void CSigRemBatch::classifyFiles(const std::vector<BATCH_FILE>& arrFiles, const std::vector<size_t>& arrIndexes)
+{
+	//Read the first page of each file, and classify them all at once into '_hdrs' masks
+	//'arrFiles' = all files in the batch
+	//'arrIndexes' = indexes in 'arrFiles' of files to classify (no more than BATCH_CLASSIFY_COUNT)
+	assert(arrIndexes.size() <= BATCH_CLASSIFY_COUNT);
+
+	for (size_t g = 0; g < arrIndexes.size(); g++)
+	{
+		BYTE* pPage = _hdrs.pPages + g * HDRCLS_PAGE_SIZE;
+		DWORD dwcbRead = 0;
+
+		//Files that we can't read here go through the full processing (that will report the error)
+		_hdrs.fileSizes[g] = ULONG_MAX;
+
+		HANDLE hFile = ::CreateFile(arrFiles[arrIndexes[g]].strPath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (hFile != INVALID_HANDLE_VALUE)
+		{
+			LARGE_INTEGER liFileSz = {};
+			if (::GetFileSizeEx(hFile, &liFileSz) &&
+				(ULONGLONG)liFileSz.QuadPart < ULONG_MAX)
+			{
+				DWORD dwcbPage = (ULONGLONG)liFileSz.QuadPart < HDRCLS_PAGE_SIZE ? (DWORD)liFileSz.QuadPart : HDRCLS_PAGE_SIZE;
+				if (::ReadFile(hFile, pPage, dwcbPage, &dwcbRead, NULL) &&
+					dwcbRead == dwcbPage)
+				{
+					_hdrs.fileSizes[g] = (ULONG)liFileSz.QuadPart;
+				}
+			}
+
+			verify(::CloseHandle(hFile));
+		}
+
+		//Classifier expects zeros past the end of small files
+		if (dwcbRead < HDRCLS_PAGE_SIZE)
+		{
+			memset(pPage + dwcbRead, 0, HDRCLS_PAGE_SIZE - dwcbRead);
+		}
+	}
+
+	HEADER_BATCH batch;
+	batch.pPages = _hdrs.pPages;
+	batch.pFileSizes = _hdrs.fileSizes;
+	batch.nCount = arrIndexes.size();
+
+	HEADER_MASKS masks;
+	masks.pSigned = _hdrs.maskSigned;
+	masks.pUnsigned = _hdrs.maskUnsigned;
+	masks.pNotPE = _hdrs.maskNotPE;
+
+	CPEClassifier::Classify(batch, masks);
+}
+
+
+EXIT_CODES CSigRemBatch::getFingerprint(LPCTSTR pStrFilePath, FILE_FINGERPRINT& fp, int& nOSErr)
+{
+	//Compute a cheap fingerprint of a file: its size, plus the hash of its PE headers and of its certificate table
+	//'pStrFilePath' = input file path
+	//'fp' = receives the fingerprint (valid only if result is XC_Success)
+	//'nOSErr' = receives OS error code, if any
+	//RETURN:
+	//		= XC_Success if 'fp' was computed for a signed PE file
+	//		= XC_BinaryHasNoSignature if this is a PE file without a signature
+	//		= XC_Not_PE_File if this is not a PE file
+	//		= Other value if failed - such file should go through the regular processing (that will report the error)
+	EXIT_CODES nResult = XC_FailedToOpen;
+
+	if (!_hAlgSha256)
+	{
+		//Can't compute it
+		return XC_GEN_FAILURE;
+	}
+
+	HANDLE hFile = ::CreateFile(pStrFilePath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile != INVALID_HANDLE_VALUE)
+	{
+		LARGE_INTEGER liFileSz = {};
+		if (::GetFileSizeEx(hFile, &liFileSz))
+		{
+			//Skip files that are too large (regular processing will report it)
+			if ((ULONGLONG)liFileSz.QuadPart < INT_MAX)
+			{
+				//Read the first page with PE headers
+				ULONG dwcbFileSz = (ULONG)liFileSz.QuadPart;
+				DWORD dwcbHdr = dwcbFileSz < SIZE_HEADER_PAGE ? dwcbFileSz : SIZE_HEADER_PAGE;
+				DWORD dwcbRead = 0;
+				if (::ReadFile(hFile, _pReadBuff, dwcbHdr, &dwcbRead, NULL) &&
+					dwcbRead == dwcbHdr)
+				{
+					PE_HEADERS_INFO info;
+					nResult = CSigRem::parse_PE_Headers(_pReadBuff, dwcbHdr, info, nOSErr);
+					if (nResult != XC_Success &&
+						dwcbHdr < dwcbFileSz &&
+						dwcbHdr >= sizeof(IMAGE_DOS_HEADER))
+					{
+						//PE headers may extend past the first page - read as much as the largest possible headers need
+						ULONGLONG uicbMaxHdr = (ULONGLONG)(ULONG)((IMAGE_DOS_HEADER*)_pReadBuff)->e_lfanew +
+							sizeof(IMAGE_NT_HEADERS64) + 0xFFFF + sizeof(IMAGE_SECTION_HEADER);
+
+						if (uicbMaxHdr > dwcbFileSz)
+							uicbMaxHdr = dwcbFileSz;
+
+						if (uicbMaxHdr > SIZE_READ_CHUNK)
+						{
+							//Unusual layout - let the regular processing handle it
+							nResult = XC_GEN_FAILURE;
+						}
+						else if (uicbMaxHdr > dwcbHdr)
+						{
+							LARGE_INTEGER liPos = {};
+							DWORD dwcbHdr2 = (DWORD)uicbMaxHdr;
+							if (::SetFilePointerEx(hFile, liPos, NULL, FILE_BEGIN) &&
+								::ReadFile(hFile, _pReadBuff, dwcbHdr2, &dwcbRead, NULL) &&
+								dwcbRead == dwcbHdr2)
+							{
+								dwcbHdr = dwcbHdr2;
+								nResult = CSigRem::parse_PE_Headers(_pReadBuff, dwcbHdr, info, nOSErr);
+							}
+							else
+							{
+								//Error
+								nOSErr = ::GetLastError();
+								nResult = XC_FailedToOpen;
+							}
+						}
+					}
+
+					if (nResult == XC_Success)
+					{
+						DWORD dwCertOffset = info.pSecurityDir->VirtualAddress;
+						DWORD dwcbCert = info.pSecurityDir->Size;
+
+						if (!dwcbCert &&
+							!dwCertOffset)
+						{
+							//No signature
+							nResult = XC_BinaryHasNoSignature;
+						}
+						else if ((ULONGLONG)dwCertOffset + dwcbCert != dwcbFileSz)
+						{
+							//Signature is not at the end of file - regular processing will report it
+							nResult = XC_BadSignature;
+						}
+						else
+						{
+							//Hash the headers and the certificate table
+							nResult = XC_GEN_FAILURE;
+
+							BCRYPT_HASH_HANDLE hHash = NULL;
+							NTSTATUS status = ::BCryptCreateHash(_hAlgSha256, &hHash, NULL, 0, NULL, 0, 0);
+							if (BCRYPT_SUCCESS(status))
+							{
+								status = ::BCryptHashData(hHash, _pReadBuff, dwcbHdr, 0);
+								if (BCRYPT_SUCCESS(status))
+								{
+									//(This will overwrite '_pReadBuff')
+									if (hashFileRange(hFile, dwCertOffset, dwcbCert, hHash, nOSErr))
+									{
+										status = ::BCryptFinishHash(hHash, fp.hash, sizeof(fp.hash), 0);
+										if (BCRYPT_SUCCESS(status))
+										{
+											//Done
+											fp.uicbFileSz = dwcbFileSz;
+											nResult = XC_Success;
+										}
+										else
+											nOSErr = (int)status;
+									}
+								}
+								else
+									nOSErr = (int)status;
+
+								verify(BCRYPT_SUCCESS(::BCryptDestroyHash(hHash)));
+							}
+							else
+								nOSErr = (int)status;
+						}
+					}
+				}
+				else
+					nOSErr = ::GetLastError();
+			}
+			else
+				nResult = XC_GEN_FAILURE;
+		}
+		else
+			nOSErr = ::GetLastError();
+
+		//Close handle
+		verify(::CloseHandle(hFile));
+	}
+	else
+		nOSErr = ::GetLastError();
+
+	return nResult;
+}
+
+
+BOOL CSigRemBatch::getFullHash(LPCTSTR pStrFilePath, BYTE (&hash)[SIZE_HASH_SHA256], int& nOSErr)
+{
+	//Compute SHA-256 of the entire file
+	//'pStrFilePath' = file path
+	//'hash' = receives the hash
+	//'nOSErr' = receives OS error code, if any
+	//RETURN:
+	//		= TRUE if success
+	BOOL bRes = FALSE;
+
+	HANDLE hFile = ::CreateFile(pStrFilePath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (hFile != INVALID_HANDLE_VALUE)
+	{
+		LARGE_INTEGER liFileSz = {};
+		if (::GetFileSizeEx(hFile, &liFileSz))
+		{
+			BCRYPT_HASH_HANDLE hHash = NULL;
+			NTSTATUS status = ::BCryptCreateHash(_hAlgSha256, &hHash, NULL, 0, NULL, 0, 0);
+			if (BCRYPT_SUCCESS(status))
+			{
+				if (hashFileRange(hFile, 0, (ULONGLONG)liFileSz.QuadPart, hHash, nOSErr))
+				{
+					status = ::BCryptFinishHash(hHash, hash, sizeof(hash), 0);
+					if (BCRYPT_SUCCESS(status))
+					{
+						//Done
+						bRes = TRUE;
+					}
+					else
+						nOSErr = (int)status;
+				}
+
+				verify(BCRYPT_SUCCESS(::BCryptDestroyHash(hHash)));
+			}
+			else
+				nOSErr = (int)status;
+		}
+		else
+			nOSErr = ::GetLastError();
+
+		//Close handle
+		verify(::CloseHandle(hFile));
+	}
+	else
+		nOSErr = ::GetLastError();
+
+	return bRes;
+}
+
+
+BOOL CSigRemBatch::hashFileRange(HANDLE hFile, ULONGLONG uiOffset, ULONGLONG uicbSz, BCRYPT_HASH_HANDLE hHash, int& nOSErr)
+{
+	//Add a range of file data to a hash (uses '_pReadBuff' to read data)
+	//'hFile' = file handle opened for reading
+	//'uiOffset' = offset in the file to start from, in BYTEs
+	//'uicbSz' = number of BYTEs to hash
+	//'hHash' = hash object to add data to
+	//'nOSErr' = receives OS error code, if any
+	//RETURN:
+	//		= TRUE if success
+	LARGE_INTEGER liPos;
+	liPos.QuadPart = (LONGLONG)uiOffset;
+	if (!::SetFilePointerEx(hFile, liPos, NULL, FILE_BEGIN))
+	{
+		//Error
+		nOSErr = ::GetLastError();
+		return FALSE;
+	}
+
+	while (uicbSz)
+	{
+		DWORD dwcbChunk = uicbSz < SIZE_READ_CHUNK ? (DWORD)uicbSz : SIZE_READ_CHUNK;
+		DWORD dwcbRead = 0;
+		if (!::ReadFile(hFile, _pReadBuff, dwcbChunk, &dwcbRead, NULL))
+		{
+			//Error
+			nOSErr = ::GetLastError();
+			return FALSE;
+		}
+
+		if (dwcbRead != dwcbChunk)
+		{
+			//File was truncated
+			nOSErr = ERROR_HANDLE_EOF;
+			return FALSE;
+		}
+
+		NTSTATUS status = ::BCryptHashData(hHash, _pReadBuff, dwcbRead, 0);
+		if (!BCRYPT_SUCCESS(status))
+		{
+			//Error
+			nOSErr = (int)status;
+			return FALSE;
+		}
+
+		uicbSz -= dwcbRead;
+	}
+
+	return TRUE;
+}
+
+
+BOOL CSigRemBatch::materializeDuplicate(LPCTSTR pStrSrcOutputFile, LPCTSTR pStrDestOutputFile, BOOL& bLinked)
+{
+	//Create output file for a duplicate input from the output of an identical file processed earlier
+	//'pStrSrcOutputFile' = output file that was already created
+	//'pStrDestOutputFile' = output file to create
+	//'bLinked' = receives TRUE if 'pStrDestOutputFile' was created as a hard link, or FALSE if it's a copy
+	//RETURN:
+	//		= TRUE if success
+	bLinked = FALSE;
+
+	//Replace existing file (as we would do when writing a new one)
+	if (!::DeleteFile(pStrDestOutputFile))
+	{
+		int nOSErr = ::GetLastError();
+		if (nOSErr != ERROR_FILE_NOT_FOUND)
+		{
+			//Error
+			CSigRem::ReportOSError(nOSErr, L"Failed to replace destination file: %s", pStrDestOutputFile);
+			return FALSE;
+		}
+	}
+
+	if (::CreateHardLink(pStrDestOutputFile, pStrSrcOutputFile, NULL))
+	{
+		//Linked
+		bLinked = TRUE;
+		return TRUE;
+	}
+
+	//Hard links are not supported across volumes, or on some file systems - make a copy instead
+	if (::CopyFile(pStrSrcOutputFile, pStrDestOutputFile, FALSE))
+	{
+		//Copied
+		return TRUE;
+	}
+
+	//Error
+	CSigRem::ReportOSError(::GetLastError(), L"Failed to create destination file: %s", pStrDestOutputFile);
+	return FALSE;
+}
+
+
+void CSigRemBatch::showSummary()
+{
+	//Output batch results to the console
+	wprintf(
+		L"\n"
+		L"Files processed:        %llu\n"
+		L"Skipped (resumed):      %llu\n"
+		L"Signatures removed:     %llu\n"
+		L"  Duplicates linked:    %llu\n"
+		L"No signature:           %llu\n"
+		L"Not PE files:           %llu\n"
+		L"Failed:                 %llu\n"
+		L"Bytes saved by dedup:   %llu\n"
+		,
+		_stats.nFiles,
+		_stats.nResumed,
+		_stats.nSuccess,
+		_stats.nDuplicates,
+		_stats.nNoSignature,
+		_stats.nNotPE,
+		_stats.nFailed,
+		_stats.uicbSaved
+	);
+}
@@ -0,0 +1,134 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+
+//Batch processing of folders with PE files
+#pragma once
+
+#include "CSigRem.h"
+#include "CSigRemJournal.h"
+#include "CPEClassifier.h"
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include <bcrypt.h>
+#pragma comment(lib, "Bcrypt.lib")
+
+
+
+#define SIZE_HEADER_PAGE 0x1000			//Size of the first chunk of a file that is read to parse PE headers, in BYTEs
+#define SIZE_HASH_SHA256 32				//Size of the SHA-256 hash, in BYTEs
+#define SIZE_READ_CHUNK 0x100000		//Size of the chunk used to read a file for hashing, in BYTEs
+#define BATCH_CLASSIFY_COUNT 256		//Number of files whose headers are read and classified at once
+
+
+
+struct FILE_FINGERPRINT
+{
+	ULONGLONG uicbFileSz;					//Size of the file in BYTEs
+	BYTE hash[SIZE_HASH_SHA256];			//SHA-256 of the header page and the certificate table
+
+	bool operator<(const FILE_FINGERPRINT& other) const
+	{
+		if (uicbFileSz != other.uicbFileSz)
+			return uicbFileSz < other.uicbFileSz;
+
+		return memcmp(hash, other.hash, sizeof(hash)) < 0;
+	}
+};
+
+
+struct DEDUP_ENTRY
+{
+	std::wstring strInputFile;				//Input file that was processed
+	std::wstring strOutputFile;				//Output file that was created from 'strInputFile'
+	ULONGLONG uicbOutputSz;					//Size of 'strOutputFile' in BYTEs
+	bool bHaveFullHash;						//true if 'fullHash' was computed
+	BYTE fullHash[SIZE_HASH_SHA256];		//SHA-256 of the entire 'strInputFile' (computed only on a fingerprint collision)
+};
+
+
+struct BATCH_FILE
+{
+	std::wstring strPath;					//Full file path
+	ULONGLONG uicbFileSz;					//Size of the file in BYTEs (when it was enumerated)
+	FILETIME ftLastWrite;					//Last write time of the file (when it was enumerated)
+};
+
+
+struct BATCH_HEADERS
+{
+	BYTE* pPages;													//First pages of files, HDRCLS_PAGE_SIZE BYTEs each (for BATCH_CLASSIFY_COUNT files)
+	ULONG fileSizes[BATCH_CLASSIFY_COUNT];							//Sizes of files in BYTEs (ULONG_MAX if failed to read)
+	DWORD maskSigned[HDRCLS_MASK_DWORDS(BATCH_CLASSIFY_COUNT)];		//Files that need the full path (see HEADER_MASKS)
+	DWORD maskUnsigned[HDRCLS_MASK_DWORDS(BATCH_CLASSIFY_COUNT)];	//PE files without a signature
+	DWORD maskNotPE[HDRCLS_MASK_DWORDS(BATCH_CLASSIFY_COUNT)];		//Files that are not PE
+};
+
+
+struct BATCH_STATS
+{
+	ULONGLONG nFiles;						//Number of files enumerated
+	ULONGLONG nResumed;						//Number of files skipped because they were completed in a previous run
+	ULONGLONG nSuccess;						//Number of files with removed signature (including duplicates)
+	ULONGLONG nNoSignature;					//Number of PE files without a signature
+	ULONGLONG nNotPE;						//Number of non-PE files
+	ULONGLONG nFailed;						//Number of files that failed to process
+	ULONGLONG nDuplicates;					//Number of outputs materialized from an earlier identical input
+	ULONGLONG uicbSaved;					//Number of BYTEs that were not written because of deduplication
+};
+
+
+
+class CSigRemBatch
+{
+public:
+	CSigRemBatch();
+	~CSigRemBatch();
+
+	EXIT_CODES ProcessFolder(LPCTSTR pStrFolderPath, CSigRemJournal* pJournal = NULL, SIGREM_IO_POLICY ioPolicy = SIP_Buffered);
+
+	static BOOL EnumFolder(LPCTSTR pStrFolderPath, std::vector<BATCH_FILE>& arrFiles);
+
+protected:
+	EXIT_CODES processFile(LPCTSTR pStrFilePath, std::wstring& strOutputFile, ULONGLONG& uicbOutputSz);
+	void classifyFiles(const std::vector<BATCH_FILE>& arrFiles, const std::vector<size_t>& arrIndexes);
+	EXIT_CODES getFingerprint(LPCTSTR pStrFilePath, FILE_FINGERPRINT& fp, int& nOSErr);
+	BOOL getFullHash(LPCTSTR pStrFilePath, BYTE (&hash)[SIZE_HASH_SHA256], int& nOSErr);
+	BOOL hashFileRange(HANDLE hFile, ULONGLONG uiOffset, ULONGLONG uicbSz, BCRYPT_HASH_HANDLE hHash, int& nOSErr);
+	BOOL materializeDuplicate(LPCTSTR pStrSrcOutputFile, LPCTSTR pStrDestOutputFile, BOOL& bLinked);
+	void showSummary();
+
+private:
+	BCRYPT_ALG_HANDLE _hAlgSha256;						//SHA-256 algorithm provider, or NULL if failed to open
+	BYTE* _pReadBuff;									//Buffer for reading file data
+	BATCH_HEADERS _hdrs;								//Headers of the files that are being processed
+	std::multimap<FILE_FINGERPRINT, DEDUP_ENTRY> _mapDedup;		//Unique inputs processed so far
+	SIGREM_IO_POLICY _ioPolicy;							//How to read and write files
+	BATCH_STATS _stats;
+};
+
@@ -0,0 +1,971 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+
+#include "CSigRemBench.h"
+#include "CSigRemBatch.h"
+#include "CSigRemFixChecksum.h"
+#include "CPEChecksum.h"
+#include "CPEClassifier.h"
+
+#include <algorithm>
+
+
+
+
+EXIT_CODES CSigRemBench::IoPolicies(LPCTSTR pStrFilePath, DWORD nRuns)
+{
+	//Remove signature from the same file with each I/O policy, with the input in the file cache (hot) and not (cold),
+	//and output timings to the console
+	//'pStrFilePath' = signed PE file to use (the output is written next to it, and deleted after each run)
+	//'nRuns' = number of runs for each case
+	//RETURN:
+	//		= XC_Success if all runs succeeded
+	//		= Other value if error
+	if (!nRuns)
+		nRuns = BENCH_DEFAULT_RUNS;
+
+	WCHAR* pOutputFile = CSigRem::MakeOutputFileName(pStrFilePath);
+	if (!pOutputFile)
+	{
+		//Error was reported
+		return XC_GEN_FAILURE;
+	}
+
+	LARGE_INTEGER liFreq;
+	verify(::QueryPerformanceFrequency(&liFreq));
+
+	EXIT_CODES nResult = XC_Success;
+
+	wprintf(L"Policy       Cache   Runs   Avg, ms    Min, ms    MB/s\n");
+
+	for (int p = 0; p < SIP_Count && nResult == XC_Success; p++)
+	{
+		for (int c = 0; c < 2 && nResult == XC_Success; c++)
+		{
+			BOOL bCold = c != 0;
+
+			SIGREM_PARAMS params = {};
+			params.dwFlags = SRF_QUIET_SKIPPED | SRF_QUIET_SUCCESS;
+			params.ioPolicy = (SIGREM_IO_POLICY)p;
+
+			double fTotalMs = 0;
+			double fMinMs = 0;
+			ULONGLONG uicbInputSz = 0;
+
+			for (DWORD r = 0; r < nRuns; r++)
+			{
+				//Prepare the file cache
+				int nOSErr = 0;
+				if (!(bCold ? dropFileCache(pStrFilePath, nOSErr) : warmFileCache(pStrFilePath, nOSErr)))
+				{
+					//Error
+					CSigRem::ReportOSError(nOSErr, L"Failed to prepare file cache for: %s", pStrFilePath);
+					nResult = XC_FailedToOpen;
+					break;
+				}
+
+				LARGE_INTEGER liStart, liEnd;
+				verify(::QueryPerformanceCounter(&liStart));
+
+				SIGREM_RESULTS results = {};
+				EXIT_CODES nRes = CSigRem::RemoveDigitalSignature(pStrFilePath, pOutputFile, &results, &params);
+
+				verify(::QueryPerformanceCounter(&liEnd));
+
+				if (nRes != XC_Success)
+				{
+					//Error
+					if (nRes == XC_BinaryHasNoSignature ||
+						nRes == XC_Not_PE_File)
+					{
+						CSigRem::ReportOSError(ERROR_INVALID_DATA, L"Benchmark needs a signed PE file: %s", pStrFilePath);
+					}
+
+					nResult = nRes;
+					break;
+				}
+
+				uicbInputSz = results.uicbInputSz;
+
+				double fMs = (double)(liEnd.QuadPart - liStart.QuadPart) * 1000.0 / (double)liFreq.QuadPart;
+				fTotalMs += fMs;
+
+				if (!r ||
+					fMs < fMinMs)
+				{
+					fMinMs = fMs;
+				}
+
+				//Don't let the output from one run get in the way of the next one
+				if (!::DeleteFile(pOutputFile))
+				{
+					//Error
+					CSigRem::ReportOSError(::GetLastError(), L"Failed to delete output file: %s", pOutputFile);
+					nResult = XC_FailedFileWrite;
+					break;
+				}
+			}
+
+			if (nResult == XC_Success)
+			{
+				double fAvgMs = fTotalMs / nRuns;
+
+				wprintf(L"%-12s %-7s %-6u %-10.3f %-10.3f %.1f\n",
+					CSigRem::GetIoPolicyName((SIGREM_IO_POLICY)p),
+					bCold ? L"cold" : L"hot",
+					nRuns,
+					fAvgMs,
+					fMinMs,
+					fAvgMs > 0 ? (double)uicbInputSz / (1024.0 * 1024.0) / (fAvgMs / 1000.0) : 0.0);
+			}
+		}
+	}
+
+	//Free mem
+	delete[] pOutputFile;
+	pOutputFile = NULL;
+
+	return nResult;
+}
+
+
+BOOL CSigRemBench::warmFileCache(LPCTSTR pStrFilePath, int& nOSErr)
+{
+	//Read the entire file through the file cache
+	//RETURN:
+	//		= TRUE if success
+	//		= FALSE if error (check 'nOSErr' for info)
+	BOOL bRes = FALSE;
+
+	HANDLE hFile = ::CreateFile(pStrFilePath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (hFile != INVALID_HANDLE_VALUE)
+	{
+		BYTE* pBuff = new (std::nothrow) BYTE[BENCH_READ_CHUNK];
+		if (pBuff)
+		{
+			for (;;)
+			{
+				DWORD dwcbRead = 0;
+				if (!::ReadFile(hFile, pBuff, BENCH_READ_CHUNK, &dwcbRead, NULL))
+				{
+					//Error
+					nOSErr = ::GetLastError();
+					break;
+				}
+
+				if (!dwcbRead)
+				{
+					//End of file
+					bRes = TRUE;
+					break;
+				}
+			}
+
+			delete[] pBuff;
+			pBuff = NULL;
+		}
+		else
+			nOSErr = ERROR_OUTOFMEMORY;
+
+		verify(::CloseHandle(hFile));
+	}
+	else
+		nOSErr = ::GetLastError();
+
+	return bRes;
+}
+
+
+BOOL CSigRemBench::dropFileCache(LPCTSTR pStrFilePath, int& nOSErr)
+{
+	//Remove the file data from the file cache
+	//INFO: Opening a file for unbuffered I/O makes the file system flush and purge its cached data, unless
+	//      the file is also mapped into memory somewhere. It's the closest thing to dropping the cache for one file
+	//      that doesn't need admin rights, so "cold" results are best-effort.
+	//RETURN:
+	//		= TRUE if success
+	//		= FALSE if error (check 'nOSErr' for info)
+	HANDLE hFile = ::CreateFile(pStrFilePath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		nOSErr = ::GetLastError();
+		return FALSE;
+	}
+
+	verify(::CloseHandle(hFile));
+
+	return TRUE;
+}
+
+
+EXIT_CODES CSigRemBench::Differential(LPCTSTR pStrFolderPath)
+{
+	//Run every file in a corpus folder (and its generated variants) through each engine, compare results with
+	//the reference engine, and output mismatches and throughput of each engine to the console
+	//INFO: Results must be byte-identical, with the same EXIT_CODES. Use it after changing any engine.
+	//'pStrFolderPath' = folder with the corpus (subfolders are included) - files in it are not modified
+	//RETURN:
+	//		= XC_Success if all engines matched the reference on all files
+	//		= XC_GEN_FAILURE if there were mismatches
+	//		= Other value if error
+	std::vector<BATCH_FILE> arrFiles;
+	if (!CSigRemBatch::EnumFolder(pStrFolderPath, arrFiles))
+	{
+		//Error was reported
+		return XC_FailedToOpen;
+	}
+
+	DIFF_CONTEXT ctx;
+	memset(ctx.stats, 0, sizeof(ctx.stats));
+	ctx.nFiles = 0;
+	ctx.nSkipped = 0;
+	ctx.arrPages.resize(HDRCLS_LANES * HDRCLS_PAGE_SIZE);
+
+	//File-based engines need the input and output on disk
+	WCHAR buffTempDir[MAX_PATH];
+	WCHAR buffTemp[MAX_PATH];
+	DWORD dwchLn = ::GetTempPath(_countof(buffTempDir), buffTempDir);
+	if (!dwchLn ||
+		dwchLn >= _countof(buffTempDir) ||
+		!::GetTempFileName(buffTempDir, L"srd", 0, buffTemp))
+	{
+		//Error
+		CSigRem::ReportOSError(::GetLastError(), L"Failed to create temporary file");
+		return XC_FailedFileWrite;
+	}
+
+	ctx.strTempInput = buffTemp;
+
+	if (!::GetTempFileName(buffTempDir, L"srd", 0, buffTemp))
+	{
+		//Error
+		CSigRem::ReportOSError(::GetLastError(), L"Failed to create temporary file");
+		::DeleteFile(ctx.strTempInput.c_str());
+		return XC_FailedFileWrite;
+	}
+
+	ctx.strTempOutput = buffTemp;
+
+	//Async engine (one operation at a time, so that its output goes to the same temporary file)
+	CSigRemAsync async;
+	ctx.pAsync = NULL;
+	ctx.asyncDone.hEvent = ::CreateEvent(NULL, FALSE, FALSE, NULL);
+	if (ctx.asyncDone.hEvent &&
+		async.Init())
+	{
+		ctx.pAsync = &async;
+	}
+	else
+		CSigRem::ReportOSError(::GetLastError(), L"Failed to start async engine");
+
+	wprintf(L"Comparing engines on %zu files (%s checksum is the fastest here)...\n",
+		arrFiles.size(),
+		CPEChecksum::GetKernelName(CPEChecksum::GetBestKernel()));
+
+	std::vector<BYTE> arrData;
+
+	for (size_t f = 0; f < arrFiles.size(); f++)
+	{
+		LPCTSTR pStrName = arrFiles[f].strPath.c_str();
+
+		int nOSErr = 0;
+		if (arrFiles[f].uicbFileSz >= INT_MAX ||
+			!readWholeFile(pStrName, arrData, nOSErr))
+		{
+			//Not a failure of any engine
+			CSigRem::ReportOSError(arrFiles[f].uicbFileSz >= INT_MAX ? ERROR_FILE_TOO_LARGE : nOSErr, L"Skipped corpus file: %s", pStrName);
+			ctx.nSkipped++;
+			continue;
+		}
+
+		ctx.nFiles++;
+
+		//Original file, and variants generated from it (the extra BYTE is reserved for DV_OddTail)
+		ULONG szcbData = (ULONG)arrData.size();
+		arrData.push_back(0xCC);
+
+		diffData(ctx, pStrName, DV_Original, arrData.data(), szcbData);
+		diffData(ctx, pStrName, DV_OddTail, arrData.data(), szcbData + 1);
+
+		if (szcbData > DIFF_HEADERS_ONLY_SIZE)
+		{
+			diffData(ctx, pStrName, DV_HeadersOnly, arrData.data(), DIFF_HEADERS_ONLY_SIZE);
+		}
+	}
+
+	if (ctx.pAsync)
+	{
+		ctx.pAsync->Close();
+		ctx.pAsync = NULL;
+	}
+
+	if (ctx.asyncDone.hEvent)
+	{
+		verify(::CloseHandle(ctx.asyncDone.hEvent));
+		ctx.asyncDone.hEvent = NULL;
+	}
+
+	::DeleteFile(ctx.strTempInput.c_str());
+	::DeleteFile(ctx.strTempOutput.c_str());
+
+	//Show results
+	LARGE_INTEGER liFreq;
+	verify(::QueryPerformanceFrequency(&liFreq));
+
+	ULONGLONG nMismatches = 0;
+
+	wprintf(L"\n"
+		L"Engine             Runs       Mismatches   MB/s\n");
+
+	for (int e = 0; e < DE_Count; e++)
+	{
+		const DIFF_ENGINE_STATS& st = ctx.stats[e];
+		nMismatches += st.nMismatches;
+
+		if (!st.nRuns)
+		{
+			wprintf(L"%-18s (not available)\n", GetEngineName((DIFF_ENGINE)e));
+			continue;
+		}
+
+		double fSec = (double)st.nTicks / (double)liFreq.QuadPart;
+
+		wprintf(L"%-18s %-10llu %-12llu %.1f\n",
+			GetEngineName((DIFF_ENGINE)e),
+			st.nRuns,
+			st.nMismatches,
+			fSec > 0 ? (double)st.uicbProcessed / (1024.0 * 1024.0) / fSec : 0.0);
+	}
+
+	wprintf(L"\n"
+		L"Corpus files:       %llu\n"
+		L"Skipped:            %llu\n"
+		L"Mismatches:         %llu\n"
+		,
+		ctx.nFiles,
+		ctx.nSkipped,
+		nMismatches);
+
+	return nMismatches ? XC_GEN_FAILURE : XC_Success;
+}
+
+
+void CSigRemBench::diffData(DIFF_CONTEXT& ctx, LPCTSTR pStrName, DIFF_VARIANT variant, const BYTE* pData, ULONG szcbData)
+{
+	//Run one input through all engines, and compare them with the reference
+	//'pStrName' = corpus file the input came from
+	//'variant' = how the input was made from the corpus file
+	//'pData' = input data
+	//'szcbData' = size of 'pData' in BYTEs
+	WCHAR buffInfo[256];
+	LARGE_INTEGER liStart, liEnd;
+
+	//Reference (works on a copy, since it changes the data in place)
+	std::vector<BYTE> arrRef(pData, pData + szcbData);
+
+	ULONG uicbRefSz = 0;
+	int nOSErr = 0;
+
+	verify(::QueryPerformanceCounter(&liStart));
+	EXIT_CODES nRefRes = CSigRem::RemoveDigitalSignatureFromMemory(arrRef.data(), szcbData, uicbRefSz, nOSErr);
+	verify(::QueryPerformanceCounter(&liEnd));
+
+	ctx.stats[DE_Reference].nRuns++;
+	ctx.stats[DE_Reference].uicbProcessed += szcbData;
+	ctx.stats[DE_Reference].nTicks += liEnd.QuadPart - liStart.QuadPart;
+
+	if (nRefRes != XC_Success)
+		uicbRefSz = 0;
+
+	//File engines, with each I/O policy
+	if (!writeWholeFile(ctx.strTempInput.c_str(), pData, szcbData, nOSErr))
+	{
+		//Error
+		CSigRem::ReportOSError(nOSErr, L"Failed to write temporary file: %s", ctx.strTempInput.c_str());
+		ctx.stats[DE_File_Buffered].nMismatches++;
+	}
+	else
+	{
+		for (int p = 0; p < SIP_Count; p++)
+		{
+			DIFF_ENGINE engine = (DIFF_ENGINE)(DE_File_Buffered + p);
+
+			SIGREM_PARAMS params = {};
+			params.dwFlags = SRF_QUIET_SKIPPED | SRF_QUIET_SUCCESS;
+			params.ioPolicy = (SIGREM_IO_POLICY)p;
+
+			SIGREM_RESULTS results = {};
+
+			verify(::QueryPerformanceCounter(&liStart));
+			EXIT_CODES nRes = CSigRem::RemoveDigitalSignature(ctx.strTempInput.c_str(), ctx.strTempOutput.c_str(), &results, &params);
+			verify(::QueryPerformanceCounter(&liEnd));
+
+			ctx.stats[engine].nRuns++;
+			ctx.stats[engine].uicbProcessed += szcbData;
+			ctx.stats[engine].nTicks += liEnd.QuadPart - liStart.QuadPart;
+
+			if (nRes != nRefRes)
+			{
+				verify(SUCCEEDED(::StringCchPrintf(buffInfo, _countof(buffInfo), L"result %d, expected %d", nRes, nRefRes)));
+				reportMismatch(ctx, engine, pStrName, variant, buffInfo);
+			}
+			else if (nRes == XC_Success)
+			{
+				if (!readWholeFile(ctx.strTempOutput.c_str(), ctx.arrOutput, nOSErr))
+				{
+					CSigRem::ReportOSError(nOSErr, L"Failed to read temporary file: %s", ctx.strTempOutput.c_str());
+					reportMismatch(ctx, engine, pStrName, variant, L"no output");
+				}
+				else if (ctx.arrOutput.size() != uicbRefSz ||
+					results.uicbOutputSz != uicbRefSz ||
+					memcmp(ctx.arrOutput.data(), arrRef.data(), uicbRefSz) != 0)
+				{
+					verify(SUCCEEDED(::StringCchPrintf(buffInfo, _countof(buffInfo), L"output differs (%zu BYTEs, expected %u)", ctx.arrOutput.size(), uicbRefSz)));
+					reportMismatch(ctx, engine, pStrName, variant, buffInfo);
+				}
+			}
+		}
+
+		//Async engine, on the same input file
+		if (ctx.pAsync)
+		{
+			verify(::QueryPerformanceCounter(&liStart));
+
+			EXIT_CODES nRes;
+			if (ctx.pAsync->Submit(ctx.strTempInput.c_str(), ctx.strTempOutput.c_str(), onAsyncDone, &ctx.asyncDone))
+			{
+				verify(::WaitForSingleObject(ctx.asyncDone.hEvent, INFINITE) == WAIT_OBJECT_0);
+				nRes = ctx.asyncDone.nResult;
+			}
+			else
+			{
+				//Error
+				CSigRem::ReportOSError(::GetLastError(), L"Failed to submit async operation");
+				nRes = XC_GEN_FAILURE;
+			}
+
+			verify(::QueryPerformanceCounter(&liEnd));
+
+			ctx.stats[DE_Async].nRuns++;
+			ctx.stats[DE_Async].uicbProcessed += szcbData;
+			ctx.stats[DE_Async].nTicks += liEnd.QuadPart - liStart.QuadPart;
+
+			if (nRes != nRefRes)
+			{
+				verify(SUCCEEDED(::StringCchPrintf(buffInfo, _countof(buffInfo), L"result %d, expected %d (OS error %d)", nRes, nRefRes, ctx.asyncDone.nOSErr)));
+				reportMismatch(ctx, DE_Async, pStrName, variant, buffInfo);
+			}
+			else if (nRes == XC_Success)
+			{
+				if (!readWholeFile(ctx.strTempOutput.c_str(), ctx.arrOutput, nOSErr))
+				{
+					CSigRem::ReportOSError(nOSErr, L"Failed to read temporary file: %s", ctx.strTempOutput.c_str());
+					reportMismatch(ctx, DE_Async, pStrName, variant, L"no output");
+				}
+				else if (ctx.arrOutput.size() != uicbRefSz ||
+					ctx.asyncDone.results.uicbOutputSz != uicbRefSz ||
+					memcmp(ctx.arrOutput.data(), arrRef.data(), uicbRefSz) != 0)
+				{
+					verify(SUCCEEDED(::StringCchPrintf(buffInfo, _countof(buffInfo), L"output differs (%zu BYTEs, expected %u)", ctx.arrOutput.size(), uicbRefSz)));
+					reportMismatch(ctx, DE_Async, pStrName, variant, buffInfo);
+				}
+			}
+		}
+	}
+
+	//Checksum kernels on the input, and on the reference output (where the checksum must match the one in it)
+	const BYTE* pSums[2] = { pData, arrRef.data() };
+	ULONG szcbSums[2] = { szcbData, uicbRefSz };
+
+	for (size_t i = 0; i < _countof(pSums); i++)
+	{
+		if (!szcbSums[i])
+			continue;
+
+		DWORD dwHdrSum = 0, dwRefSum = 0;
+		if (!checkSumPadded(ctx, pSums[i], szcbSums[i], dwHdrSum, dwRefSum))
+		{
+			//Not something to checksum
+			continue;
+		}
+
+		if (i == 1 &&
+			dwHdrSum != dwRefSum)
+		{
+			verify(SUCCEEDED(::StringCchPrintf(buffInfo, _countof(buffInfo), L"output checksum 0x%08X, expected 0x%08X", dwHdrSum, dwRefSum)));
+			reportMismatch(ctx, DE_Reference, pStrName, variant, buffInfo);
+		}
+
+		for (int k = PCK_Scalar; k < PCK_Count; k++)
+		{
+			if (!CPEChecksum::IsKernelSupported((PE_CHECKSUM_KERNEL)k))
+				continue;
+
+			DIFF_ENGINE engine = (DIFF_ENGINE)(DE_Checksum_Scalar + (k - PCK_Scalar));
+
+			verify(::QueryPerformanceCounter(&liStart));
+			DWORD dwSum = CPEChecksum::Compute(pSums[i], szcbSums[i], dwHdrSum, (PE_CHECKSUM_KERNEL)k);
+			verify(::QueryPerformanceCounter(&liEnd));
+
+			ctx.stats[engine].nRuns++;
+			ctx.stats[engine].uicbProcessed += szcbSums[i];
+			ctx.stats[engine].nTicks += liEnd.QuadPart - liStart.QuadPart;
+
+			if (dwSum != dwRefSum)
+			{
+				verify(SUCCEEDED(::StringCchPrintf(buffInfo, _countof(buffInfo), L"checksum 0x%08X, expected 0x%08X (%s)", dwSum, dwRefSum, i ? L"output" : L"input")));
+				reportMismatch(ctx, engine, pStrName, variant, buffInfo);
+			}
+		}
+	}
+
+	//Header classifier (files in the unsigned and not-PE masks are skipped by the batch, so they must be exactly right)
+	ULONG sizes[HDRCLS_LANES];
+	for (int l = 0; l < HDRCLS_LANES; l++)
+	{
+		BYTE* pPage = ctx.arrPages.data() + l * HDRCLS_PAGE_SIZE;
+		ULONG szcbPage = szcbData < HDRCLS_PAGE_SIZE ? szcbData : HDRCLS_PAGE_SIZE;
+
+		memcpy(pPage, pData, szcbPage);
+		memset(pPage + szcbPage, 0, HDRCLS_PAGE_SIZE - szcbPage);
+
+		sizes[l] = szcbData;
+	}
+
+	HEADER_BATCH batch;
+	batch.pPages = ctx.arrPages.data();
+	batch.pFileSizes = sizes;
+	batch.nCount = HDRCLS_LANES;
+
+	for (int k = PCLK_Scalar; k < PCLK_Count; k++)
+	{
+		if (!CPEClassifier::IsKernelSupported((PE_CLASSIFY_KERNEL)k))
+			continue;
+
+		DIFF_ENGINE engine = (DIFF_ENGINE)(DE_Classify_Scalar + (k - PCLK_Scalar));
+
+		DWORD dwSigned = 0, dwUnsigned = 0, dwNotPE = 0;
+		HEADER_MASKS masks = { &dwSigned, &dwUnsigned, &dwNotPE };
+
+		verify(::QueryPerformanceCounter(&liStart));
+		CPEClassifier::Classify(batch, masks, (PE_CLASSIFY_KERNEL)k);
+		verify(::QueryPerformanceCounter(&liEnd));
+
+		ctx.stats[engine].nRuns++;
+		ctx.stats[engine].uicbProcessed += HDRCLS_LANES * HDRCLS_PAGE_SIZE;
+		ctx.stats[engine].nTicks += liEnd.QuadPart - liStart.QuadPart;
+
+		const DWORD dwAll = (1u << HDRCLS_LANES) - 1;
+		BOOL bMatch;
+		if (dwNotPE == dwAll)
+			bMatch = nRefRes == XC_Not_PE_File;
+		else if (dwUnsigned == dwAll)
+			bMatch = nRefRes == XC_BinaryHasNoSignature;
+		else
+			bMatch = dwSigned == dwAll;
+
+		if (!bMatch)
+		{
+			verify(SUCCEEDED(::StringCchPrintf(buffInfo, _countof(buffInfo), L"masks 0x%02X/0x%02X/0x%02X, reference result %d", dwSigned, dwUnsigned, dwNotPE, nRefRes)));
+			reportMismatch(ctx, engine, pStrName, variant, buffInfo);
+		}
+	}
+
+	//Checksum repair on the reference output, with its checksum made stale
+	if (nRefRes == XC_Success)
+	{
+		PIMAGE_NT_HEADERS pNtHdrs = NULL;
+		DWORD dwHdrSum = 0, dwRefSum = 0;
+		if (uicbRefSz)
+			pNtHdrs = checkSumPadded(ctx, arrRef.data(), uicbRefSz, dwHdrSum, dwRefSum);
+
+		if (pNtHdrs)
+		{
+			//Same headers in the reference output
+			pNtHdrs = (PIMAGE_NT_HEADERS)(arrRef.data() + ((const BYTE*)pNtHdrs - ctx.arrSumPad.data()));
+
+			//CheckSum is at the same offset in 32-bit and 64-bit optional headers
+			DWORD* pdwChecksum = &((PIMAGE_NT_HEADERS32)pNtHdrs)->OptionalHeader.CheckSum;
+			*pdwChecksum ^= 0x5A5A;
+
+			BOOL bWritten = writeWholeFile(ctx.strTempOutput.c_str(), arrRef.data(), uicbRefSz, nOSErr);
+
+			*pdwChecksum ^= 0x5A5A;
+
+			if (!bWritten)
+			{
+				CSigRem::ReportOSError(nOSErr, L"Failed to write temporary file: %s", ctx.strTempOutput.c_str());
+				reportMismatch(ctx, DE_FixChecksum, pStrName, variant, L"no input");
+			}
+			else
+			{
+				verify(::QueryPerformanceCounter(&liStart));
+				EXIT_CODES nRes = CSigRemFixChecksum::FixFileChecksum(ctx.strTempOutput.c_str(), NULL, SRF_QUIET_SKIPPED | SRF_QUIET_SUCCESS);
+				verify(::QueryPerformanceCounter(&liEnd));
+
+				ctx.stats[DE_FixChecksum].nRuns++;
+				ctx.stats[DE_FixChecksum].uicbProcessed += uicbRefSz;
+				ctx.stats[DE_FixChecksum].nTicks += liEnd.QuadPart - liStart.QuadPart;
+
+				if (nRes != XC_Success)
+				{
+					verify(SUCCEEDED(::StringCchPrintf(buffInfo, _countof(buffInfo), L"result %d, expected %d", nRes, XC_Success)));
+					reportMismatch(ctx, DE_FixChecksum, pStrName, variant, buffInfo);
+				}
+				else if (!readWholeFile(ctx.strTempOutput.c_str(), ctx.arrOutput, nOSErr) ||
+					ctx.arrOutput.size() != uicbRefSz ||
+					memcmp(ctx.arrOutput.data(), arrRef.data(), uicbRefSz) != 0)
+				{
+					reportMismatch(ctx, DE_FixChecksum, pStrName, variant, L"output differs");
+				}
+			}
+		}
+	}
+
+	//Archive engine, with the input inside a ZIP
+	diffArchive(ctx, pStrName, variant, pData, szcbData, nRefRes, arrRef.data(), uicbRefSz);
+}
+
+
+void CSigRemBench::diffArchive(DIFF_CONTEXT& ctx, LPCTSTR pStrName, DIFF_VARIANT variant, const BYTE* pData, ULONG szcbData, EXIT_CODES nRefRes, const BYTE* pRefData, ULONG uicbRefSz)
+{
+	//Run the archive engine on a ZIP with one entry made from the input, and compare it with the reference
+	//INFO: The entry is deflated with stored blocks only, so the first block doesn't fit into the buffers used to
+	//      peek at the entry (that's what high-entropy PE files get from compressors).
+	//'nRefRes' = result of the reference on the input
+	//'pRefData' = reference output
+	//'uicbRefSz' = size of 'pRefData' in BYTEs
+	WCHAR buffInfo[256];
+	LARGE_INTEGER liStart, liEnd;
+	int nOSErr = 0;
+
+	std::vector<BYTE> arrZip;
+	makeStoredDeflateZip(pData, szcbData, arrZip);
+
+	if (!writeWholeFile(ctx.strTempInput.c_str(), arrZip.data(), (ULONG)arrZip.size(), nOSErr))
+	{
+		//Error
+		CSigRem::ReportOSError(nOSErr, L"Failed to write temporary file: %s", ctx.strTempInput.c_str());
+		reportMismatch(ctx, DE_Archive_Deflate, pStrName, variant, L"no input");
+		return;
+	}
+
+	//Entries that are not signed PE files are copied as-is, so no new archive is made then
+	EXIT_CODES nExpected;
+	if (nRefRes == XC_Success)
+		nExpected = XC_Success;
+	else if (nRefRes == XC_BinaryHasNoSignature ||
+		nRefRes == XC_Not_PE_File)
+		nExpected = XC_BinaryHasNoSignature;
+	else
+		nExpected = XC_GEN_FAILURE;
+
+	CSigRemArchive archive;
+
+	verify(::QueryPerformanceCounter(&liStart));
+	EXIT_CODES nRes = archive.ProcessArchive(ctx.strTempInput.c_str(), ctx.strTempOutput.c_str(), SRF_QUIET_SKIPPED | SRF_QUIET_SUCCESS);
+	verify(::QueryPerformanceCounter(&liEnd));
+
+	ctx.stats[DE_Archive_Deflate].nRuns++;
+	ctx.stats[DE_Archive_Deflate].uicbProcessed += szcbData;
+	ctx.stats[DE_Archive_Deflate].nTicks += liEnd.QuadPart - liStart.QuadPart;
+
+	if (nRes != nExpected)
+	{
+		verify(SUCCEEDED(::StringCchPrintf(buffInfo, _countof(buffInfo), L"result %d, expected %d", nRes, nExpected)));
+		reportMismatch(ctx, DE_Archive_Deflate, pStrName, variant, buffInfo);
+	}
+	else if (nRes == XC_Success)
+	{
+		//Stripped entry is the first one in the new archive, and it's stored
+		if (!readWholeFile(ctx.strTempOutput.c_str(), ctx.arrOutput, nOSErr))
+		{
+			CSigRem::ReportOSError(nOSErr, L"Failed to read temporary file: %s", ctx.strTempOutput.c_str());
+			reportMismatch(ctx, DE_Archive_Deflate, pStrName, variant, L"no output");
+			return;
+		}
+
+		const ZIP_LOCAL_HEADER* pLH = (const ZIP_LOCAL_HEADER*)ctx.arrOutput.data();
+		size_t nDataOffset = sizeof(ZIP_LOCAL_HEADER);
+		if (ctx.arrOutput.size() >= sizeof(ZIP_LOCAL_HEADER))
+			nDataOffset += pLH->wcbFileName + pLH->wcbExtra;
+
+		if (ctx.arrOutput.size() < nDataOffset + uicbRefSz ||
+			pLH->dwSignature != ZIP_SIG_LOCAL_HEADER ||
+			pLH->wMethod != ZIP_METHOD_STORED ||
+			pLH->dwcbUncompressed != uicbRefSz ||
+			pLH->dwCrc32 != CSigRemArchive::Crc32(0, pRefData, uicbRefSz) ||
+			memcmp(ctx.arrOutput.data() + nDataOffset, pRefData, uicbRefSz) != 0)
+		{
+			reportMismatch(ctx, DE_Archive_Deflate, pStrName, variant, L"entry differs");
+		}
+	}
+}
+
+
+void CSigRemBench::makeStoredDeflateZip(const BYTE* pData, ULONG szcbData, std::vector<BYTE>& arrZip)
+{
+	//Make a ZIP archive with 'pData' as its only entry, deflated with stored blocks (up to 0xFFFF BYTEs each)
+	//'arrZip' = receives the archive
+	const size_t szcbName = sizeof(DIFF_ZIP_ENTRY_NAME) - 1;
+
+	ULONG nBlocks = szcbData ? (szcbData + 0xFFFE) / 0xFFFF : 1;
+	DWORD dwcbDeflated = szcbData + nBlocks * 5;
+	DWORD dwCrc = CSigRemArchive::Crc32(0, pData, szcbData);
+
+	arrZip.clear();
+	arrZip.reserve(sizeof(ZIP_LOCAL_HEADER) + sizeof(ZIP_CENTRAL_HEADER) + sizeof(ZIP_END_OF_CD) + 2 * szcbName + dwcbDeflated);
+
+	ZIP_LOCAL_HEADER lh = {};
+	lh.dwSignature = ZIP_SIG_LOCAL_HEADER;
+	lh.wVersionNeeded = 20;
+	lh.wMethod = ZIP_METHOD_DEFLATED;
+	lh.dwCrc32 = dwCrc;
+	lh.dwcbCompressed = dwcbDeflated;
+	lh.dwcbUncompressed = szcbData;
+	lh.wcbFileName = (WORD)szcbName;
+
+	arrZip.insert(arrZip.end(), (const BYTE*)&lh, (const BYTE*)(&lh + 1));
+	arrZip.insert(arrZip.end(), DIFF_ZIP_ENTRY_NAME, DIFF_ZIP_ENTRY_NAME + szcbName);
+
+	for (ULONG uiPos = 0, b = 0; b < nBlocks; b++)
+	{
+		WORD wLen = (WORD)std::min<ULONG>(szcbData - uiPos, 0xFFFF);
+
+		//BFINAL bit, BTYPE = 00 (stored), padded to BYTE boundary; then LEN and NLEN
+		BYTE hdr[5] = { (BYTE)(b + 1 == nBlocks), (BYTE)wLen, (BYTE)(wLen >> 8), (BYTE)~wLen, (BYTE)(~wLen >> 8) };
+		arrZip.insert(arrZip.end(), hdr, hdr + sizeof(hdr));
+		arrZip.insert(arrZip.end(), pData + uiPos, pData + uiPos + wLen);
+
+		uiPos += wLen;
+	}
+
+	ZIP_CENTRAL_HEADER ch = {};
+	ch.dwSignature = ZIP_SIG_CENTRAL_HEADER;
+	ch.wVersionMadeBy = 20;
+	ch.wVersionNeeded = 20;
+	ch.wMethod = ZIP_METHOD_DEFLATED;
+	ch.dwCrc32 = dwCrc;
+	ch.dwcbCompressed = dwcbDeflated;
+	ch.dwcbUncompressed = szcbData;
+	ch.wcbFileName = (WORD)szcbName;
+	ch.dwLocalHeaderOffset = 0;
+
+	ZIP_END_OF_CD eocd = {};
+	eocd.dwSignature = ZIP_SIG_END_OF_CD;
+	eocd.wEntriesOnDisk = 1;
+	eocd.wEntries = 1;
+	eocd.dwcbCD = (DWORD)(sizeof(ch) + szcbName);
+	eocd.dwCDOffset = (DWORD)arrZip.size();
+
+	arrZip.insert(arrZip.end(), (const BYTE*)&ch, (const BYTE*)(&ch + 1));
+	arrZip.insert(arrZip.end(), DIFF_ZIP_ENTRY_NAME, DIFF_ZIP_ENTRY_NAME + szcbName);
+	arrZip.insert(arrZip.end(), (const BYTE*)&eocd, (const BYTE*)(&eocd + 1));
+}
+
+
+PIMAGE_NT_HEADERS CSigRemBench::checkSumPadded(DIFF_CONTEXT& ctx, const BYTE* pData, ULONG szcbData, DWORD& dwHdrSum, DWORD& dwRefSum)
+{
+	//Compute the reference checksum with CheckSumMappedFile
+	//INFO: For an odd 'szcbData' it sums (szcbData + 1) / 2 WORDs, so it reads one BYTE past the data. CPEChecksum
+	//      counts that BYTE as 0, while past our buffers it is either another BYTE of the input, or out of bounds.
+	//      So the data is copied into 'ctx.arrSumPad' with a zeroed spare BYTE after it.
+	//RETURN:
+	//		= NT headers in 'ctx.arrSumPad' if success
+	//		= NULL if the data is not something to checksum
+	ctx.arrSumPad.assign(pData, pData + szcbData);
+	ctx.arrSumPad.push_back(0);
+
+	return CheckSumMappedFile(ctx.arrSumPad.data(), szcbData, &dwHdrSum, &dwRefSum);
+}
+
+
+void CALLBACK CSigRemBench::onAsyncDone(SIGREM_ASYNC_ID uiID, EXIT_CODES nResult, const SIGREM_RESULTS& results, int nOSErr, PVOID pContext)
+{
+	//Called on a pool thread when the async engine is done with a file
+	UNREFERENCED_PARAMETER(uiID);
+
+	DIFF_ASYNC_DONE* pDone = (DIFF_ASYNC_DONE*)pContext;
+	pDone->nResult = nResult;
+	pDone->results = results;
+	pDone->nOSErr = nOSErr;
+
+	verify(::SetEvent(pDone->hEvent));
+}
+
+
+void CSigRemBench::reportMismatch(DIFF_CONTEXT& ctx, DIFF_ENGINE engine, LPCTSTR pStrName, DIFF_VARIANT variant, LPCTSTR pStrInfo)
+{
+	//Count and output a mismatch of the 'engine' with the reference
+	ctx.stats[engine].nMismatches++;
+
+	wprintf(L"MISMATCH %s [%s]: %s: %s\n",
+		GetEngineName(engine),
+		GetVariantName(variant),
+		pStrInfo,
+		pStrName);
+}
+
+
+LPCTSTR CSigRemBench::GetEngineName(DIFF_ENGINE engine)
+{
+	//RETURN:
+	//		= Name of the 'engine' for the console
+	switch (engine)
+	{
+	case DE_Reference:
+		return L"reference";
+	case DE_File_Buffered:
+		return L"file-buffered";
+	case DE_File_Sequential:
+		return L"file-sequential";
+	case DE_File_Direct:
+		return L"file-direct";
+	case DE_Checksum_Scalar:
+		return L"checksum-scalar";
+	case DE_Checksum_SSE2:
+		return L"checksum-sse2";
+	case DE_Checksum_AVX2:
+		return L"checksum-avx2";
+	case DE_FixChecksum:
+		return L"fix-checksum";
+	case DE_Classify_Scalar:
+		return L"classify-scalar";
+	case DE_Classify_AVX2:
+		return L"classify-avx2";
+	case DE_Async:
+		return L"async";
+	case DE_Archive_Deflate:
+		return L"archive-deflate";
+	default:
+		break;
+	}
+
+	assert(false);
+	return L"";
+}
+
+
+LPCTSTR CSigRemBench::GetVariantName(DIFF_VARIANT variant)
+{
+	//RETURN:
+	//		= Name of the 'variant' for the console
+	switch (variant)
+	{
+	case DV_Original:
+		return L"original";
+	case DV_OddTail:
+		return L"odd-tail";
+	case DV_HeadersOnly:
+		return L"headers-only";
+	default:
+		break;
+	}
+
+	assert(false);
+	return L"";
+}
+
+
+BOOL CSigRemBench::readWholeFile(LPCTSTR pStrFilePath, std::vector<BYTE>& arrData, int& nOSErr)
+{
+	//Read the entire file into 'arrData' (it must be smaller than INT_MAX BYTEs)
+	//RETURN:
+	//		= TRUE if success
+	//		= FALSE if error (check 'nOSErr' for info)
+	BOOL bRes = FALSE;
+
+	HANDLE hFile = ::CreateFile(pStrFilePath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (hFile != INVALID_HANDLE_VALUE)
+	{
+		LARGE_INTEGER liFileSz = {};
+		if (::GetFileSizeEx(hFile, &liFileSz))
+		{
+			if ((ULONGLONG)liFileSz.QuadPart < INT_MAX)
+			{
+				arrData.resize((size_t)liFileSz.QuadPart);
+
+				DWORD dwcbRead = 0;
+				if (arrData.empty() ||
+					::ReadFile(hFile, arrData.data(), (DWORD)arrData.size(), &dwcbRead, NULL))
+				{
+					if (dwcbRead == arrData.size())
+					{
+						bRes = TRUE;
+					}
+					else
+						nOSErr = ERROR_HANDLE_EOF;
+				}
+				else
+					nOSErr = ::GetLastError();
+			}
+			else
+				nOSErr = ERROR_FILE_TOO_LARGE;
+		}
+		else
+			nOSErr = ::GetLastError();
+
+		verify(::CloseHandle(hFile));
+	}
+	else
+		nOSErr = ::GetLastError();
+
+	return bRes;
+}
+
+
+BOOL CSigRemBench::writeWholeFile(LPCTSTR pStrFilePath, const BYTE* pData, ULONG szcbData, int& nOSErr)
+{
+	//Replace contents of the file with 'pData'
+	//RETURN:
+	//		= TRUE if success
+	//		= FALSE if error (check 'nOSErr' for info)
+	BOOL bRes = FALSE;
+
+	HANDLE hFile = ::CreateFile(pStrFilePath, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile != INVALID_HANDLE_VALUE)
+	{
+		DWORD dwcbWrtn = 0;
+		if (!szcbData ||
+			::WriteFile(hFile, pData, szcbData, &dwcbWrtn, NULL))
+		{
+			if (dwcbWrtn == szcbData)
+			{
+				bRes = TRUE;
+			}
+			else
+				nOSErr = ERROR_DISK_FULL;
+		}
+		else
+			nOSErr = ::GetLastError();
+
+		verify(::CloseHandle(hFile));
+	}
+	else
+		nOSErr = ::GetLastError();
+
+	return bRes;
+}
@@ -0,0 +1,126 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+//Benchmarks for the signature removal engine
+#pragma once
+
+#include "CSigRem.h"
+#include "CSigRemAsync.h"
+#include "CSigRemArchive.h"
+
+#include <string>
+#include <vector>
+
+
+
+#define BENCH_DEFAULT_RUNS 5			//Default number of runs for each benchmark case
+#define BENCH_READ_CHUNK 0x100000		//Size of the chunk used to read a file into the file cache, in BYTEs
+#define DIFF_HEADERS_ONLY_SIZE 0x400	//Size of the generated variant of a file that has only its headers, in BYTEs
+#define DIFF_ZIP_ENTRY_NAME "a.exe"		//Name of the entry in the ZIP made for DE_Archive_Deflate
+
+
+
+enum DIFF_ENGINE {
+	DE_Reference,						//File in memory, checksum by CheckSumMappedFile (everything else is compared to it)
+	DE_File_Buffered,					//CSigRem::RemoveDigitalSignature() with SIP_Buffered
+	DE_File_Sequential,					//CSigRem::RemoveDigitalSignature() with SIP_Sequential
+	DE_File_Direct,						//CSigRem::RemoveDigitalSignature() with SIP_Direct
+	DE_Checksum_Scalar,					//CPEChecksum with PCK_Scalar
+	DE_Checksum_SSE2,					//CPEChecksum with PCK_SSE2
+	DE_Checksum_AVX2,					//CPEChecksum with PCK_AVX2
+	DE_FixChecksum,						//CSigRemFixChecksum::FixFileChecksum() on the reference output with a stale checksum
+	DE_Classify_Scalar,					//CPEClassifier with PCLK_Scalar (must not put signed or failing files into unsigned or not-PE masks)
+	DE_Classify_AVX2,					//CPEClassifier with PCLK_AVX2
+	DE_Async,							//CSigRemAsync::Submit() (overlapped I/O on the thread pool)
+	DE_Archive_Deflate,					//CSigRemArchive on a ZIP with the input as a deflated entry that has only stored blocks
+
+	DE_Count							//Number of engines (must be last)
+};
+
+
+enum DIFF_VARIANT {
+	DV_Original,						//File as-is
+	DV_OddTail,							//File with one extra BYTE at the end (odd size, and a signature that is not at the end)
+	DV_HeadersOnly,						//First DIFF_HEADERS_ONLY_SIZE BYTEs of the file
+
+	DV_Count							//Number of variants (must be last)
+};
+
+
+struct DIFF_ENGINE_STATS
+{
+	ULONGLONG nRuns;					//Number of times the engine ran
+	ULONGLONG nMismatches;				//Number of runs with results different from DE_Reference
+	ULONGLONG uicbProcessed;			//Number of input BYTEs the engine went through
+	LONGLONG nTicks;					//Time the engine took, in QueryPerformanceCounter() ticks
+};
+
+
+struct DIFF_ASYNC_DONE
+{
+	HANDLE hEvent;						//Event that is set when the operation is done
+	EXIT_CODES nResult;					//Result of the operation
+	SIGREM_RESULTS results;				//Sizes from the operation
+	int nOSErr;							//OS error code from the operation
+};
+
+
+struct DIFF_CONTEXT
+{
+	CSigRemAsync* pAsync;				//Async engine, or NULL if it could not start
+	DIFF_ASYNC_DONE asyncDone;			//Completion of the last async operation
+	std::wstring strTempInput;			//Temporary file for the input of file-based engines
+	std::wstring strTempOutput;			//Temporary file for the output of file-based engines
+	std::vector<BYTE> arrOutput;		//Buffer for reading outputs back
+	std::vector<BYTE> arrSumPad;		//Zero-padded copy of the data for CheckSumMappedFile
+	std::vector<BYTE> arrPages;			//First pages of inputs for the classifier (HDRCLS_LANES of the same one, to go through the SIMD path)
+	DIFF_ENGINE_STATS stats[DE_Count];
+	ULONGLONG nFiles;					//Number of corpus files
+	ULONGLONG nSkipped;					//Number of corpus files that could not be read
+};
+
+
+
+class CSigRemBench
+{
+public:
+	static EXIT_CODES IoPolicies(LPCTSTR pStrFilePath, DWORD nRuns = BENCH_DEFAULT_RUNS);
+	static EXIT_CODES Differential(LPCTSTR pStrFolderPath);
+	static LPCTSTR GetEngineName(DIFF_ENGINE engine);
+	static LPCTSTR GetVariantName(DIFF_VARIANT variant);
+
+protected:
+	static void diffData(DIFF_CONTEXT& ctx, LPCTSTR pStrName, DIFF_VARIANT variant, const BYTE* pData, ULONG szcbData);
+	static void diffArchive(DIFF_CONTEXT& ctx, LPCTSTR pStrName, DIFF_VARIANT variant, const BYTE* pData, ULONG szcbData, EXIT_CODES nRefRes, const BYTE* pRefData, ULONG uicbRefSz);
+	static void makeStoredDeflateZip(const BYTE* pData, ULONG szcbData, std::vector<BYTE>& arrZip);
+	static PIMAGE_NT_HEADERS checkSumPadded(DIFF_CONTEXT& ctx, const BYTE* pData, ULONG szcbData, DWORD& dwHdrSum, DWORD& dwRefSum);
+	static void reportMismatch(DIFF_CONTEXT& ctx, DIFF_ENGINE engine, LPCTSTR pStrName, DIFF_VARIANT variant, LPCTSTR pStrInfo);
+	static void CALLBACK onAsyncDone(SIGREM_ASYNC_ID uiID, EXIT_CODES nResult, const SIGREM_RESULTS& results, int nOSErr, PVOID pContext);
+	static BOOL readWholeFile(LPCTSTR pStrFilePath, std::vector<BYTE>& arrData, int& nOSErr);
+	static BOOL writeWholeFile(LPCTSTR pStrFilePath, const BYTE* pData, ULONG szcbData, int& nOSErr);
+	static BOOL warmFileCache(LPCTSTR pStrFilePath, int& nOSErr);
+	static BOOL dropFileCache(LPCTSTR pStrFilePath, int& nOSErr);
+};
+
@@ -0,0 +1,467 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+
+#include "CSigRemClient.h"
+
+#include <vector>
+#include <algorithm>
+
+
+
+
+struct BENCH_THREAD
+{
+	const CLIENT_BENCH_PARAMS* pParams;
+	std::wstring strOutputFile;				//Output file for this thread
+	DWORD nRequests;						//Number of requests to send from this thread
+	DWORD nFailed;							//Number of requests that failed
+	EXIT_CODES nConnResult;					//XC_Success if connected to the server
+	std::vector<double> arrLatencies;		//Latency of each request, in ms
+};
+
+
+
+CSigRemClient::CSigRemClient()
+	: _hPipe(INVALID_HANDLE_VALUE)
+{
+}
+
+
+CSigRemClient::~CSigRemClient()
+{
+	Disconnect();
+}
+
+
+BOOL CSigRemClient::Connect(LPCTSTR pStrPipeName, DWORD dwmsTimeout)
+{
+	//Connect to the server
+	//'pStrPipeName' = name of the pipe (with or without SIGREM_PIPE_PREFIX)
+	//'dwmsTimeout' = how long to wait for a free pipe instance if all of them are busy, in ms
+	//RETURN:
+	//		= TRUE if connected
+	//		= FALSE if error (check GetLastError() for info)
+	Disconnect();
+
+	std::wstring strPipePath = CSigRem::MakePipePath(pStrPipeName);
+
+	for (;;)
+	{
+		_hPipe = ::CreateFile(strPipePath.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+		if (_hPipe != INVALID_HANDLE_VALUE)
+			break;
+
+		int nOSErr = ::GetLastError();
+		if (nOSErr != ERROR_PIPE_BUSY)
+		{
+			//Error
+			::SetLastError(nOSErr);
+			return FALSE;
+		}
+
+		//All instances are busy
+		if (!::WaitNamedPipe(strPipePath.c_str(), dwmsTimeout))
+		{
+			//Timed out
+			return FALSE;
+		}
+	}
+
+	DWORD dwMode = PIPE_READMODE_MESSAGE;
+	if (!::SetNamedPipeHandleState(_hPipe, &dwMode, NULL, NULL))
+	{
+		//Error
+		int nOSErr = ::GetLastError();
+
+		Disconnect();
+
+		::SetLastError(nOSErr);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+
+void CSigRemClient::Disconnect()
+{
+	if (_hPipe != INVALID_HANDLE_VALUE)
+	{
+		verify(::CloseHandle(_hPipe));
+		_hPipe = INVALID_HANDLE_VALUE;
+	}
+}
+
+
+BOOL CSigRemClient::IsConnected()
+{
+	return _hPipe != INVALID_HANDLE_VALUE;
+}
+
+
+EXIT_CODES CSigRemClient::RemoveDigitalSignature(LPCTSTR pStrFilePath, LPCTSTR pStrOutputFile, SIGREM_RESULTS* pOutResults)
+{
+	//Ask the server to remove digital signature from a file
+	//'pStrFilePath' = input file path (the server opens it - a relative path is resolved against our current directory)
+	//'pStrOutputFile' = output file path, or NULL to use the default name
+	//'pOutResults' = if not NULL, receives sizes of the input and output files
+	//RETURN:
+	//		= Result of the operation on the server (see CSigRem::RemoveDigitalSignature)
+	//		= XC_GEN_FAILURE if failed to talk to the server (check GetLastError() for info)
+	return transact(NULL, pStrFilePath, pStrOutputFile, pOutResults);
+}
+
+
+EXIT_CODES CSigRemClient::RemoveDigitalSignatureFromHandle(HANDLE hFile, LPCTSTR pStrFilePath, LPCTSTR pStrOutputFile, SIGREM_RESULTS* pOutResults)
+{
+	//Ask the server to remove digital signature from an open file
+	//'hFile' = input file handle opened with GENERIC_READ (the server duplicates it from this process)
+	//'pStrFilePath' = input file path, used only to make the default output file name (can be NULL if 'pStrOutputFile' is given)
+	//'pStrOutputFile' = output file path, or NULL to use the default name
+	//'pOutResults' = if not NULL, receives sizes of the input and output files
+	//RETURN:
+	//		= Result of the operation on the server (see CSigRem::RemoveDigitalSignature)
+	//		= XC_GEN_FAILURE if failed to talk to the server (check GetLastError() for info)
+	if (!hFile ||
+		hFile == INVALID_HANDLE_VALUE)
+	{
+		::SetLastError(ERROR_INVALID_HANDLE);
+		return XC_GEN_FAILURE;
+	}
+
+	return transact(hFile, pStrFilePath, pStrOutputFile, pOutResults);
+}
+
+
+EXIT_CODES CSigRemClient::transact(HANDLE hFile, LPCTSTR pStrFilePath, LPCTSTR pStrOutputFile, SIGREM_RESULTS* pOutResults)
+{
+	//Send one request to the server and wait for its reply
+	//'hFile' = input file handle to pass, or NULL to pass the path
+	if (_hPipe == INVALID_HANDLE_VALUE)
+	{
+		::SetLastError(ERROR_NOT_CONNECTED);
+		return XC_GEN_FAILURE;
+	}
+
+	//Send full paths (the server would resolve relative ones against its own current directory)
+	std::wstring strInput, strOutput;
+	if ((pStrFilePath && !getFullPath(pStrFilePath, strInput)) ||
+		(pStrOutputFile && !getFullPath(pStrOutputFile, strOutput)))
+	{
+		//Error
+		return XC_GEN_FAILURE;
+	}
+
+	size_t szchInput = strInput.size();
+	size_t szchOutput = strOutput.size();
+	if (szchInput > 0xFFFF ||
+		szchOutput > 0xFFFF ||
+		(!hFile && !szchInput))
+	{
+		::SetLastError(ERROR_BAD_PATHNAME);
+		return XC_GEN_FAILURE;
+	}
+
+	//Build request
+	DWORD dwcbReq = (DWORD)(sizeof(SIGREM_PIPE_REQUEST) + (szchInput + szchOutput) * sizeof(WCHAR));
+	std::vector<BYTE> arrReq(dwcbReq);
+
+	SIGREM_PIPE_REQUEST* pHdr = (SIGREM_PIPE_REQUEST*)arrReq.data();
+	pHdr->dwMagic = SIGREM_PIPE_REQUEST_MAGIC;
+	pHdr->dwVersion = SIGREM_PIPE_VERSION;
+	pHdr->dwFlags = hFile ? SPF_INPUT_HANDLE : 0;
+	pHdr->dwcbRequest = dwcbReq;
+	pHdr->hInputFile = (ULONGLONG)(ULONG_PTR)hFile;
+	pHdr->wcchInputPath = (WORD)szchInput;
+	pHdr->wcchOutputPath = (WORD)szchOutput;
+	pHdr->dwReserved = 0;
+
+	WCHAR* pPaths = (WCHAR*)(pHdr + 1);
+	if (szchInput)
+		memcpy(pPaths, strInput.c_str(), szchInput * sizeof(WCHAR));
+	if (szchOutput)
+		memcpy(pPaths + szchInput, strOutput.c_str(), szchOutput * sizeof(WCHAR));
+
+	//Send it and wait for reply
+	SIGREM_PIPE_REPLY reply = {};
+	DWORD dwcbRead = 0;
+	if (!::TransactNamedPipe(_hPipe, arrReq.data(), dwcbReq, &reply, sizeof(reply), &dwcbRead, NULL))
+	{
+		//Error
+		return XC_GEN_FAILURE;
+	}
+
+	if (dwcbRead != sizeof(reply) ||
+		reply.dwMagic != SIGREM_PIPE_REPLY_MAGIC)
+	{
+		//Bad reply
+		::SetLastError(ERROR_INVALID_DATA);
+		return XC_GEN_FAILURE;
+	}
+
+	if (pOutResults)
+	{
+		pOutResults->uicbInputSz = reply.uicbInputSz;
+		pOutResults->uicbOutputSz = reply.uicbOutputSz;
+	}
+
+	return (EXIT_CODES)reply.nExitCode;
+}
+
+
+BOOL CSigRemClient::getFullPath(LPCTSTR pStrPath, std::wstring& strOutPath)
+{
+	//Resolve 'pStrPath' against the current directory of this process
+	//RETURN:
+	//		= TRUE if success
+	//		= FALSE if error (check GetLastError() for info)
+	std::vector<WCHAR> arrBuff(MAX_PATH);
+
+	for (;;)
+	{
+		DWORD dwchPath = ::GetFullPathName(pStrPath, (DWORD)arrBuff.size(), arrBuff.data(), NULL);
+		if (!dwchPath)
+		{
+			//Error
+			return FALSE;
+		}
+
+		if (dwchPath < arrBuff.size())
+		{
+			strOutPath.assign(arrBuff.data(), dwchPath);
+			return TRUE;
+		}
+
+		//Needs more room (it includes the terminating null then)
+		arrBuff.resize(dwchPath);
+	}
+}
+
+
+EXIT_CODES CSigRemClient::RunBenchmark(const CLIENT_BENCH_PARAMS& params)
+{
+	//Generate load on the server and output throughput and latency to the console
+	//RETURN:
+	//		= XC_Success if all requests succeeded
+	//		= Other value if error
+	DWORD nThreads = params.nThreads ? params.nThreads : 1;
+	if (nThreads > params.nRequests)
+		nThreads = params.nRequests ? params.nRequests : 1;
+
+	//Each thread writes to its own output file, or they'd trip over each other
+	std::wstring strOutputBase;
+	if (params.pStrOutputFile)
+	{
+		strOutputBase = params.pStrOutputFile;
+	}
+	else
+	{
+		WCHAR* pStrOutput = CSigRem::MakeOutputFileName(params.pStrInputFile);
+		if (!pStrOutput)
+		{
+			CSigRem::ReportOSError(ERROR_OUTOFMEMORY, L"Failed to make output file name");
+			return XC_GEN_FAILURE;
+		}
+
+		strOutputBase = pStrOutput;
+		delete[] pStrOutput;
+	}
+
+	size_t nchExt = strOutputBase.size();
+	size_t nchSep = strOutputBase.find_last_of(L"\\/.");
+	if (nchSep != std::wstring::npos &&
+		strOutputBase[nchSep] == L'.')
+	{
+		nchExt = nchSep;
+	}
+
+	std::vector<BENCH_THREAD> arrThreads(nThreads);
+	std::vector<HANDLE> arrHandles;
+
+	for (DWORD i = 0; i < nThreads; i++)
+	{
+		BENCH_THREAD& bt = arrThreads[i];
+
+		WCHAR buffIdx[16];
+		verify(SUCCEEDED(::StringCchPrintf(buffIdx, _countof(buffIdx), L" (%u)", i)));
+
+		bt.pParams = &params;
+		bt.strOutputFile = strOutputBase;
+		bt.strOutputFile.insert(nchExt, buffIdx);
+		bt.nRequests = params.nRequests / nThreads + (i < params.nRequests % nThreads ? 1 : 0);
+		bt.nFailed = 0;
+		bt.nConnResult = XC_GEN_FAILURE;
+		bt.arrLatencies.reserve(bt.nRequests);
+	}
+
+	LARGE_INTEGER liFreq, liStart, liEnd;
+	verify(::QueryPerformanceFrequency(&liFreq));
+	verify(::QueryPerformanceCounter(&liStart));
+
+	for (DWORD i = 0; i < nThreads; i++)
+	{
+		HANDLE hThread = ::CreateThread(NULL, 0, threadBench, &arrThreads[i], 0, NULL);
+		if (!hThread)
+		{
+			//Error
+			CSigRem::ReportOSError(::GetLastError(), L"Failed to start benchmark thread");
+			break;
+		}
+
+		arrHandles.push_back(hThread);
+	}
+
+	for (size_t i = 0; i < arrHandles.size(); i++)
+	{
+		verify(::WaitForSingleObject(arrHandles[i], INFINITE) == WAIT_OBJECT_0);
+		verify(::CloseHandle(arrHandles[i]));
+	}
+
+	verify(::QueryPerformanceCounter(&liEnd));
+
+	//Collect results
+	EXIT_CODES nResult = arrHandles.size() == nThreads ? XC_Success : XC_GEN_FAILURE;
+	std::vector<double> arrAll;
+	DWORD nFailed = 0;
+
+	for (size_t i = 0; i < arrHandles.size(); i++)
+	{
+		const BENCH_THREAD& bt = arrThreads[i];
+		if (bt.nConnResult != XC_Success)
+			nResult = bt.nConnResult;
+
+		nFailed += bt.nFailed;
+		arrAll.insert(arrAll.end(), bt.arrLatencies.begin(), bt.arrLatencies.end());
+	}
+
+	if (nFailed)
+		nResult = XC_GEN_FAILURE;
+
+	double fSecs = (double)(liEnd.QuadPart - liStart.QuadPart) / (double)liFreq.QuadPart;
+
+	double fAvg = 0, fP50 = 0, fP99 = 0, fMax = 0;
+	if (!arrAll.empty())
+	{
+		std::sort(arrAll.begin(), arrAll.end());
+
+		double fSum = 0;
+		for (size_t i = 0; i < arrAll.size(); i++)
+			fSum += arrAll[i];
+
+		fAvg = fSum / arrAll.size();
+		fP50 = arrAll[arrAll.size() * 50 / 100];
+		fP99 = arrAll[arrAll.size() * 99 / 100];
+		fMax = arrAll.back();
+	}
+
+	wprintf(
+		L"\n"
+		L"Requests sent:          %u\n"
+		L"Failed:                 %u\n"
+		L"Connections:            %u\n"
+		L"Total time:             %.3f sec\n"
+		L"Throughput:             %.1f req/sec\n"
+		L"Latency avg/p50/p99/max: %.3f / %.3f / %.3f / %.3f ms\n"
+		,
+		(DWORD)arrAll.size(),
+		nFailed,
+		nThreads,
+		fSecs,
+		fSecs > 0 ? arrAll.size() / fSecs : 0.0,
+		fAvg, fP50, fP99, fMax
+	);
+
+	return nResult;
+}
+
+
+DWORD WINAPI CSigRemClient::threadBench(LPVOID lpParameter)
+{
+	//Thread that sends requests over its own connection
+	BENCH_THREAD* pBT = (BENCH_THREAD*)lpParameter;
+	assert(pBT);
+
+	const CLIENT_BENCH_PARAMS* pParams = pBT->pParams;
+
+	CSigRemClient client;
+	if (!client.Connect(pParams->pStrPipeName))
+	{
+		//Error
+		CSigRem::ReportOSError(::GetLastError(), L"Failed to connect to server: %s", pParams->pStrPipeName);
+
+		pBT->nConnResult = XC_FailedToOpen;
+		pBT->nFailed = pBT->nRequests;
+		return 0;
+	}
+
+	pBT->nConnResult = XC_Success;
+
+	HANDLE hFile = INVALID_HANDLE_VALUE;
+	if (pParams->bPassHandle)
+	{
+		hFile = ::CreateFile(pParams->pStrInputFile, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
+		if (hFile == INVALID_HANDLE_VALUE)
+		{
+			//Error
+			CSigRem::ReportOSError(::GetLastError(), L"Failed to open file: %s", pParams->pStrInputFile);
+
+			pBT->nConnResult = XC_FailedToOpen;
+			pBT->nFailed = pBT->nRequests;
+			return 0;
+		}
+	}
+
+	LARGE_INTEGER liFreq;
+	verify(::QueryPerformanceFrequency(&liFreq));
+
+	for (DWORD i = 0; i < pBT->nRequests; i++)
+	{
+		LARGE_INTEGER liStart, liEnd;
+		verify(::QueryPerformanceCounter(&liStart));
+
+		EXIT_CODES nRes = hFile != INVALID_HANDLE_VALUE ?
+			client.RemoveDigitalSignatureFromHandle(hFile, pParams->pStrInputFile, pBT->strOutputFile.c_str()) :
+			client.RemoveDigitalSignature(pParams->pStrInputFile, pBT->strOutputFile.c_str());
+
+		verify(::QueryPerformanceCounter(&liEnd));
+
+		if (nRes != XC_Success &&
+			nRes != XC_BinaryHasNoSignature)
+		{
+			pBT->nFailed++;
+		}
+
+		pBT->arrLatencies.push_back((double)(liEnd.QuadPart - liStart.QuadPart) * 1000.0 / (double)liFreq.QuadPart);
+	}
+
+	if (hFile != INVALID_HANDLE_VALUE)
+	{
+		verify(::CloseHandle(hFile));
+		hFile = INVALID_HANDLE_VALUE;
+	}
+
+	return 0;
+}
@@ -0,0 +1,70 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+//Client for the server mode (see CSigRemServer)
+#pragma once
+
+#include "CSigRem.h"
+
+#include <string>
+
+
+
+struct CLIENT_BENCH_PARAMS
+{
+	LPCTSTR pStrPipeName;					//Name of the server pipe
+	LPCTSTR pStrInputFile;					//File to send in each request
+	LPCTSTR pStrOutputFile;					//Output file (each thread writes to its own copy), or NULL to use the default name
+	DWORD nRequests;						//Total number of requests to send
+	DWORD nThreads;							//Number of concurrent connections
+	BOOL bPassHandle;						//TRUE to pass an open input file handle instead of its path
+};
+
+
+
+class CSigRemClient
+{
+public:
+	CSigRemClient();
+	~CSigRemClient();
+
+	BOOL Connect(LPCTSTR pStrPipeName, DWORD dwmsTimeout = 5000);
+	void Disconnect();
+	BOOL IsConnected();
+
+	EXIT_CODES RemoveDigitalSignature(LPCTSTR pStrFilePath, LPCTSTR pStrOutputFile = NULL, SIGREM_RESULTS* pOutResults = NULL);
+	EXIT_CODES RemoveDigitalSignatureFromHandle(HANDLE hFile, LPCTSTR pStrFilePath, LPCTSTR pStrOutputFile = NULL, SIGREM_RESULTS* pOutResults = NULL);
+
+	static EXIT_CODES RunBenchmark(const CLIENT_BENCH_PARAMS& params);
+
+protected:
+	EXIT_CODES transact(HANDLE hFile, LPCTSTR pStrFilePath, LPCTSTR pStrOutputFile, SIGREM_RESULTS* pOutResults);
+	static BOOL getFullPath(LPCTSTR pStrPath, std::wstring& strOutPath);
+	static DWORD WINAPI threadBench(LPVOID lpParameter);
+
+private:
+	HANDLE _hPipe;							//Connection to the server, or INVALID_HANDLE_VALUE if not connected
+};
+
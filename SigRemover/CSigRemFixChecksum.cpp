@@ -0,0 +1,413 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+
+#include "CSigRemFixChecksum.h"
+#include "CSigRemBatch.h"
+
+#include <vector>
+
+
+
+
+CSigRemFixChecksum::CSigRemFixChecksum()
+{
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+
+CSigRemFixChecksum::~CSigRemFixChecksum()
+{
+	//Wait for workers before anything else goes away
+	_workers.Close();
+}
+
+
+EXIT_CODES CSigRemFixChecksum::Process(LPCTSTR pStrPath)
+{
+	//Repair checksums of a PE file, or of all PE files in a folder and its subfolders (in parallel)
+	//'pStrPath' = file or folder to process
+	//RETURN:
+	//		= XC_Success if all files were processed (or the result of FixFileChecksum() for a single file)
+	//		= XC_FailedToOpen if failed to enumerate the folder
+	//		= XC_GEN_FAILURE if some files failed to process
+	memset(&_stats, 0, sizeof(_stats));
+
+	DWORD dwAttrs = ::GetFileAttributes(pStrPath);
+	if (dwAttrs == INVALID_FILE_ATTRIBUTES)
+	{
+		//Error
+		CSigRem::ReportOSError(::GetLastError(), L"Failed to open: %s", pStrPath);
+		return XC_FailedToOpen;
+	}
+
+	if (!(dwAttrs & FILE_ATTRIBUTE_DIRECTORY))
+	{
+		//Just one file
+		return FixFileChecksum(pStrPath);
+	}
+
+	std::vector<BATCH_FILE> arrFiles;
+	if (!CSigRemBatch::EnumFolder(pStrPath, arrFiles))
+	{
+		//Error was reported
+		return XC_FailedToOpen;
+	}
+
+	//Start all workers and allocate their buffers before the first file
+	if (!_workers.Init())
+	{
+		//Error
+		CSigRem::ReportOSError(::GetLastError(), L"Failed to start worker threads");
+		return XC_GEN_FAILURE;
+	}
+
+	if (!_buffPool.Init(_workers.GetThreadCount(), FIXSUM_POOL_BUFF_SIZE))
+	{
+		//Error
+		CSigRem::ReportOSError(::GetLastError(), L"Failed to reserve memory for worker buffers");
+		_workers.Close();
+		return XC_GEN_FAILURE;
+	}
+
+	wprintf(L"Checking %zu files with %u threads (%s checksum)...\n",
+		arrFiles.size(),
+		_workers.GetThreadCount(),
+		CPEChecksum::GetKernelName(CPEChecksum::GetBestKernel()));
+
+	for (size_t i = 0; i < arrFiles.size(); i++)
+	{
+		FIXSUM_ITEM* pItem = new (std::nothrow) FIXSUM_ITEM;
+		if (pItem)
+		{
+			pItem->pThis = this;
+			pItem->strFilePath.swap(arrFiles[i].strPath);
+
+			if (!_workers.Submit(onWorkItem, pItem))
+			{
+				//Can't queue it - do it on this thread then
+				processWorkItem(pItem);
+			}
+		}
+		else
+		{
+			//Error
+			CSigRem::ReportOSError(ERROR_OUTOFMEMORY, L"Failed to start processing file: %s", arrFiles[i].strPath.c_str());
+
+			::InterlockedIncrement64(&_stats.nFiles);
+			::InterlockedIncrement64(&_stats.nFailed);
+		}
+	}
+
+	_workers.WaitAll();
+	_workers.Close();
+	_buffPool.Free();
+
+	showSummary();
+
+	return _stats.nFailed ? XC_GEN_FAILURE : XC_Success;
+}
+
+
+EXIT_CODES CSigRemFixChecksum::FixFileChecksum(LPCTSTR pStrFilePath, CBuffPool* pBuffPool, DWORD dwFlags)
+{
+	//Repair checksum of a PE file in place (only the CheckSum field is written, and only if it's wrong)
+	//'pStrFilePath' = PE file path
+	//'pBuffPool' = if not NULL, pool to get the buffer for the file data from
+	//'dwFlags' = combination of SIGREM_FLAGS
+	//RETURN:
+	//		= XC_Success if checksum was repaired
+	//		= XC_ChecksumIsCorrect if checksum was already correct
+	//		= Other value if error
+	EXIT_CODES nResult = XC_FailedToOpen;
+	int nOSErr = 0;
+
+	//Check it on a read-only handle first (most files don't need a write, and this way files that are loaded,
+	//or open by a writer, don't fail with ERROR_SHARING_VIOLATION)
+	HANDLE hFile = ::CreateFile(pStrFilePath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (hFile != INVALID_HANDLE_VALUE)
+	{
+		DWORD dwOldChecksum = 0, dwNewChecksum = 0;
+		nResult = fixChecksum(hFile, FALSE, pBuffPool, dwOldChecksum, dwNewChecksum, nOSErr);
+
+		verify(::CloseHandle(hFile));
+
+		if (nResult == XC_FailedFileWrite &&
+			dwNewChecksum != dwOldChecksum)
+		{
+			//Needs repair - reopen it for writing (it is read again, in case it changed in between)
+			hFile = ::CreateFile(pStrFilePath, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+			if (hFile != INVALID_HANDLE_VALUE)
+			{
+				nResult = fixChecksum(hFile, TRUE, pBuffPool, dwOldChecksum, dwNewChecksum, nOSErr);
+
+				verify(::CloseHandle(hFile));
+			}
+			else
+			{
+				//Error
+				nOSErr = ::GetLastError();
+			}
+		}
+
+		switch (nResult)
+		{
+		case XC_Success:
+			if (!(dwFlags & SRF_QUIET_SUCCESS))
+				wprintf(L"FIXED checksum 0x%08X -> 0x%08X: %s\n", dwOldChecksum, dwNewChecksum, pStrFilePath);
+			break;
+
+		case XC_ChecksumIsCorrect:
+			if (!(dwFlags & SRF_QUIET_SKIPPED))
+				wprintf(L"Checksum is correct: %s\n", pStrFilePath);
+			break;
+
+		case XC_Not_PE_File:
+			if (!(dwFlags & SRF_QUIET_SKIPPED))
+				CSigRem::ReportOSError(nOSErr, L"Specified file is not a valid PE binary: %s", pStrFilePath);
+			break;
+
+		case XC_FailedFileWrite:
+			CSigRem::ReportOSError(nOSErr, L"Failed to write checksum 0x%08X to file: %s", dwNewChecksum, pStrFilePath);
+			break;
+
+		default:
+			CSigRem::ReportOSError(nOSErr, L"Failed to read file: %s", pStrFilePath);
+			break;
+		}
+	}
+	else
+	{
+		//Error
+		CSigRem::ReportOSError(::GetLastError(), L"Failed to open binary file: %s", pStrFilePath);
+	}
+
+	return nResult;
+}
+
+
+EXIT_CODES CSigRemFixChecksum::fixChecksum(HANDLE hFile, BOOL bCanWrite, CBuffPool* pBuffPool, DWORD& dwOldChecksum, DWORD& dwNewChecksum, int& nOSErr)
+{
+	//'hFile' = PE file to repair (positioned at its beginning)
+	//'bCanWrite' = TRUE if 'hFile' was opened for writing
+	//'pBuffPool' = if not NULL, pool to get the buffer for the file data from
+	//'dwOldChecksum' = receives checksum from the file
+	//'dwNewChecksum' = receives correct checksum
+	//'nOSErr' = receives OS error code, if any
+	//RETURN:
+	//		= See FixFileChecksum()
+	EXIT_CODES nResult = XC_FailedToOpen;
+
+	LARGE_INTEGER liFileSz = {};
+	if (!::GetFileSizeEx(hFile, &liFileSz))
+	{
+		//Error
+		nOSErr = ::GetLastError();
+		return XC_FailedToOpen;
+	}
+
+	if ((ULONGLONG)liFileSz.QuadPart >= INT_MAX)
+	{
+		//Too large for a PE file
+		nOSErr = ERROR_BAD_EXE_FORMAT;
+		return XC_Not_PE_File;
+	}
+
+	ULONG dwcbFileSz = (ULONG)liFileSz.QuadPart;
+	BYTE* pFileMem = pBuffPool ? pBuffPool->Get(dwcbFileSz) : new (std::nothrow) BYTE[dwcbFileSz ? dwcbFileSz : 1];
+	if (!pFileMem)
+	{
+		//Error
+		nOSErr = ERROR_OUTOFMEMORY;
+		return XC_FailedToOpen;
+	}
+
+	//Read the headers first, so that we don't have to read entire non-PE files
+	ULONG dwcbHdrSz = dwcbFileSz < SIZE_HEADER_PAGE ? dwcbFileSz : SIZE_HEADER_PAGE;
+	DWORD dwcbRead = 0;
+	BOOL bRead = ::ReadFile(hFile, pFileMem, dwcbHdrSz, &dwcbRead, NULL);
+	nOSErr = bRead ? 707 : ::GetLastError();
+
+	if (bRead &&
+		dwcbRead == dwcbHdrSz)
+	{
+		PE_HEADERS_INFO info;
+		nResult = CSigRem::parse_PE_Headers(pFileMem, dwcbHdrSz, info, nOSErr);
+
+		if (nResult == XC_Not_PE_File &&
+			dwcbHdrSz < dwcbFileSz &&
+			dwcbHdrSz >= sizeof(IMAGE_DOS_HEADER) &&
+			((IMAGE_DOS_HEADER*)pFileMem)->e_magic == IMAGE_DOS_SIGNATURE &&
+			(ULONG)((IMAGE_DOS_HEADER*)pFileMem)->e_lfanew + sizeof(IMAGE_NT_HEADERS64) > dwcbHdrSz)
+		{
+			//Headers may continue past the first page - give it another try after reading the rest
+			nResult = XC_Success;
+		}
+
+		if (nResult == XC_Success)
+		{
+			//Read the rest of the file
+			nResult = XC_FailedToOpen;
+
+			DWORD dwcbRest = dwcbFileSz - dwcbHdrSz;
+			dwcbRead = 0;
+			bRead = !dwcbRest || ::ReadFile(hFile, pFileMem + dwcbHdrSz, dwcbRest, &dwcbRead, NULL);
+			nOSErr = bRead ? 707 : ::GetLastError();
+
+			if (bRead &&
+				dwcbRead == dwcbRest)
+			{
+				nResult = CSigRem::parse_PE_Headers(pFileMem, dwcbFileSz, info, nOSErr);
+				if (nResult == XC_Success)
+				{
+					dwOldChecksum = *info.pdwChecksum;
+					dwNewChecksum = CPEChecksum::Compute(pFileMem, dwcbFileSz, dwOldChecksum);
+
+#ifdef _DEBUG
+					//Check it against the system
+					if (!(dwcbFileSz & 1))
+					{
+						DWORD dwSysHdrSum = 0, dwSysNewSum = 0;
+						verify(CheckSumMappedFile(pFileMem, dwcbFileSz, &dwSysHdrSum, &dwSysNewSum));
+						assert(dwSysHdrSum == dwOldChecksum);
+						assert(dwSysNewSum == dwNewChecksum);
+					}
+#endif
+
+					if (dwNewChecksum == dwOldChecksum)
+					{
+						//Nothing to do
+						nResult = XC_ChecksumIsCorrect;
+					}
+					else if (bCanWrite)
+					{
+						//Write just the CheckSum field at its offset
+						OVERLAPPED ov = {};
+						ov.Offset = (DWORD)((BYTE*)info.pdwChecksum - pFileMem);
+
+						DWORD dwcbWrtn = 0;
+						if (::WriteFile(hFile, &dwNewChecksum, sizeof(dwNewChecksum), &dwcbWrtn, &ov))
+						{
+							if (dwcbWrtn == sizeof(dwNewChecksum))
+							{
+								//Done
+								nResult = XC_Success;
+							}
+							else
+							{
+								nOSErr = 4635;
+								nResult = XC_FailedFileWrite;
+							}
+						}
+						else
+						{
+							nOSErr = ::GetLastError();
+							nResult = XC_FailedFileWrite;
+						}
+					}
+					else
+					{
+						//File was opened read-only
+						nOSErr = ERROR_ACCESS_DENIED;
+						nResult = XC_FailedFileWrite;
+					}
+				}
+			}
+		}
+	}
+
+	//Free mem
+	if (pBuffPool)
+		pBuffPool->Release(pFileMem);
+	else
+		delete[] pFileMem;
+
+	pFileMem = NULL;
+
+	return nResult;
+}
+
+
+VOID CALLBACK CSigRemFixChecksum::onWorkItem(PTP_CALLBACK_INSTANCE Instance, PVOID pContext)
+{
+	//Called on a worker thread
+	UNREFERENCED_PARAMETER(Instance);
+
+	FIXSUM_ITEM* pItem = (FIXSUM_ITEM*)pContext;
+	assert(pItem);
+
+	pItem->pThis->processWorkItem(pItem);
+}
+
+
+void CSigRemFixChecksum::processWorkItem(FIXSUM_ITEM* pItem)
+{
+	//Process one file on a worker thread
+	//'pItem' = file to process - it will be deleted here
+	::InterlockedIncrement64(&_stats.nFiles);
+
+	EXIT_CODES nResult = FixFileChecksum(pItem->strFilePath.c_str(), &_buffPool, SRF_QUIET_SKIPPED);
+
+	switch (nResult)
+	{
+	case XC_Success:
+		::InterlockedIncrement64(&_stats.nFixed);
+		break;
+
+	case XC_ChecksumIsCorrect:
+		::InterlockedIncrement64(&_stats.nCorrect);
+		break;
+
+	case XC_Not_PE_File:
+		::InterlockedIncrement64(&_stats.nNotPE);
+		break;
+
+	default:
+		::InterlockedIncrement64(&_stats.nFailed);
+		break;
+	}
+
+	delete pItem;
+}
+
+
+void CSigRemFixChecksum::showSummary()
+{
+	//Output results to the console
+	wprintf(
+		L"\n"
+		L"Files checked:          %lld\n"
+		L"Checksums repaired:     %lld\n"
+		L"Already correct:        %lld\n"
+		L"Not PE files:           %lld\n"
+		L"Failed:                 %lld\n"
+		,
+		_stats.nFiles,
+		_stats.nFixed,
+		_stats.nCorrect,
+		_stats.nNotPE,
+		_stats.nFailed
+	);
+}
@@ -0,0 +1,83 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+//Repair stale checksums in PE files in place
+#pragma once
+
+#include "CSigRem.h"
+#include "CBuffPool.h"
+#include "CWorkerPool.h"
+#include "CPEChecksum.h"
+
+#include <string>
+
+
+
+#define FIXSUM_POOL_BUFF_SIZE 0x1000000		//Size of each pre-allocated buffer for file data, in BYTEs (larger files use regular allocations)
+
+
+
+struct FIXSUM_STATS
+{
+	volatile LONGLONG nFiles;				//Number of files processed
+	volatile LONGLONG nFixed;				//Number of files with the checksum repaired
+	volatile LONGLONG nCorrect;				//Number of PE files that already had the correct checksum
+	volatile LONGLONG nNotPE;				//Number of non-PE files
+	volatile LONGLONG nFailed;				//Number of files that failed to process
+};
+
+
+class CSigRemFixChecksum;
+
+struct FIXSUM_ITEM
+{
+	CSigRemFixChecksum* pThis;
+	std::wstring strFilePath;				//File to process
+};
+
+
+
+class CSigRemFixChecksum
+{
+public:
+	CSigRemFixChecksum();
+	~CSigRemFixChecksum();
+
+	EXIT_CODES Process(LPCTSTR pStrPath);
+
+	static EXIT_CODES FixFileChecksum(LPCTSTR pStrFilePath, CBuffPool* pBuffPool = NULL, DWORD dwFlags = 0);
+
+protected:
+	static EXIT_CODES fixChecksum(HANDLE hFile, BOOL bCanWrite, CBuffPool* pBuffPool, DWORD& dwOldChecksum, DWORD& dwNewChecksum, int& nOSErr);
+	static VOID CALLBACK onWorkItem(PTP_CALLBACK_INSTANCE Instance, PVOID pContext);
+	void processWorkItem(FIXSUM_ITEM* pItem);
+	void showSummary();
+
+private:
+	CBuffPool _buffPool;
+	CWorkerPool _workers;								//(Must be declared after '_buffPool' to be destroyed before it)
+	FIXSUM_STATS _stats;
+};
+
@@ -0,0 +1,493 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+
+#include "CSigRemJournal.h"
+
+#include <algorithm>
+
+
+
+
+CSigRemJournal::CSigRemJournal()
+{
+	_hFile = INVALID_HANDLE_VALUE;
+	_hMapping = NULL;
+	_pView = NULL;
+	_uicbView = 0;
+	_nCompleted = 0;
+	_nPendingRecords = 0;
+	_uiTicksLastCommit = 0;
+}
+
+
+CSigRemJournal::~CSigRemJournal()
+{
+	Close();
+}
+
+
+BOOL CSigRemJournal::Open(LPCTSTR pStrJournalPath, BOOL bResume)
+{
+	//Open journal file for appending new records (create it if it doesn't exist)
+	//'pStrJournalPath' = journal file path
+	//'bResume' = TRUE to keep the index of records already in the journal, to use with IsCompleted()
+	//RETURN:
+	//		= TRUE if success (error is reported otherwise)
+	Close();
+
+	_hFile = ::CreateFile(pStrJournalPath, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (_hFile == INVALID_HANDLE_VALUE)
+	{
+		//Error
+		CSigRem::ReportOSError(::GetLastError(), L"Failed to open journal file: %s", pStrJournalPath);
+		return FALSE;
+	}
+
+	//Find where valid records end
+	ULONGLONG uicbValidSz = 0;
+	BOOL bRes = mapJournal(uicbValidSz);
+	if (bRes)
+	{
+		if (uicbValidSz < _uicbView)
+		{
+			//Last records were not fully written (we must have crashed) - discard them
+			wprintf(L"WARNING: Discarding %llu BYTEs of incomplete records at the end of journal: %s\n",
+				_uicbView - uicbValidSz,
+				pStrJournalPath);
+
+			unmapJournal();
+
+			LARGE_INTEGER liPos;
+			liPos.QuadPart = (LONGLONG)uicbValidSz;
+			if (::SetFilePointerEx(_hFile, liPos, NULL, FILE_BEGIN) &&
+				::SetEndOfFile(_hFile))
+			{
+				//Re-map the remaining records
+				bRes = mapJournal(uicbValidSz);
+			}
+			else
+			{
+				//Error
+				CSigRem::ReportOSError(::GetLastError(), L"Failed to truncate journal file: %s", pStrJournalPath);
+				bRes = FALSE;
+			}
+		}
+	}
+	else
+		CSigRem::ReportOSError(::GetLastError(), L"Failed to read journal file: %s", pStrJournalPath);
+
+	if (bRes)
+	{
+		if (!bResume)
+		{
+			//We don't need existing records
+			unmapJournal();
+		}
+
+		//New records will be appended
+		LARGE_INTEGER liPos;
+		liPos.QuadPart = (LONGLONG)uicbValidSz;
+		if (!::SetFilePointerEx(_hFile, liPos, NULL, FILE_BEGIN))
+		{
+			//Error
+			CSigRem::ReportOSError(::GetLastError(), L"Failed to set position in journal file: %s", pStrJournalPath);
+			bRes = FALSE;
+		}
+	}
+
+	if (!bRes)
+	{
+		unmapJournal();
+
+		verify(::CloseHandle(_hFile));
+		_hFile = INVALID_HANDLE_VALUE;
+	}
+
+	_uiTicksLastCommit = ::GetTickCount64();
+
+	return bRes;
+}
+
+
+BOOL CSigRemJournal::Close()
+{
+	//Commit pending records and close the journal
+	//RETURN:
+	//		= TRUE if all records were committed
+	BOOL bRes = TRUE;
+
+	if (_hFile != INVALID_HANDLE_VALUE)
+	{
+		bRes = Commit();
+	}
+
+	unmapJournal();
+
+	if (_hFile != INVALID_HANDLE_VALUE)
+	{
+		verify(::CloseHandle(_hFile));
+		_hFile = INVALID_HANDLE_VALUE;
+	}
+
+	_arrPending.clear();
+	_nPendingRecords = 0;
+
+	return bRes;
+}
+
+
+BOOL CSigRemJournal::IsCompleted(LPCTSTR pStrFilePath, ULONGLONG uicbFileSz, const FILETIME& ftLastWrite)
+{
+	//Check if the journal has a completed record for the input file
+	//INFO: Only records that were in the journal when it was opened with 'bResume' are checked.
+	//'pStrFilePath' = input file path (must be the same as it was used with Append)
+	//'uicbFileSz' = size of the input file in BYTEs
+	//'ftLastWrite' = last write time of the input file
+	//RETURN:
+	//		= TRUE if the newest record for 'pStrFilePath' has a completed result for the same size and last write time
+	if (!_pView ||
+		_arrIndex.empty())
+	{
+		return FALSE;
+	}
+
+	size_t szchPath = wcslen(pStrFilePath);
+
+	JOURNAL_INDEX_ENTRY key;
+	key.uiPathHash = hashPath(pStrFilePath, szchPath);
+	key.uiOffset = 0;
+
+	//Entries with the same hash are sorted by offset, so the last matching one is the newest
+	const JOURNAL_RECORD_HDR* pFound = NULL;
+
+	for (std::vector<JOURNAL_INDEX_ENTRY>::const_iterator it = std::lower_bound(_arrIndex.begin(), _arrIndex.end(), key);
+		it != _arrIndex.end() && it->uiPathHash == key.uiPathHash;
+		++it)
+	{
+		const JOURNAL_RECORD_HDR* pHdr = (const JOURNAL_RECORD_HDR*)(_pView + it->uiOffset);
+		if (pHdr->wcchInputPath == szchPath &&
+			::CompareStringOrdinal((const WCHAR*)(pHdr + 1), (int)szchPath, pStrFilePath, (int)szchPath, TRUE) == CSTR_EQUAL)
+		{
+			pFound = pHdr;
+		}
+	}
+
+	return pFound &&
+		isCompletedResult(pFound->nExitCode) &&
+		pFound->uicbInputSz == uicbFileSz &&
+		pFound->ftInputLastWrite.dwLowDateTime == ftLastWrite.dwLowDateTime &&
+		pFound->ftInputLastWrite.dwHighDateTime == ftLastWrite.dwHighDateTime;
+}
+
+
+BOOL CSigRemJournal::Append(LPCTSTR pStrFilePath, ULONGLONG uicbFileSz, const FILETIME& ftLastWrite, EXIT_CODES nResult, LPCTSTR pStrOutputFile, ULONGLONG uicbOutputSz)
+{
+	//Append a record with a result for one input file
+	//INFO: Records are committed to disk in groups - see JOURNAL_GROUP_COMMIT_RECORDS and JOURNAL_GROUP_COMMIT_MS
+	//'pStrFilePath' = input file path
+	//'uicbFileSz' = size of the input file in BYTEs
+	//'ftLastWrite' = last write time of the input file
+	//'nResult' = result of processing 'pStrFilePath'
+	//'pStrOutputFile' = output file path, or NULL if none
+	//'uicbOutputSz' = size of 'pStrOutputFile' in BYTEs
+	//RETURN:
+	//		= TRUE if success
+	if (_hFile == INVALID_HANDLE_VALUE)
+	{
+		//Journal is not opened (or it failed before)
+		return FALSE;
+	}
+
+	size_t szchInput = wcslen(pStrFilePath);
+	size_t szchOutput = pStrOutputFile ? wcslen(pStrOutputFile) : 0;
+	if (szchInput > 0xFFFF ||
+		szchOutput > 0xFFFF)
+	{
+		//Error
+		assert(false);
+		::SetLastError(ERROR_INVALID_PARAMETER);
+		return FALSE;
+	}
+
+	//Records are padded to 8 BYTEs
+	size_t szcbRecord = sizeof(JOURNAL_RECORD_HDR) + (szchInput + szchOutput) * sizeof(WCHAR);
+	szcbRecord = (szcbRecord + 7) & ~(size_t)7;
+
+	size_t szcbOffset = _arrPending.size();
+	_arrPending.resize(szcbOffset + szcbRecord, 0);
+
+	JOURNAL_RECORD_HDR* pHdr = (JOURNAL_RECORD_HDR*)&_arrPending[szcbOffset];
+	pHdr->dwMagic = JOURNAL_RECORD_MAGIC;
+	pHdr->dwcbRecord = (DWORD)szcbRecord;
+	pHdr->dwCheck = 0;
+	pHdr->nExitCode = (int)nResult;
+	pHdr->uicbInputSz = uicbFileSz;
+	pHdr->uicbOutputSz = uicbOutputSz;
+	pHdr->ftInputLastWrite = ftLastWrite;
+	pHdr->wcchInputPath = (WORD)szchInput;
+	pHdr->wcchOutputPath = (WORD)szchOutput;
+	pHdr->dwReserved = 0;
+
+	WCHAR* pPaths = (WCHAR*)(pHdr + 1);
+	memcpy(pPaths, pStrFilePath, szchInput * sizeof(WCHAR));
+	if (szchOutput)
+	{
+		memcpy(pPaths + szchInput, pStrOutputFile, szchOutput * sizeof(WCHAR));
+	}
+
+	pHdr->dwCheck = hashFnv1a32((const BYTE*)pHdr, szcbRecord);
+
+	_nPendingRecords++;
+
+	//See if it's time for a group commit
+	if (_nPendingRecords >= JOURNAL_GROUP_COMMIT_RECORDS ||
+		::GetTickCount64() - _uiTicksLastCommit >= JOURNAL_GROUP_COMMIT_MS)
+	{
+		return Commit();
+	}
+
+	return TRUE;
+}
+
+
+BOOL CSigRemJournal::Commit()
+{
+	//Write pending records and flush them to disk
+	//RETURN:
+	//		= TRUE if success (error is reported otherwise, and the journal is closed)
+	if (_hFile == INVALID_HANDLE_VALUE)
+	{
+		//Journal is not opened
+		return FALSE;
+	}
+
+	BOOL bRes = TRUE;
+
+	if (!_arrPending.empty())
+	{
+		DWORD dwcbPending = (DWORD)_arrPending.size();
+		DWORD dwcbWrtn = 0;
+		if (::WriteFile(_hFile, _arrPending.data(), dwcbPending, &dwcbWrtn, NULL))
+		{
+			if (dwcbWrtn == dwcbPending)
+			{
+				//Make sure it's on disk - once for the entire group
+				if (!::FlushFileBuffers(_hFile))
+				{
+					//Error
+					CSigRem::ReportOSError(::GetLastError(), L"Failed to flush journal file");
+					bRes = FALSE;
+				}
+			}
+			else
+			{
+				//Error
+				CSigRem::ReportOSError(4635, L"Failed to write all data to journal file");
+				bRes = FALSE;
+			}
+		}
+		else
+		{
+			//Error
+			CSigRem::ReportOSError(::GetLastError(), L"Failed to write to journal file");
+			bRes = FALSE;
+		}
+
+		_arrPending.clear();
+		_nPendingRecords = 0;
+	}
+
+	_uiTicksLastCommit = ::GetTickCount64();
+
+	if (!bRes)
+	{
+		//Stop journaling - anything we append after a partial write will be discarded when the journal is opened again
+		unmapJournal();
+
+		verify(::CloseHandle(_hFile));
+		_hFile = INVALID_HANDLE_VALUE;
+	}
+
+	return bRes;
+}
+
+
+ULONGLONG CSigRemJournal::GetCompletedCount()
+{
+	//RETURN:
+	//		= Number of records with completed results that were in the journal when it was opened for resuming
+	return _pView ? _nCompleted : 0;
+}
+
+
+BOOL CSigRemJournal::mapJournal(ULONGLONG& uicbValidSz)
+{
+	//Map the journal file into memory and build the index of its records
+	//'uicbValidSz' = receives the size of the journal in BYTEs that contains only valid records
+	//RETURN:
+	//		= TRUE if success
+	unmapJournal();
+
+	uicbValidSz = 0;
+
+	LARGE_INTEGER liFileSz = {};
+	if (!::GetFileSizeEx(_hFile, &liFileSz))
+		return FALSE;
+
+	if (!liFileSz.QuadPart)
+	{
+		//Empty journal
+		return TRUE;
+	}
+
+	if ((ULONGLONG)liFileSz.QuadPart > (SIZE_T)-1)
+	{
+		//Too large to map
+		::SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+		return FALSE;
+	}
+
+	_hMapping = ::CreateFileMapping(_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!_hMapping)
+		return FALSE;
+
+	_pView = (const BYTE*)::MapViewOfFile(_hMapping, FILE_MAP_READ, 0, 0, 0);
+	if (!_pView)
+	{
+		int nOSErr = ::GetLastError();
+		unmapJournal();
+		::SetLastError(nOSErr);
+		return FALSE;
+	}
+
+	_uicbView = (ULONGLONG)liFileSz.QuadPart;
+
+	//Go through all records until the first one that is not valid
+	ULONGLONG uiOffset = 0;
+	while (uiOffset + sizeof(JOURNAL_RECORD_HDR) <= _uicbView)
+	{
+		const JOURNAL_RECORD_HDR* pHdr = (const JOURNAL_RECORD_HDR*)(_pView + uiOffset);
+		if (pHdr->dwMagic != JOURNAL_RECORD_MAGIC ||
+			pHdr->dwcbRecord < sizeof(JOURNAL_RECORD_HDR) ||
+			(pHdr->dwcbRecord & 7) ||
+			uiOffset + pHdr->dwcbRecord > _uicbView ||
+			sizeof(JOURNAL_RECORD_HDR) + ((size_t)pHdr->wcchInputPath + pHdr->wcchOutputPath) * sizeof(WCHAR) > pHdr->dwcbRecord)
+		{
+			break;
+		}
+
+		//Check is calculated with 'dwCheck' set to 0
+		const DWORD dwZero = 0;
+		const size_t szcbCheckOffset = FIELD_OFFSET(JOURNAL_RECORD_HDR, dwCheck);
+		DWORD dwCheck = hashFnv1a32((const BYTE*)pHdr, szcbCheckOffset);
+		dwCheck = hashFnv1a32((const BYTE*)&dwZero, sizeof(dwZero), dwCheck);
+		dwCheck = hashFnv1a32((const BYTE*)pHdr + szcbCheckOffset + sizeof(dwZero), pHdr->dwcbRecord - szcbCheckOffset - sizeof(dwZero), dwCheck);
+		if (dwCheck != pHdr->dwCheck)
+			break;
+
+		JOURNAL_INDEX_ENTRY entry;
+		entry.uiPathHash = hashPath((const WCHAR*)(pHdr + 1), pHdr->wcchInputPath);
+		entry.uiOffset = uiOffset;
+		_arrIndex.push_back(entry);
+
+		if (isCompletedResult(pHdr->nExitCode))
+			_nCompleted++;
+
+		uiOffset += pHdr->dwcbRecord;
+	}
+
+	uicbValidSz = uiOffset;
+
+	std::sort(_arrIndex.begin(), _arrIndex.end());
+
+	return TRUE;
+}
+
+
+void CSigRemJournal::unmapJournal()
+{
+	if (_pView)
+	{
+		verify(::UnmapViewOfFile(_pView));
+		_pView = NULL;
+	}
+
+	if (_hMapping)
+	{
+		verify(::CloseHandle(_hMapping));
+		_hMapping = NULL;
+	}
+
+	_uicbView = 0;
+	_nCompleted = 0;
+	_arrIndex.clear();
+}
+
+
+BOOL CSigRemJournal::isCompletedResult(int nExitCode)
+{
+	//RETURN:
+	//		= TRUE if 'nExitCode' is a final result that doesn't need to be retried
+	return nExitCode == XC_Success ||
+		nExitCode == XC_BinaryHasNoSignature ||
+		nExitCode == XC_Not_PE_File;
+}
+
+
+DWORD CSigRemJournal::hashFnv1a32(const BYTE* pData, size_t szcbData, DWORD dwHash)
+{
+	//'dwHash' = hash of the preceding data (to hash data in pieces)
+	//RETURN:
+	//		= FNV-1a 32-bit hash of 'pData'
+	for (size_t i = 0; i < szcbData; i++)
+	{
+		dwHash ^= pData[i];
+		dwHash *= 0x01000193;
+	}
+
+	return dwHash;
+}
+
+
+ULONGLONG CSigRemJournal::hashPath(const WCHAR* pStrPath, size_t szchPath)
+{
+	//RETURN:
+	//		= FNV-1a 64-bit hash of 'pStrPath' with ASCII letters folded to lower case
+	//		  (other letters are hashed as-is, so their case variations may only cause a miss, not a false match)
+	ULONGLONG uiHash = 0xCBF29CE484222325;
+
+	for (size_t i = 0; i < szchPath; i++)
+	{
+		WCHAR z = pStrPath[i];
+		if (z >= L'A' && z <= L'Z')
+			z += L'a' - L'A';
+
+		uiHash ^= (WORD)z;
+		uiHash *= 0x100000001B3;
+	}
+
+	return uiHash;
+}
@@ -0,0 +1,109 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+//Persistent journal of per-file results for resumable batch runs
+#pragma once
+
+#include "CSigRem.h"
+
+#include <vector>
+
+
+
+#define JOURNAL_RECORD_MAGIC 0x4A524753			//'SGRJ' - marks the beginning of each journal record
+#define JOURNAL_GROUP_COMMIT_RECORDS 256		//Max number of records that are kept in memory before they are committed to disk
+#define JOURNAL_GROUP_COMMIT_MS 1000			//Max time in ms that records are kept in memory before they are committed to disk
+
+
+
+struct JOURNAL_RECORD_HDR
+{
+	DWORD dwMagic;							//JOURNAL_RECORD_MAGIC
+	DWORD dwcbRecord;						//Size of this record in BYTEs, including this header and both paths
+	DWORD dwCheck;							//FNV-1a hash of the record (calculated with this member set to 0) - to detect torn writes
+	int nExitCode;							//Result of processing the input file, one of EXIT_CODES
+	ULONGLONG uicbInputSz;					//Size of the input file in BYTEs
+	ULONGLONG uicbOutputSz;					//Size of the output file in BYTEs (valid only if 'nExitCode' is XC_Success)
+	FILETIME ftInputLastWrite;				//Last write time of the input file
+	WORD wcchInputPath;						//Length of the input file path in WCHARs (without terminating null)
+	WORD wcchOutputPath;					//Length of the output file path in WCHARs (without terminating null), or 0 if no output
+	DWORD dwReserved;						//Set to 0
+
+	//Followed by:
+	//	WCHAR input path [wcchInputPath]
+	//	WCHAR output path [wcchOutputPath]
+	//	padding to the 8-BYTE boundary
+};
+
+
+struct JOURNAL_INDEX_ENTRY
+{
+	ULONGLONG uiPathHash;					//Case-insensitive FNV-1a hash of the input file path
+	ULONGLONG uiOffset;						//Offset of the record in the journal file, in BYTEs
+
+	bool operator<(const JOURNAL_INDEX_ENTRY& other) const
+	{
+		if (uiPathHash != other.uiPathHash)
+			return uiPathHash < other.uiPathHash;
+
+		return uiOffset < other.uiOffset;
+	}
+};
+
+
+
+class CSigRemJournal
+{
+	//IMPORTANT: This class is not thread-safe!
+public:
+	CSigRemJournal();
+	~CSigRemJournal();
+
+	BOOL Open(LPCTSTR pStrJournalPath, BOOL bResume);
+	BOOL Close();
+	BOOL IsCompleted(LPCTSTR pStrFilePath, ULONGLONG uicbFileSz, const FILETIME& ftLastWrite);
+	BOOL Append(LPCTSTR pStrFilePath, ULONGLONG uicbFileSz, const FILETIME& ftLastWrite, EXIT_CODES nResult, LPCTSTR pStrOutputFile, ULONGLONG uicbOutputSz);
+	BOOL Commit();
+	ULONGLONG GetCompletedCount();
+
+protected:
+	BOOL mapJournal(ULONGLONG& uicbValidSz);
+	void unmapJournal();
+	static BOOL isCompletedResult(int nExitCode);
+	static DWORD hashFnv1a32(const BYTE* pData, size_t szcbData, DWORD dwHash = 0x811C9DC5);
+	static ULONGLONG hashPath(const WCHAR* pStrPath, size_t szchPath);
+
+private:
+	HANDLE _hFile;									//Journal file, or INVALID_HANDLE_VALUE if not opened
+	HANDLE _hMapping;								//Mapping of the journal file for resume, or NULL
+	const BYTE* _pView;								//Mapped view of '_hMapping', or NULL
+	ULONGLONG _uicbView;							//Size of '_pView' in BYTEs
+	std::vector<JOURNAL_INDEX_ENTRY> _arrIndex;		//Index of records in '_pView', sorted by path hash and offset
+	ULONGLONG _nCompleted;							//Number of records in '_pView' with a completed result
+	std::vector<BYTE> _arrPending;					//Records that were not committed to disk yet
+	size_t _nPendingRecords;						//Number of records in '_arrPending'
+	ULONGLONG _uiTicksLastCommit;					//GetTickCount64() when records were last committed
+};
+
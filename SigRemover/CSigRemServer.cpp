@@ -0,0 +1,444 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+
+#include "CSigRemServer.h"
+#include "CWorkerPool.h"
+
+
+
+
+HANDLE CSigRemServer::_hStopEvent = NULL;
+
+
+
+CSigRemServer::CSigRemServer()
+{
+	_ioPolicy = SIP_Buffered;
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+
+CSigRemServer::~CSigRemServer()
+{
+}
+
+
+EXIT_CODES CSigRemServer::Run(LPCTSTR pStrPipeName, SIGREM_IO_POLICY ioPolicy, DWORD nInstances)
+{
+	//Serve requests from clients until Ctrl+C is pressed
+	//'pStrPipeName' = name of the pipe to listen on (with or without SIGREM_PIPE_PREFIX)
+	//'ioPolicy' = how to read and write files
+	//'nInstances' = number of pipe instances (or requests that can be processed concurrently), or 0 for the number of CPUs
+	//RETURN:
+	//		= XC_Success if the server was stopped by the user
+	//		= Other value if error
+	EXIT_CODES nResult = XC_GEN_FAILURE;
+
+	memset(&_stats, 0, sizeof(_stats));
+	_ioPolicy = ioPolicy;
+
+	if (!nInstances)
+		nInstances = CWorkerPool::GetDefaultThreadCount();
+
+	std::wstring strPipePath = CSigRem::MakePipePath(pStrPipeName);
+
+	//Allocate all buffers before the first request comes in
+	if (_buffPool.Init(nInstances, SERVER_POOL_BUFF_SIZE))
+	{
+		_hStopEvent = ::CreateEvent(NULL, TRUE, FALSE, NULL);
+		if (_hStopEvent)
+		{
+			verify(::SetConsoleCtrlHandler(onConsoleCtrl, TRUE));
+
+			std::vector<SERVER_INSTANCE> arrInstances(nInstances);
+			DWORD nStarted = 0;
+
+			for (; nStarted < nInstances; nStarted++)
+			{
+				SERVER_INSTANCE& inst = arrInstances[nStarted];
+				inst.pThis = this;
+				inst.hThread = NULL;
+
+				//The first instance makes sure that no one else owns the pipe name
+				inst.hPipe = ::CreateNamedPipe(strPipePath.c_str(),
+					PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED | (nStarted ? 0 : FILE_FLAG_FIRST_PIPE_INSTANCE),
+					PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+					PIPE_UNLIMITED_INSTANCES,
+					sizeof(SIGREM_PIPE_REPLY),
+					SIGREM_PIPE_MAX_REQUEST,
+					0,
+					NULL);
+				if (inst.hPipe == INVALID_HANDLE_VALUE)
+				{
+					//Error
+					CSigRem::ReportOSError(::GetLastError(), L"Failed to create pipe: %s", strPipePath.c_str());
+					break;
+				}
+
+				inst.hThread = ::CreateThread(NULL, 0, threadInstance, &inst, 0, NULL);
+				if (!inst.hThread)
+				{
+					//Error
+					CSigRem::ReportOSError(::GetLastError(), L"Failed to start server thread");
+
+					verify(::CloseHandle(inst.hPipe));
+					inst.hPipe = INVALID_HANDLE_VALUE;
+					break;
+				}
+			}
+
+			if (nStarted == nInstances)
+			{
+				nResult = XC_Success;
+
+				wprintf(L"Listening on pipe with %u instances (press Ctrl+C to stop): %s\n", nInstances, strPipePath.c_str());
+			}
+			else
+			{
+				//Stop whatever we've started
+				verify(::SetEvent(_hStopEvent));
+			}
+
+			//Wait for all threads (they return when the stop event is set)
+			for (DWORD i = 0; i < nStarted; i++)
+			{
+				SERVER_INSTANCE& inst = arrInstances[i];
+
+				verify(::WaitForSingleObject(inst.hThread, INFINITE) == WAIT_OBJECT_0);
+				verify(::CloseHandle(inst.hThread));
+				verify(::CloseHandle(inst.hPipe));
+			}
+
+			verify(::SetConsoleCtrlHandler(onConsoleCtrl, FALSE));
+
+			verify(::CloseHandle(_hStopEvent));
+			_hStopEvent = NULL;
+
+			if (nResult == XC_Success)
+			{
+				showSummary();
+			}
+		}
+		else
+			CSigRem::ReportOSError(::GetLastError(), L"Failed to create stop event");
+
+		_buffPool.Free();
+	}
+	else
+		CSigRem::ReportOSError(::GetLastError(), L"Failed to reserve memory for server buffers");
+
+	return nResult;
+}
+
+
+BOOL WINAPI CSigRemServer::onConsoleCtrl(DWORD dwCtrlType)
+{
+	//Called on a separate thread when Ctrl+C is pressed, or the console is closed
+	switch (dwCtrlType)
+	{
+	case CTRL_C_EVENT:
+	case CTRL_BREAK_EVENT:
+	case CTRL_CLOSE_EVENT:
+		if (_hStopEvent)
+		{
+			verify(::SetEvent(_hStopEvent));
+			return TRUE;
+		}
+		break;
+	}
+
+	return FALSE;
+}
+
+
+DWORD WINAPI CSigRemServer::threadInstance(LPVOID lpParameter)
+{
+	//Thread that serves one pipe instance
+	SERVER_INSTANCE* pInst = (SERVER_INSTANCE*)lpParameter;
+	assert(pInst);
+
+	pInst->pThis->serveInstance(pInst->hPipe);
+
+	return 0;
+}
+
+
+void CSigRemServer::serveInstance(HANDLE hPipe)
+{
+	//Serve clients on one pipe instance, one client at a time, until the stop event is set
+	OVERLAPPED ov = {};
+	ov.hEvent = ::CreateEvent(NULL, TRUE, FALSE, NULL);
+	BYTE* pReq = new (std::nothrow) BYTE[SIGREM_PIPE_MAX_REQUEST];
+
+	if (ov.hEvent &&
+		pReq)
+	{
+		for (;;)
+		{
+			//Wait for a client to connect
+			verify(::ResetEvent(ov.hEvent));
+
+			BOOL bConnected = ::ConnectNamedPipe(hPipe, &ov);
+			if (!bConnected)
+			{
+				int nOSErr = ::GetLastError();
+				if (nOSErr == ERROR_PIPE_CONNECTED)
+				{
+					//Client connected before we called it
+					bConnected = TRUE;
+				}
+				else if (nOSErr == ERROR_IO_PENDING)
+				{
+					DWORD dwcbDummy;
+					bConnected = waitIo(hPipe, &ov, dwcbDummy);
+				}
+				else
+				{
+					//Error
+					CSigRem::ReportOSError(nOSErr, L"Failed to wait for a client");
+				}
+			}
+
+			if (!bConnected)
+			{
+				//Stop or error
+				break;
+			}
+
+			//Serve requests until the client disconnects
+			for (;;)
+			{
+				verify(::ResetEvent(ov.hEvent));
+
+				DWORD dwcbReq = 0;
+				if (!::ReadFile(hPipe, pReq, SIGREM_PIPE_MAX_REQUEST, NULL, &ov) &&
+					::GetLastError() != ERROR_IO_PENDING)
+				{
+					//Client disconnected, or sent a message that is too large
+					break;
+				}
+
+				if (!waitIo(hPipe, &ov, dwcbReq))
+					break;
+
+				SIGREM_PIPE_REPLY reply;
+				processRequest(hPipe, pReq, dwcbReq, reply);
+
+				verify(::ResetEvent(ov.hEvent));
+
+				DWORD dwcbWrtn = 0;
+				if (!::WriteFile(hPipe, &reply, sizeof(reply), NULL, &ov) &&
+					::GetLastError() != ERROR_IO_PENDING)
+				{
+					//Client disconnected
+					break;
+				}
+
+				if (!waitIo(hPipe, &ov, dwcbWrtn) ||
+					dwcbWrtn != sizeof(reply))
+				{
+					break;
+				}
+			}
+
+			verify(::DisconnectNamedPipe(hPipe));
+
+			if (::WaitForSingleObject(_hStopEvent, 0) == WAIT_OBJECT_0)
+			{
+				//Stop
+				break;
+			}
+		}
+	}
+	else
+		CSigRem::ReportOSError(ERROR_OUTOFMEMORY, L"Failed to initialize server thread");
+
+	//Free mem
+	if (pReq)
+	{
+		delete[] pReq;
+		pReq = NULL;
+	}
+
+	if (ov.hEvent)
+	{
+		verify(::CloseHandle(ov.hEvent));
+		ov.hEvent = NULL;
+	}
+}
+
+
+void CSigRemServer::processRequest(HANDLE hPipe, const BYTE* pReq, DWORD dwcbReq, SIGREM_PIPE_REPLY& reply)
+{
+	//Process one request from a client
+	//'hPipe' = pipe instance the request came from
+	//'pReq' = request data
+	//'dwcbReq' = size of 'pReq' in BYTEs
+	//'reply' = receives the reply to send back
+	::InterlockedIncrement64(&_stats.nRequests);
+
+	reply.dwMagic = SIGREM_PIPE_REPLY_MAGIC;
+	reply.nExitCode = XC_GEN_FAILURE;
+	reply.uicbInputSz = 0;
+	reply.uicbOutputSz = 0;
+
+	//Validate request
+	const SIGREM_PIPE_REQUEST* pHdr = (const SIGREM_PIPE_REQUEST*)pReq;
+	if (dwcbReq < sizeof(SIGREM_PIPE_REQUEST) ||
+		pHdr->dwMagic != SIGREM_PIPE_REQUEST_MAGIC ||
+		pHdr->dwVersion != SIGREM_PIPE_VERSION ||
+		pHdr->dwcbRequest != dwcbReq ||
+		sizeof(SIGREM_PIPE_REQUEST) + ((size_t)pHdr->wcchInputPath + pHdr->wcchOutputPath) * sizeof(WCHAR) != dwcbReq)
+	{
+		//Error
+		::InterlockedIncrement64(&_stats.nFailed);
+		return;
+	}
+
+	const WCHAR* pPaths = (const WCHAR*)(pHdr + 1);
+	std::wstring strInputFile(pPaths, pHdr->wcchInputPath);
+	std::wstring strOutputFile(pPaths + pHdr->wcchInputPath, pHdr->wcchOutputPath);
+
+	SIGREM_PARAMS params = {};
+	params.pBuffPool = &_buffPool;
+	params.dwFlags = SRF_QUIET_SKIPPED;
+	params.ioPolicy = _ioPolicy;
+
+	SIGREM_RESULTS results = {};
+	EXIT_CODES nResult = XC_GEN_FAILURE;
+
+	if (pHdr->dwFlags & SPF_INPUT_HANDLE)
+	{
+		//We need a path for the output, at least
+		if (strInputFile.empty() &&
+			strOutputFile.empty())
+		{
+			//Error
+			::InterlockedIncrement64(&_stats.nFailed);
+			return;
+		}
+
+		//Get the handle from the client process (the process ID comes from the system, so the client can't fake it)
+		nResult = XC_FailedToOpen;
+
+		ULONG uiClientPID = 0;
+		if (::GetNamedPipeClientProcessId(hPipe, &uiClientPID))
+		{
+			HANDLE hClientProc = ::OpenProcess(PROCESS_DUP_HANDLE, FALSE, uiClientPID);
+			if (hClientProc)
+			{
+				HANDLE hFile = NULL;
+				if (::DuplicateHandle(hClientProc, (HANDLE)(ULONG_PTR)pHdr->hInputFile, ::GetCurrentProcess(), &hFile, 0, FALSE, DUPLICATE_SAME_ACCESS))
+				{
+					//Must be a file
+					if (::GetFileType(hFile) == FILE_TYPE_DISK)
+					{
+						nResult = CSigRem::RemoveDigitalSignatureFromHandle(hFile,
+							strInputFile.empty() ? strOutputFile.c_str() : strInputFile.c_str(),
+							strOutputFile.c_str(),
+							&results,
+							&params);
+					}
+					else
+						CSigRem::ReportOSError(ERROR_INVALID_HANDLE, L"Client passed a handle that is not a file (PID=%u)", uiClientPID);
+
+					verify(::CloseHandle(hFile));
+				}
+				else
+					CSigRem::ReportOSError(::GetLastError(), L"Failed to get file handle from client (PID=%u)", uiClientPID);
+
+				verify(::CloseHandle(hClientProc));
+			}
+			else
+				CSigRem::ReportOSError(::GetLastError(), L"Failed to open client process (PID=%u)", uiClientPID);
+		}
+		else
+			CSigRem::ReportOSError(::GetLastError(), L"Failed to get client process ID");
+	}
+	else
+	{
+		nResult = CSigRem::RemoveDigitalSignature(strInputFile.c_str(), strOutputFile.c_str(), &results, &params);
+	}
+
+	reply.nExitCode = nResult;
+	reply.uicbInputSz = results.uicbInputSz;
+	reply.uicbOutputSz = results.uicbOutputSz;
+
+	switch (nResult)
+	{
+	case XC_Success:
+		::InterlockedIncrement64(&_stats.nSuccess);
+		break;
+
+	case XC_BinaryHasNoSignature:
+	case XC_Not_PE_File:
+		break;
+
+	default:
+		::InterlockedIncrement64(&_stats.nFailed);
+		break;
+	}
+}
+
+
+BOOL CSigRemServer::waitIo(HANDLE hPipe, OVERLAPPED* pOv, DWORD& dwcbTransferred)
+{
+	//Wait for overlapped I/O on the pipe to complete, or for the stop event
+	//'dwcbTransferred' = receives number of BYTEs transferred
+	//RETURN:
+	//		= TRUE if I/O completed successfully
+	//		= FALSE if I/O failed or was cancelled because of the stop event
+	HANDLE hWaits[] = { _hStopEvent, pOv->hEvent };
+	DWORD dwRW = ::WaitForMultipleObjects(_countof(hWaits), hWaits, FALSE, INFINITE);
+	if (dwRW != WAIT_OBJECT_0 + 1)
+	{
+		//Stop (or error) - cancel I/O and wait for it to go away
+		::CancelIoEx(hPipe, pOv);
+
+		DWORD dwcbDummy;
+		::GetOverlappedResult(hPipe, pOv, &dwcbDummy, TRUE);
+
+		return FALSE;
+	}
+
+	return ::GetOverlappedResult(hPipe, pOv, &dwcbTransferred, FALSE);
+}
+
+
+void CSigRemServer::showSummary()
+{
+	//Output server results to the console
+	wprintf(
+		L"\n"
+		L"Requests served:        %lld\n"
+		L"Signatures removed:     %lld\n"
+		L"Failed:                 %lld\n"
+		,
+		_stats.nRequests,
+		_stats.nSuccess,
+		_stats.nFailed
+	);
+}
@@ -0,0 +1,82 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+//Long-running server that removes digital signatures on requests from local clients over a named pipe
+#pragma once
+
+#include "CSigRem.h"
+#include "CBuffPool.h"
+
+#include <string>
+#include <vector>
+
+
+
+#define SERVER_POOL_BUFF_SIZE 0x1000000		//Size of each pre-allocated buffer for file data, in BYTEs (larger files use regular allocations)
+
+
+
+struct SERVER_STATS
+{
+	volatile LONGLONG nRequests;			//Number of requests served
+	volatile LONGLONG nSuccess;				//Number of requests that removed a signature
+	volatile LONGLONG nFailed;				//Number of requests that failed
+};
+
+
+class CSigRemServer;
+
+struct SERVER_INSTANCE
+{
+	CSigRemServer* pThis;
+	HANDLE hPipe;							//Pipe instance served by this thread
+	HANDLE hThread;							//Thread that serves 'hPipe'
+};
+
+
+
+class CSigRemServer
+{
+public:
+	CSigRemServer();
+	~CSigRemServer();
+
+	EXIT_CODES Run(LPCTSTR pStrPipeName, SIGREM_IO_POLICY ioPolicy = SIP_Buffered, DWORD nInstances = 0);
+
+protected:
+	static BOOL WINAPI onConsoleCtrl(DWORD dwCtrlType);
+	static DWORD WINAPI threadInstance(LPVOID lpParameter);
+	void serveInstance(HANDLE hPipe);
+	void processRequest(HANDLE hPipe, const BYTE* pReq, DWORD dwcbReq, SIGREM_PIPE_REPLY& reply);
+	BOOL waitIo(HANDLE hPipe, OVERLAPPED* pOv, DWORD& dwcbTransferred);
+	void showSummary();
+
+private:
+	static HANDLE _hStopEvent;							//Manual-reset event that is set to stop the server
+	CBuffPool _buffPool;
+	SIGREM_IO_POLICY _ioPolicy;							//How to read and write files
+	SERVER_STATS _stats;
+};
+
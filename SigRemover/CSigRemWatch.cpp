@@ -0,0 +1,630 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+
+#include "CSigRemWatch.h"
+
+
+
+
+HANDLE CSigRemWatch::_hStopEvent = NULL;
+
+
+
+CSigRemWatch::CSigRemWatch()
+{
+	::InitializeSRWLock(&_lockInFlight);
+
+	_liFreq = 1;
+	_ftStart.dwLowDateTime = 0;
+	_ftStart.dwHighDateTime = 0;
+	_ioPolicy = SIP_Buffered;
+
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+
+CSigRemWatch::~CSigRemWatch()
+{
+	//Wait for workers before anything else goes away
+	_workers.Close();
+}
+
+
+EXIT_CODES CSigRemWatch::Watch(LPCTSTR pStrFolderPath, LPCTSTR pStrOutputFolder, SIGREM_IO_POLICY ioPolicy)
+{
+	//Watch a folder and remove digital signatures from PE files as soon as they are closed by whoever writes them
+	//INFO: Runs until Ctrl+C is pressed. Subfolders are not watched.
+	//'pStrFolderPath' = folder to watch
+	//'pStrOutputFolder' = if not NULL, and not L"", folder to write output files into (with the same names),
+	//                     otherwise output files will have the file suffix in the same folder
+	//'ioPolicy' = how to read and write files
+	//RETURN:
+	//		= XC_Success if watching was stopped by the user
+	//		= Other value if error
+	EXIT_CODES nResult = XC_FailedToOpen;
+
+	memset(&_stats, 0, sizeof(_stats));
+	_mapPending.clear();
+	_ioPolicy = ioPolicy;
+
+	LARGE_INTEGER liFreq = {};
+	::QueryPerformanceFrequency(&liFreq);
+	_liFreq = liFreq.QuadPart ? liFreq.QuadPart : 1;
+
+	::GetSystemTimeAsFileTime(&_ftStart);
+
+	//Use full paths
+	WCHAR buffPath[MAX_PATH * 4];
+	DWORD dwchPath = ::GetFullPathName(pStrFolderPath, _countof(buffPath), buffPath, NULL);
+	if (!dwchPath ||
+		dwchPath >= _countof(buffPath))
+	{
+		//Error
+		CSigRem::ReportOSError(dwchPath ? ERROR_INSUFFICIENT_BUFFER : ::GetLastError(), L"Failed to get full path for folder: %s", pStrFolderPath);
+		return XC_FailedToOpen;
+	}
+
+	_strFolder = buffPath;
+	if (_strFolder.back() != L'\\')
+		_strFolder += L'\\';
+
+	_strOutputFolder.clear();
+	if (pStrOutputFolder &&
+		pStrOutputFolder[0])
+	{
+		dwchPath = ::GetFullPathName(pStrOutputFolder, _countof(buffPath), buffPath, NULL);
+		if (!dwchPath ||
+			dwchPath >= _countof(buffPath))
+		{
+			//Error
+			CSigRem::ReportOSError(dwchPath ? ERROR_INSUFFICIENT_BUFFER : ::GetLastError(), L"Failed to get full path for folder: %s", pStrOutputFolder);
+			return XC_FailedToOpen;
+		}
+
+		_strOutputFolder = buffPath;
+		if (_strOutputFolder.back() != L'\\')
+			_strOutputFolder += L'\\';
+
+		//We'd overwrite input files
+		if (::CompareStringOrdinal(_strFolder.c_str(), -1, _strOutputFolder.c_str(), -1, TRUE) == CSTR_EQUAL)
+		{
+			//Error
+			CSigRem::ReportOSError(22, L"Output folder must be different from the watched folder: %s", pStrOutputFolder);
+			return XC_GEN_FAILURE;
+		}
+
+		DWORD dwAttrs = ::GetFileAttributes(_strOutputFolder.c_str());
+		if (dwAttrs == INVALID_FILE_ATTRIBUTES ||
+			!(dwAttrs & FILE_ATTRIBUTE_DIRECTORY))
+		{
+			//Error
+			CSigRem::ReportOSError(dwAttrs == INVALID_FILE_ATTRIBUTES ? ::GetLastError() : ERROR_DIRECTORY, L"Output folder does not exist: %s", pStrOutputFolder);
+			return XC_FailedToOpen;
+		}
+	}
+
+	HANDLE hDir = ::CreateFile(_strFolder.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+	if (hDir != INVALID_HANDLE_VALUE)
+	{
+		//Start all workers and allocate their buffers before any files arrive
+		if (_workers.Init())
+		{
+			if (_buffPool.Init(_workers.GetThreadCount(), WATCH_POOL_BUFF_SIZE))
+			{
+				OVERLAPPED ov = {};
+				ov.hEvent = ::CreateEvent(NULL, TRUE, FALSE, NULL);
+				_hStopEvent = ::CreateEvent(NULL, TRUE, FALSE, NULL);
+				DWORD* pNotifyBuff = new (std::nothrow) DWORD[WATCH_NOTIFY_BUFF_SIZE / sizeof(DWORD)];
+
+				if (ov.hEvent &&
+					_hStopEvent &&
+					pNotifyBuff)
+				{
+					verify(::SetConsoleCtrlHandler(onConsoleCtrl, TRUE));
+
+					const DWORD dwNotifyFilter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE;
+					if (::ReadDirectoryChangesW(hDir, pNotifyBuff, WATCH_NOTIFY_BUFF_SIZE, FALSE, dwNotifyFilter, NULL, &ov, NULL))
+					{
+						BOOL bIoPending = TRUE;
+						nResult = XC_Success;
+
+						wprintf(L"Watching folder (press Ctrl+C to stop): %s\n", _strFolder.c_str());
+
+						for (;;)
+						{
+							HANDLE hWaits[] = { _hStopEvent, ov.hEvent };
+							DWORD dwRW = ::WaitForMultipleObjects(_countof(hWaits), hWaits, FALSE, getPendingTimeout());
+							if (dwRW == WAIT_OBJECT_0)
+							{
+								//Stop
+								break;
+							}
+							else if (dwRW == WAIT_OBJECT_0 + 1)
+							{
+								//Got notifications
+								LARGE_INTEGER liNow;
+								::QueryPerformanceCounter(&liNow);
+
+								bIoPending = FALSE;
+
+								DWORD dwcbNotify = 0;
+								if (::GetOverlappedResult(hDir, &ov, &dwcbNotify, FALSE))
+								{
+									if (dwcbNotify)
+									{
+										for (BYTE* pS = (BYTE*)pNotifyBuff;;)
+										{
+											FILE_NOTIFY_INFORMATION* pFNI = (FILE_NOTIFY_INFORMATION*)pS;
+											size_t szchName = pFNI->FileNameLength / sizeof(WCHAR);
+
+											switch (pFNI->Action)
+											{
+											case FILE_ACTION_ADDED:
+											case FILE_ACTION_MODIFIED:
+											case FILE_ACTION_RENAMED_NEW_NAME:
+												addPending(pFNI->FileName, szchName, liNow.QuadPart);
+												break;
+
+											case FILE_ACTION_REMOVED:
+											case FILE_ACTION_RENAMED_OLD_NAME:
+												_mapPending.erase(std::wstring(pFNI->FileName, szchName));
+												break;
+											}
+
+											if (!pFNI->NextEntryOffset)
+												break;
+
+											pS += pFNI->NextEntryOffset;
+										}
+									}
+									else
+									{
+										//Notification buffer overflowed - we lost some changes
+										rescanFolder();
+									}
+								}
+								else
+								{
+									int nOSErr = ::GetLastError();
+									if (nOSErr == ERROR_NOTIFY_ENUM_DIR)
+									{
+										//Same as above
+										rescanFolder();
+									}
+									else
+									{
+										//Error
+										CSigRem::ReportOSError(nOSErr, L"Failed to watch folder: %s", _strFolder.c_str());
+										nResult = XC_GEN_FAILURE;
+										break;
+									}
+								}
+
+								//Wait for the next changes
+								verify(::ResetEvent(ov.hEvent));
+								if (!::ReadDirectoryChangesW(hDir, pNotifyBuff, WATCH_NOTIFY_BUFF_SIZE, FALSE, dwNotifyFilter, NULL, &ov, NULL))
+								{
+									//Error
+									CSigRem::ReportOSError(::GetLastError(), L"Failed to watch folder: %s", _strFolder.c_str());
+									nResult = XC_GEN_FAILURE;
+									break;
+								}
+
+								bIoPending = TRUE;
+							}
+							else if (dwRW != WAIT_TIMEOUT)
+							{
+								//Error
+								CSigRem::ReportOSError(::GetLastError(), L"Failed to wait for folder changes: %s", _strFolder.c_str());
+								nResult = XC_GEN_FAILURE;
+								break;
+							}
+
+							//Start files that are ready
+							dispatchPending();
+						}
+
+						if (bIoPending)
+						{
+							//Stop watching
+							::CancelIoEx(hDir, &ov);
+
+							DWORD dwcbDummy;
+							::GetOverlappedResult(hDir, &ov, &dwcbDummy, TRUE);
+						}
+					}
+					else
+						CSigRem::ReportOSError(::GetLastError(), L"Failed to watch folder: %s", _strFolder.c_str());
+
+					verify(::SetConsoleCtrlHandler(onConsoleCtrl, FALSE));
+
+					//Let workers finish what they started
+					_workers.WaitAll();
+
+					showSummary();
+				}
+				else
+					CSigRem::ReportOSError(::GetLastError(), L"Failed to initialize folder watch");
+
+				//Free mem
+				if (pNotifyBuff)
+				{
+					delete[] pNotifyBuff;
+					pNotifyBuff = NULL;
+				}
+
+				if (_hStopEvent)
+				{
+					verify(::CloseHandle(_hStopEvent));
+					_hStopEvent = NULL;
+				}
+
+				if (ov.hEvent)
+				{
+					verify(::CloseHandle(ov.hEvent));
+					ov.hEvent = NULL;
+				}
+			}
+			else
+				CSigRem::ReportOSError(::GetLastError(), L"Failed to reserve memory for worker buffers");
+
+			_workers.Close();
+		}
+		else
+			CSigRem::ReportOSError(::GetLastError(), L"Failed to start worker threads");
+
+		//Close handle
+		verify(::CloseHandle(hDir));
+	}
+	else
+	{
+		//Error
+		CSigRem::ReportOSError(::GetLastError(), L"Failed to open folder to watch: %s", pStrFolderPath);
+	}
+
+	return nResult;
+}
+
+
+BOOL WINAPI CSigRemWatch::onConsoleCtrl(DWORD dwCtrlType)
+{
+	//Called on a separate thread when Ctrl+C is pressed, or the console is closed
+	switch (dwCtrlType)
+	{
+	case CTRL_C_EVENT:
+	case CTRL_BREAK_EVENT:
+	case CTRL_CLOSE_EVENT:
+		if (_hStopEvent)
+		{
+			verify(::SetEvent(_hStopEvent));
+			return TRUE;
+		}
+		break;
+	}
+
+	return FALSE;
+}
+
+
+VOID CALLBACK CSigRemWatch::onWorkItem(PTP_CALLBACK_INSTANCE Instance, PVOID pContext)
+{
+	//Called on a worker thread
+	UNREFERENCED_PARAMETER(Instance);
+
+	WATCH_ITEM* pItem = (WATCH_ITEM*)pContext;
+	assert(pItem);
+
+	pItem->pThis->processWorkItem(pItem);
+}
+
+
+void CSigRemWatch::processWorkItem(WATCH_ITEM* pItem)
+{
+	//Process one file on a worker thread
+	//'pItem' = file to process - it will be deleted here
+	SIGREM_PARAMS params = {};
+	params.pBuffPool = &_buffPool;
+	params.dwFlags = SRF_QUIET_SKIPPED;
+	params.ioPolicy = _ioPolicy;
+
+	SIGREM_RESULTS results = {};
+	EXIT_CODES nResult = CSigRem::RemoveDigitalSignatureFromHandle(pItem->hFile,
+		pItem->strFilePath.c_str(),
+		pItem->strOutputFile.empty() ? NULL : pItem->strOutputFile.c_str(),
+		&results,
+		&params);
+
+	verify(::CloseHandle(pItem->hFile));
+	pItem->hFile = INVALID_HANDLE_VALUE;
+
+	LARGE_INTEGER liNow;
+	::QueryPerformanceCounter(&liNow);
+
+	switch (nResult)
+	{
+	case XC_Success:
+	{
+		::InterlockedIncrement64(&_stats.nSuccess);
+
+		LONGLONG nLatencyUs = (liNow.QuadPart - pItem->liTimeEvent) * 1000000 / _liFreq;
+		::InterlockedExchangeAdd64(&_stats.nLatencyTotalUs, nLatencyUs);
+
+		for (LONGLONG nMax = _stats.nLatencyMaxUs; nLatencyUs > nMax; nMax = _stats.nLatencyMaxUs)
+		{
+			if (::InterlockedCompareExchange64(&_stats.nLatencyMaxUs, nLatencyUs, nMax) == nMax)
+				break;
+		}
+	}
+	break;
+
+	case XC_BinaryHasNoSignature:
+	case XC_Not_PE_File:
+		//Nothing to do
+		break;
+
+	default:
+		::InterlockedIncrement64(&_stats.nFailed);
+		break;
+	}
+
+	//The file may be dispatched again
+	std::wstring strName = pItem->strFilePath.substr(_strFolder.size());
+
+	::AcquireSRWLockExclusive(&_lockInFlight);
+	_setInFlight.erase(strName);
+	::ReleaseSRWLockExclusive(&_lockInFlight);
+
+	delete pItem;
+}
+
+
+void CSigRemWatch::addPending(const WCHAR* pStrFileName, size_t szchFileName, LONGLONG liTimeEvent)
+{
+	//Add file from a change notification to be dispatched when it's ready
+	//'pStrFileName' = file name in the watched folder (not null-terminated)
+	//'szchFileName' = length of 'pStrFileName' in WCHARs
+	//'liTimeEvent' = QueryPerformanceCounter() when the notification was received
+	std::wstring strName(pStrFileName, szchFileName);
+
+	//Skip our own output files
+	if (_strOutputFolder.empty() &&
+		isOwnOutputFile(strName.c_str()))
+	{
+		return;
+	}
+
+	std::map<std::wstring, WATCH_PENDING>::iterator it = _mapPending.find(strName);
+	if (it != _mapPending.end())
+	{
+		//Keep its retry interval (a file that is written continuously would otherwise be retried at the shortest one)
+		it->second.liTimeEvent = liTimeEvent;
+		return;
+	}
+
+	WATCH_PENDING& pending = _mapPending[strName];
+	pending.liTimeEvent = liTimeEvent;
+	pending.uiTicksNextTry = ::GetTickCount64();
+	pending.dwRetryMs = WATCH_RETRY_MIN_MS;
+}
+
+
+void CSigRemWatch::dispatchPending()
+{
+	//Send pending files that are no longer written into to workers
+	ULONGLONG uiTicksNow = ::GetTickCount64();
+
+	for (std::map<std::wstring, WATCH_PENDING>::iterator it = _mapPending.begin(); it != _mapPending.end(); )
+	{
+		const std::wstring& strName = it->first;
+		WATCH_PENDING& pending = it->second;
+
+		if (pending.uiTicksNextTry > uiTicksNow)
+		{
+			//Not yet
+			++it;
+			continue;
+		}
+
+		BOOL bRemove = TRUE;
+
+		//Don't start the same file again while it is being processed
+		::AcquireSRWLockShared(&_lockInFlight);
+		BOOL bInFlight = _setInFlight.find(strName) != _setInFlight.end();
+		::ReleaseSRWLockShared(&_lockInFlight);
+
+		if (bInFlight)
+		{
+			//Try again later
+			bRemove = FALSE;
+		}
+		else
+		{
+			std::wstring strPath = _strFolder + strName;
+
+			DWORD dwAttrs = ::GetFileAttributes(strPath.c_str());
+			if (dwAttrs != INVALID_FILE_ATTRIBUTES &&
+				!(dwAttrs & FILE_ATTRIBUTE_DIRECTORY))
+			{
+				//Our share mode locks out writers, so this fails until whoever writes the file closes it
+				HANDLE hFile = ::CreateFile(strPath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+				if (hFile != INVALID_HANDLE_VALUE)
+				{
+					WATCH_ITEM* pItem = new (std::nothrow) WATCH_ITEM;
+					if (pItem)
+					{
+						pItem->pThis = this;
+						pItem->strFilePath = strPath;
+						if (!_strOutputFolder.empty())
+							pItem->strOutputFile = _strOutputFolder + strName;
+						pItem->hFile = hFile;
+						pItem->liTimeEvent = pending.liTimeEvent;
+
+						::AcquireSRWLockExclusive(&_lockInFlight);
+						_setInFlight.insert(strName);
+						::ReleaseSRWLockExclusive(&_lockInFlight);
+
+						if (_workers.Submit(onWorkItem, pItem))
+						{
+							::InterlockedIncrement64(&_stats.nProcessed);
+						}
+						else
+						{
+							//Error
+							CSigRem::ReportOSError(::GetLastError(), L"Failed to start processing file: %s", strPath.c_str());
+
+							::AcquireSRWLockExclusive(&_lockInFlight);
+							_setInFlight.erase(strName);
+							::ReleaseSRWLockExclusive(&_lockInFlight);
+
+							verify(::CloseHandle(hFile));
+							delete pItem;
+						}
+					}
+					else
+					{
+						//Error
+						CSigRem::ReportOSError(ERROR_OUTOFMEMORY, L"Failed to start processing file: %s", strPath.c_str());
+						verify(::CloseHandle(hFile));
+					}
+				}
+				else
+				{
+					int nOSErr = ::GetLastError();
+					if (nOSErr == ERROR_SHARING_VIOLATION)
+					{
+						//Still being written - try again later
+						bRemove = FALSE;
+					}
+					else if (nOSErr != ERROR_FILE_NOT_FOUND)
+					{
+						//Error
+						CSigRem::ReportOSError(nOSErr, L"Failed to open file: %s", strPath.c_str());
+					}
+				}
+			}
+		}
+
+		if (bRemove)
+		{
+			it = _mapPending.erase(it);
+		}
+		else
+		{
+			//Back off, so that a file that stays open for writing is not opened all the time
+			pending.uiTicksNextTry = uiTicksNow + pending.dwRetryMs;
+
+			pending.dwRetryMs *= 2;
+			if (pending.dwRetryMs > WATCH_RETRY_MAX_MS)
+				pending.dwRetryMs = WATCH_RETRY_MAX_MS;
+
+			++it;
+		}
+	}
+}
+
+
+DWORD CSigRemWatch::getPendingTimeout()
+{
+	//RETURN:
+	//		= Time in ms until the next pending file should be tried, or INFINITE if there are none
+	DWORD dwTimeout = INFINITE;
+	ULONGLONG uiTicksNow = ::GetTickCount64();
+
+	for (std::map<std::wstring, WATCH_PENDING>::const_iterator it = _mapPending.begin(); it != _mapPending.end(); ++it)
+	{
+		if (it->second.uiTicksNextTry <= uiTicksNow)
+			return 0;
+
+		ULONGLONG uiWait = it->second.uiTicksNextTry - uiTicksNow;
+		if (uiWait < dwTimeout)
+			dwTimeout = (DWORD)uiWait;
+	}
+
+	return dwTimeout;
+}
+
+
+void CSigRemWatch::rescanFolder()
+{
+	//Add all files modified since we started watching to pending (when change notifications were lost)
+	LARGE_INTEGER liNow;
+	::QueryPerformanceCounter(&liNow);
+
+	WIN32_FIND_DATA wfd = {};
+	HANDLE hFind = ::FindFirstFile((_strFolder + L"*").c_str(), &wfd);
+	if (hFind != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			if (!(wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) &&
+				::CompareFileTime(&wfd.ftLastWriteTime, &_ftStart) >= 0)
+			{
+				addPending(wfd.cFileName, wcslen(wfd.cFileName), liNow.QuadPart);
+			}
+		}
+		while (::FindNextFile(hFind, &wfd));
+
+		verify(::FindClose(hFind));
+	}
+	else
+		CSigRem::ReportOSError(::GetLastError(), L"Failed to enumerate folder: %s", _strFolder.c_str());
+}
+
+
+BOOL CSigRemWatch::isOwnOutputFile(LPCTSTR pStrFileName)
+{
+	//RETURN:
+	//		= TRUE if 'pStrFileName' has the file suffix that we add to output files
+	LPCTSTR pStrExt = ::PathFindExtension(pStrFileName);
+	size_t szchName = pStrExt - pStrFileName;
+
+	return szchName >= SIZEOF_TEXT(SUFFIX_FILE_NAME) &&
+		::CompareStringOrdinal(pStrExt - SIZEOF_TEXT(SUFFIX_FILE_NAME), SIZEOF_TEXT(SUFFIX_FILE_NAME),
+			SUFFIX_FILE_NAME, SIZEOF_TEXT(SUFFIX_FILE_NAME), TRUE) == CSTR_EQUAL;
+}
+
+
+void CSigRemWatch::showSummary()
+{
+	//Output watch results to the console
+	LONGLONG nSuccess = _stats.nSuccess;
+
+	wprintf(
+		L"\n"
+		L"Files dispatched:       %lld\n"
+		L"Signatures removed:     %lld\n"
+		L"Failed:                 %lld\n"
+		L"Average latency:        %.3f ms\n"
+		L"Max latency:            %.3f ms\n"
+		,
+		_stats.nProcessed,
+		nSuccess,
+		_stats.nFailed,
+		nSuccess ? (double)_stats.nLatencyTotalUs / nSuccess / 1000.0 : 0.0,
+		(double)_stats.nLatencyMaxUs / 1000.0
+	);
+}
@@ -0,0 +1,110 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+//Watch a folder and remove digital signatures from PE files as they are written into it
+#pragma once
+
+#include "CSigRem.h"
+#include "CBuffPool.h"
+#include "CWorkerPool.h"
+
+#include <string>
+#include <map>
+#include <set>
+
+
+
+#define WATCH_RETRY_MIN_MS 1				//First interval in ms to retry a file that is still opened for writing (it doubles with each retry)
+#define WATCH_RETRY_MAX_MS 100				//Longest interval in ms to retry a file that is still opened for writing
+#define WATCH_NOTIFY_BUFF_SIZE 0x10000		//Size of the buffer for directory change notifications, in BYTEs
+#define WATCH_POOL_BUFF_SIZE 0x1000000		//Size of each pre-allocated buffer for file data, in BYTEs (larger files use regular allocations)
+
+
+
+struct WATCH_STATS
+{
+	volatile LONGLONG nProcessed;			//Number of files dispatched to workers
+	volatile LONGLONG nSuccess;				//Number of files with removed signature
+	volatile LONGLONG nFailed;				//Number of files that failed to process
+	volatile LONGLONG nLatencyTotalUs;		//Sum of latencies (last change notification to output written) for 'nSuccess' files, in microseconds
+	volatile LONGLONG nLatencyMaxUs;		//Max latency for one file, in microseconds
+};
+
+
+struct WATCH_PENDING
+{
+	LONGLONG liTimeEvent;					//QueryPerformanceCounter() when the last change notification was received for the file
+	ULONGLONG uiTicksNextTry;				//GetTickCount64() when to try to open the file next
+	DWORD dwRetryMs;						//Interval to the try after that, in ms
+};
+
+
+class CSigRemWatch;
+
+struct WATCH_ITEM
+{
+	CSigRemWatch* pThis;
+	std::wstring strFilePath;				//Input file path
+	std::wstring strOutputFile;				//Output file path, or empty to use the file suffix
+	HANDLE hFile;							//Input file opened for reading (with writers locked out)
+	LONGLONG liTimeEvent;					//QueryPerformanceCounter() when the last change notification was received for the file
+};
+
+
+
+class CSigRemWatch
+{
+public:
+	CSigRemWatch();
+	~CSigRemWatch();
+
+	EXIT_CODES Watch(LPCTSTR pStrFolderPath, LPCTSTR pStrOutputFolder = NULL, SIGREM_IO_POLICY ioPolicy = SIP_Buffered);
+
+protected:
+	static BOOL WINAPI onConsoleCtrl(DWORD dwCtrlType);
+	static VOID CALLBACK onWorkItem(PTP_CALLBACK_INSTANCE Instance, PVOID pContext);
+	void processWorkItem(WATCH_ITEM* pItem);
+	void addPending(const WCHAR* pStrFileName, size_t szchFileName, LONGLONG liTimeEvent);
+	void dispatchPending();
+	DWORD getPendingTimeout();
+	void rescanFolder();
+	static BOOL isOwnOutputFile(LPCTSTR pStrFileName);
+	void showSummary();
+
+private:
+	static HANDLE _hStopEvent;							//Manual-reset event that is set to stop watching
+	std::wstring _strFolder;							//Folder being watched (with trailing slash)
+	std::wstring _strOutputFolder;						//Folder for output files (with trailing slash), or empty to use the file suffix
+	std::map<std::wstring, WATCH_PENDING> _mapPending;	//Files with change notifications that were not dispatched yet [file name] = when to try them
+	SRWLOCK _lockInFlight;
+	std::set<std::wstring> _setInFlight;				//Files being processed by workers (protected by '_lockInFlight')
+	LONGLONG _liFreq;									//QueryPerformanceFrequency()
+	FILETIME _ftStart;									//Time when watching started
+	SIGREM_IO_POLICY _ioPolicy;							//How to read and write files
+	CBuffPool _buffPool;
+	CWorkerPool _workers;								//(Must be declared after '_buffPool' to be destroyed before it)
+	WATCH_STATS _stats;
+};
+
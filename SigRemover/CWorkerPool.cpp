@@ -0,0 +1,167 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+
+#include "CWorkerPool.h"
+
+
+
+
+CWorkerPool::CWorkerPool()
+{
+	_pPool = NULL;
+	_pCleanupGroup = NULL;
+	_nThreads = 0;
+}
+
+
+CWorkerPool::~CWorkerPool()
+{
+	Close();
+}
+
+
+BOOL CWorkerPool::Init(DWORD nThreads)
+{
+	//Create thread pool with all of its threads started up front
+	//'nThreads' = number of worker threads, or 0 to use GetDefaultThreadCount()
+	//RETURN:
+	//		= TRUE if success
+	Close();
+
+	if (!nThreads)
+		nThreads = GetDefaultThreadCount();
+
+	_pPool = ::CreateThreadpool(NULL);
+	if (!_pPool)
+		return FALSE;
+
+	//Min = max, so that all threads are created now, and are never retired
+	::SetThreadpoolThreadMaximum(_pPool, nThreads);
+	if (!::SetThreadpoolThreadMinimum(_pPool, nThreads))
+	{
+		int nOSErr = ::GetLastError();
+		Close();
+		::SetLastError(nOSErr);
+		return FALSE;
+	}
+
+	_pCleanupGroup = ::CreateThreadpoolCleanupGroup();
+	if (!_pCleanupGroup)
+	{
+		int nOSErr = ::GetLastError();
+		Close();
+		::SetLastError(nOSErr);
+		return FALSE;
+	}
+
+	::InitializeThreadpoolEnvironment(&_env);
+	::SetThreadpoolCallbackPool(&_env, _pPool);
+	::SetThreadpoolCallbackCleanupGroup(&_env, _pCleanupGroup, NULL);
+
+	_nThreads = nThreads;
+
+	return TRUE;
+}
+
+
+BOOL CWorkerPool::Submit(PTP_SIMPLE_CALLBACK pfnCallback, PVOID pContext)
+{
+	//Queue a callback to run on one of the worker threads
+	//'pfnCallback' = callback to invoke
+	//'pContext' = context for 'pfnCallback'
+	//RETURN:
+	//		= TRUE if success
+	if (!_pPool)
+	{
+		//Not initialized
+		assert(false);
+		::SetLastError(ERROR_INVALID_STATE);
+		return FALSE;
+	}
+
+	return ::TrySubmitThreadpoolCallback(pfnCallback, pContext, &_env);
+}
+
+
+void CWorkerPool::WaitAll()
+{
+	//Wait for all submitted callbacks to finish
+	if (_pCleanupGroup)
+	{
+		::CloseThreadpoolCleanupGroupMembers(_pCleanupGroup, FALSE, NULL);
+	}
+}
+
+
+void CWorkerPool::Close()
+{
+	//Wait for all submitted callbacks to finish and close the pool
+	if (_pCleanupGroup)
+	{
+		WaitAll();
+
+		::DestroyThreadpoolEnvironment(&_env);
+
+		::CloseThreadpoolCleanupGroup(_pCleanupGroup);
+		_pCleanupGroup = NULL;
+	}
+
+	if (_pPool)
+	{
+		::CloseThreadpool(_pPool);
+		_pPool = NULL;
+	}
+
+	_nThreads = 0;
+}
+
+
+DWORD CWorkerPool::GetThreadCount()
+{
+	//RETURN:
+	//		= Number of worker threads, or 0 if not initialized
+	return _nThreads;
+}
+
+
+PTP_CALLBACK_ENVIRON CWorkerPool::GetEnvironment()
+{
+	//RETURN:
+	//		= Callback environment to create other thread pool objects (I/O, timers) in this pool, or NULL if not initialized
+	//INFO: Such objects join the cleanup group, so WaitAll() and Close() will also close any of them that are still open
+	return _pPool ? &_env : NULL;
+}
+
+
+DWORD CWorkerPool::GetDefaultThreadCount()
+{
+	//RETURN:
+	//		= Default number of worker threads (number of logical CPUs)
+	SYSTEM_INFO si = {};
+	::GetSystemInfo(&si);
+
+	return si.dwNumberOfProcessors ? si.dwNumberOfProcessors : 1;
+}
@@ -0,0 +1,54 @@
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+
+//Pool of pre-started worker threads
+#pragma once
+
+#include "CSigRem.h"
+
+
+
+class CWorkerPool
+{
+public:
+	CWorkerPool();
+	~CWorkerPool();
+
+	BOOL Init(DWORD nThreads = 0);
+	BOOL Submit(PTP_SIMPLE_CALLBACK pfnCallback, PVOID pContext);
+	void WaitAll();
+	void Close();
+	DWORD GetThreadCount();
+	PTP_CALLBACK_ENVIRON GetEnvironment();
+
+	static DWORD GetDefaultThreadCount();
+
+private:
+	PTP_POOL _pPool;						//Thread pool, or NULL if not initialized
+	PTP_CLEANUP_GROUP _pCleanupGroup;		//Cleanup group for all callbacks submitted to '_pPool'
+	TP_CALLBACK_ENVIRON _env;				//Callback environment that binds callbacks to '_pPool' and '_pCleanupGroup'
+	DWORD _nThreads;						//Number of threads in '_pPool'
+};
+
@@ -1,160 +1,664 @@
-//  
-//    Binary File Digital Signature Remover App
-//    "Utility to remove digital code signature from binary PE files in Windows."
-//    Copyright (c) 2021 www.dennisbabkin.com
-//    
-//        https://dennisbabkin.com/sigremover
-//
-//        https://dennisbabkin.com/blog/?i=AAA10400
-//
-//    Licensed under the Apache License, Version 2.0 (the "License");
-//    you may not use this file except in compliance with the License.
-//    You may obtain a copy of the License at
-//    
-//        https://www.apache.org/licenses/LICENSE-2.0
-//    
-//    Unless required by applicable law or agreed to in writing, software
-//    distributed under the License is distributed on an "AS IS" BASIS,
-//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
-//    See the License for the specific language governing permissions and
-//    limitations under the License.
-//  
-//
-
-
-// SigRemover.cpp : This file contains the 'main' function. Program execution begins and ends there.
-//
-
-#include <iostream>
-#include "CSigRem.h"
-
-
-
-
-int _tmain(int argc, WCHAR* argv[])
-{
-	//RETURN:
-	//		= See values in EXIT_CODES enum
-	int nExitCode = (int)XC_GEN_FAILURE;
-
-#ifdef FUZZING_BUILD
-	wprintf(L"*** FUZZING BUILD ***\n");
-#endif
-
-	//Do we have a command line?
-	if (argc > 1)
-	{
-		LPCTSTR pInputFile = NULL;
-		LPCTSTR pOutputFile = NULL;
-
-		//Go through command line parameters
-		for (int p = 1; p < argc; p++)
-		{
-			LPCTSTR pCmdParam = argv[p];
-
-			//Check if we need it
-			if (CSigRem::IsCmdLineParam(pCmdParam, L"i"))
-			{
-				//Must have the following file path
-				if (p + 1 < argc)
-				{
-					//Remember it
-					pInputFile = argv[++p];
-				}
-				else
-				{
-					//Error
-					CSigRem::ReportOSError(22, L"-i command line parameter requires a file path");
-					break;
-				}
-			}
-			else if (CSigRem::IsCmdLineParam(pCmdParam, L"o"))
-			{
-				//Must have the following file path
-				if (p + 1 < argc)
-				{
-					//Remember it
-					pOutputFile = argv[++p];
-				}
-				else
-				{
-					//Error
-					CSigRem::ReportOSError(22, L"-o command line parameter requires a file path");
-					break;
-				}
-			}
-			else if (CSigRem::IsCmdLineParam(pCmdParam, L"?") ||
-				CSigRem::IsCmdLineParam(pCmdParam, L"h"))
-			{
-				//Show help
-				CSigRem::ShowHelpInfo();
-
-				pInputFile = NULL;
-				pOutputFile = NULL;
-
-				nExitCode = 0;
-				break;
-			}
-			else
-			{
-				//Unsupported parameter
-				CSigRem::ReportOSError(22, L"Unsupported command line parameter \"%s\", use -? for more info", pCmdParam);
-
-				pInputFile = NULL;
-				pOutputFile = NULL;
-
-				break;
-			}
-		}
-
-
-		//See if we have an input file to work with?
-		if (pInputFile)
-		{
-			//Remove binary signature from the file
-			nExitCode = (int)CSigRem::RemoveDigitalSignature(pInputFile, pOutputFile);
-		}
-		else
-		{
-			//Do we have just an output?
-			if (pOutputFile)
-			{
-				//Error
-				CSigRem::ReportOSError(22, L"-o command line parameter requires the -i parameter");
-			}
-		}
-	}
-	else
-	{
-		//No command line
-		WCHAR buffYr[32];
-		SYSTEMTIME st = {};
-		::GetLocalTime(&st);
-		const int knStartYear = 2021;
-		if (st.wYear <= knStartYear)
-		{
-			verify(SUCCEEDED(::StringCchPrintf(buffYr, _countof(buffYr), L"%04u", knStartYear)));
-		}
-		else
-		{
-			verify(SUCCEEDED(::StringCchPrintf(buffYr, _countof(buffYr), L"%04u-%04u", knStartYear, st.wYear)));
-		}
-
-		wprintf(
-			L"%s\n"
-			L"v.%s\n"
-			L"Copyright (C) %s by www.dennisbabkin.com\n"
-			L"\n"
-			L"Use -h command line switch for more info...\n"
-			,
-			APP_NAME,
-			APP_VERSION,
-			buffYr);
-
-		nExitCode = 0;
-	}
-
-	return nExitCode;
-}
-
-
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+// SigRemover.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+
+#include <iostream>
+#include "CSigRem.h"
+#include "CSigRemBatch.h"
+#include "CSigRemWatch.h"
+#include "CSigRemServer.h"
+#include "CSigRemClient.h"
+#include "CSigRemBench.h"
+#include "CSigRemFixChecksum.h"
+#include "CSigRemArchive.h"
+
+
+
+
+int _tmain(int argc, WCHAR* argv[])
+{
+	//RETURN:
+	//		= See values in EXIT_CODES enum
+	int nExitCode = (int)XC_GEN_FAILURE;
+
+#ifdef FUZZING_BUILD
+	wprintf(L"*** FUZZING BUILD ***\n");
+#endif
+
+	//Do we have a command line?
+	if (argc > 1)
+	{
+		LPCTSTR pInputFile = NULL;
+		LPCTSTR pOutputFile = NULL;
+		LPCTSTR pInputFolder = NULL;
+		LPCTSTR pJournalFile = NULL;
+		BOOL bResume = FALSE;
+		LPCTSTR pWatchFolder = NULL;
+		LPCTSTR pServerPipe = NULL;
+		LPCTSTR pClientPipe = NULL;
+		BOOL bPassHandle = FALSE;
+		DWORD nBenchRequests = 0;
+		DWORD nBenchThreads = 0;
+		SIGREM_IO_POLICY ioPolicy = SIP_Buffered;
+		BOOL bIoPolicy = FALSE;
+		BOOL bBenchIo = FALSE;
+		LPCTSTR pFixChecksumPath = NULL;
+		LPCTSTR pArchiveFile = NULL;
+		LPCTSTR pDiffFolder = NULL;
+
+		//Go through command line parameters
+		for (int p = 1; p < argc; p++)
+		{
+			LPCTSTR pCmdParam = argv[p];
+
+			//Check if we need it
+			if (CSigRem::IsCmdLineParam(pCmdParam, L"i"))
+			{
+				//Must have the following file path
+				if (p + 1 < argc)
+				{
+					//Remember it
+					pInputFile = argv[++p];
+				}
+				else
+				{
+					//Error
+					CSigRem::ReportOSError(22, L"-i command line parameter requires a file path");
+					break;
+				}
+			}
+			else if (CSigRem::IsCmdLineParam(pCmdParam, L"o"))
+			{
+				//Must have the following file path
+				if (p + 1 < argc)
+				{
+					//Remember it
+					pOutputFile = argv[++p];
+				}
+				else
+				{
+					//Error
+					CSigRem::ReportOSError(22, L"-o command line parameter requires a file path");
+					break;
+				}
+			}
+			else if (CSigRem::IsCmdLineParam(pCmdParam, L"d"))
+			{
+				//Must have the following folder path
+				if (p + 1 < argc)
+				{
+					//Remember it
+					pInputFolder = argv[++p];
+				}
+				else
+				{
+					//Error
+					CSigRem::ReportOSError(22, L"-d command line parameter requires a folder path");
+					break;
+				}
+			}
+			else if (CSigRem::IsCmdLineParam(pCmdParam, L"w"))
+			{
+				//Must have the following folder path
+				if (p + 1 < argc)
+				{
+					//Remember it
+					pWatchFolder = argv[++p];
+				}
+				else
+				{
+					//Error
+					CSigRem::ReportOSError(22, L"-w command line parameter requires a folder path");
+					break;
+				}
+			}
+			else if (CSigRem::IsCmdLineParam(pCmdParam, L"j"))
+			{
+				//Must have the following file path
+				if (p + 1 < argc)
+				{
+					//Remember it
+					pJournalFile = argv[++p];
+				}
+				else
+				{
+					//Error
+					CSigRem::ReportOSError(22, L"-j command line parameter requires a file path");
+					break;
+				}
+			}
+			else if (CSigRem::IsCmdLineParam(pCmdParam, L"r"))
+			{
+				//Skip files completed in the journal
+				bResume = TRUE;
+			}
+			else if (CSigRem::IsCmdLineParam(pCmdParam, L"s"))
+			{
+				//Must have the following pipe name
+				if (p + 1 < argc)
+				{
+					//Remember it
+					pServerPipe = argv[++p];
+				}
+				else
+				{
+					//Error
+					CSigRem::ReportOSError(22, L"-s command line parameter requires a pipe name");
+					break;
+				}
+			}
+			else if (CSigRem::IsCmdLineParam(pCmdParam, L"c"))
+			{
+				//Must have the following pipe name
+				if (p + 1 < argc)
+				{
+					//Remember it
+					pClientPipe = argv[++p];
+				}
+				else
+				{
+					//Error
+					CSigRem::ReportOSError(22, L"-c command line parameter requires a pipe name");
+					break;
+				}
+			}
+			else if (CSigRem::IsCmdLineParam(pCmdParam, L"ph"))
+			{
+				//Pass input file handle to the server
+				bPassHandle = TRUE;
+			}
+			else if (CSigRem::IsCmdLineParam(pCmdParam, L"n"))
+			{
+				//Must have the following number
+				if (p + 1 < argc &&
+					CSigRem::ParseCmdLineNumber(argv[p + 1], nBenchRequests))
+				{
+					p++;
+				}
+				else
+				{
+					//Error
+					CSigRem::ReportOSError(22, L"-n command line parameter requires a number of requests");
+					break;
+				}
+			}
+			else if (CSigRem::IsCmdLineParam(pCmdParam, L"t"))
+			{
+				//Must have the following number
+				if (p + 1 < argc &&
+					CSigRem::ParseCmdLineNumber(argv[p + 1], nBenchThreads))
+				{
+					p++;
+				}
+				else
+				{
+					//Error
+					CSigRem::ReportOSError(22, L"-t command line parameter requires a number of connections");
+					break;
+				}
+			}
+			else if (CSigRem::IsCmdLineParam(pCmdParam, L"io"))
+			{
+				//Must have the following policy name
+				if (p + 1 < argc &&
+					CSigRem::ParseIoPolicy(argv[p + 1], ioPolicy))
+				{
+					bIoPolicy = TRUE;
+					p++;
+				}
+				else
+				{
+					//Error
+					CSigRem::ReportOSError(22, L"-io command line parameter requires one of: buffered, sequential, direct");
+					break;
+				}
+			}
+			else if (CSigRem::IsCmdLineParam(pCmdParam, L"fc"))
+			{
+				//Must have the following file or folder path
+				if (p + 1 < argc)
+				{
+					//Remember it
+					pFixChecksumPath = argv[++p];
+				}
+				else
+				{
+					//Error
+					CSigRem::ReportOSError(22, L"-fc command line parameter requires a file or folder path");
+					break;
+				}
+			}
+			else if (CSigRem::IsCmdLineParam(pCmdParam, L"a"))
+			{
+				//Must have the following file path
+				if (p + 1 < argc)
+				{
+					//Remember it
+					pArchiveFile = argv[++p];
+				}
+				else
+				{
+					//Error
+					CSigRem::ReportOSError(22, L"-a command line parameter requires a file path");
+					break;
+				}
+			}
+			else if (CSigRem::IsCmdLineParam(pCmdParam, L"vd"))
+			{
+				//Must have the following folder path
+				if (p + 1 < argc)
+				{
+					//Remember it
+					pDiffFolder = argv[++p];
+				}
+				else
+				{
+					//Error
+					CSigRem::ReportOSError(22, L"-vd command line parameter requires a folder path");
+					break;
+				}
+			}
+			else if (CSigRem::IsCmdLineParam(pCmdParam, L"bio"))
+			{
+				//Benchmark I/O policies
+				bBenchIo = TRUE;
+			}
+			else if (CSigRem::IsCmdLineParam(pCmdParam, L"?") ||
+				CSigRem::IsCmdLineParam(pCmdParam, L"h"))
+			{
+				//Show help
+				CSigRem::ShowHelpInfo();
+
+				pInputFile = NULL;
+				pOutputFile = NULL;
+				pInputFolder = NULL;
+				pJournalFile = NULL;
+				pWatchFolder = NULL;
+				pServerPipe = NULL;
+				pClientPipe = NULL;
+				pFixChecksumPath = NULL;
+				pArchiveFile = NULL;
+				pDiffFolder = NULL;
+
+				nExitCode = 0;
+				break;
+			}
+			else
+			{
+				//Unsupported parameter
+				CSigRem::ReportOSError(22, L"Unsupported command line parameter \"%s\", use -? for more info", pCmdParam);
+
+				pInputFile = NULL;
+				pOutputFile = NULL;
+				pInputFolder = NULL;
+				pJournalFile = NULL;
+				pWatchFolder = NULL;
+				pServerPipe = NULL;
+				pClientPipe = NULL;
+				pFixChecksumPath = NULL;
+				pArchiveFile = NULL;
+				pDiffFolder = NULL;
+
+				break;
+			}
+		}
+
+
+		//See what we need to do?
+		if ((bPassHandle || nBenchThreads) &&
+			!pClientPipe)
+		{
+			//Error
+			CSigRem::ReportOSError(22, L"-ph and -t command line parameters require the -c parameter");
+		}
+		else if (nBenchRequests &&
+			!pClientPipe &&
+			!bBenchIo)
+		{
+			//Error
+			CSigRem::ReportOSError(22, L"-n command line parameter requires the -c or -bio parameter");
+		}
+		else if (bIoPolicy &&
+			(pClientPipe || bBenchIo))
+		{
+			//Error
+			CSigRem::ReportOSError(22, L"-io command line parameter cannot be used with -c or -bio");
+		}
+		else if (pFixChecksumPath)
+		{
+			if (pInputFile ||
+				pOutputFile ||
+				pInputFolder ||
+				pJournalFile ||
+				bResume ||
+				pWatchFolder ||
+				pServerPipe ||
+				pClientPipe ||
+				bIoPolicy ||
+				bBenchIo ||
+				nBenchRequests ||
+				pArchiveFile ||
+				pDiffFolder)
+			{
+				//Error
+				CSigRem::ReportOSError(22, L"-fc command line parameter cannot be used with other parameters");
+			}
+			else
+			{
+				//Repair checksums in place
+				CSigRemFixChecksum fix;
+				nExitCode = (int)fix.Process(pFixChecksumPath);
+			}
+		}
+		else if (pDiffFolder)
+		{
+			if (pInputFile ||
+				pOutputFile ||
+				pInputFolder ||
+				pJournalFile ||
+				bResume ||
+				pWatchFolder ||
+				pServerPipe ||
+				pClientPipe ||
+				bIoPolicy ||
+				bBenchIo ||
+				nBenchRequests ||
+				pFixChecksumPath ||
+				pArchiveFile)
+			{
+				//Error
+				CSigRem::ReportOSError(22, L"-vd command line parameter cannot be used with other parameters");
+			}
+			else
+			{
+				//Compare all engines on the corpus
+				nExitCode = (int)CSigRemBench::Differential(pDiffFolder);
+			}
+		}
+		else if (pArchiveFile)
+		{
+			if (pInputFile ||
+				pInputFolder ||
+				pJournalFile ||
+				bResume ||
+				pWatchFolder ||
+				pServerPipe ||
+				pClientPipe ||
+				bIoPolicy ||
+				bBenchIo ||
+				nBenchRequests)
+			{
+				//Error
+				CSigRem::ReportOSError(22, L"-a command line parameter can be used only with -o");
+			}
+			else
+			{
+				//Remove binary signatures from PE files in the archive
+				CSigRemArchive archive;
+				nExitCode = (int)archive.ProcessArchive(pArchiveFile, pOutputFile);
+			}
+		}
+		else if (bBenchIo)
+		{
+			if (!pInputFile)
+			{
+				//Error
+				CSigRem::ReportOSError(22, L"-bio command line parameter requires the -i parameter");
+			}
+			else if (pOutputFile ||
+				pInputFolder ||
+				pJournalFile ||
+				bResume ||
+				pWatchFolder ||
+				pServerPipe ||
+				pClientPipe)
+			{
+				//Error
+				CSigRem::ReportOSError(22, L"-bio command line parameter can be used only with -i and -n");
+			}
+			else
+			{
+				//Compare I/O policies on the file
+				nExitCode = (int)CSigRemBench::IoPolicies(pInputFile, nBenchRequests ? nBenchRequests : BENCH_DEFAULT_RUNS);
+			}
+		}
+		else if (nBenchThreads &&
+			!nBenchRequests)
+		{
+			//Error
+			CSigRem::ReportOSError(22, L"-t command line parameter requires the -n parameter");
+		}
+		else if (pServerPipe)
+		{
+			if (pInputFile ||
+				pOutputFile ||
+				pInputFolder ||
+				pJournalFile ||
+				bResume ||
+				pWatchFolder ||
+				pClientPipe)
+			{
+				//Error
+				CSigRem::ReportOSError(22, L"-s command line parameter can be used only with -io");
+			}
+			else
+			{
+				//Serve requests from clients until stopped
+				CSigRemServer server;
+				nExitCode = (int)server.Run(pServerPipe, ioPolicy);
+			}
+		}
+		else if (pClientPipe)
+		{
+			if (!pInputFile)
+			{
+				//Error
+				CSigRem::ReportOSError(22, L"-c command line parameter requires the -i parameter");
+			}
+			else if (pInputFolder ||
+				pJournalFile ||
+				bResume ||
+				pWatchFolder)
+			{
+				//Error
+				CSigRem::ReportOSError(22, L"-c command line parameter can be used only with -i, -o, -ph, -n and -t");
+			}
+			else if (nBenchRequests)
+			{
+				//Generate load on the server
+				CLIENT_BENCH_PARAMS bp = {};
+				bp.pStrPipeName = pClientPipe;
+				bp.pStrInputFile = pInputFile;
+				bp.pStrOutputFile = pOutputFile;
+				bp.nRequests = nBenchRequests;
+				bp.nThreads = nBenchThreads ? nBenchThreads : 1;
+				bp.bPassHandle = bPassHandle;
+
+				nExitCode = (int)CSigRemClient::RunBenchmark(bp);
+			}
+			else
+			{
+				CSigRemClient client;
+				if (client.Connect(pClientPipe))
+				{
+					//Have the server remove binary signature from the file
+					if (bPassHandle)
+					{
+						HANDLE hFile = ::CreateFile(pInputFile, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
+						if (hFile != INVALID_HANDLE_VALUE)
+						{
+							nExitCode = (int)client.RemoveDigitalSignatureFromHandle(hFile, pInputFile, pOutputFile);
+
+							verify(::CloseHandle(hFile));
+						}
+						else
+						{
+							//Error
+							CSigRem::ReportOSError(::GetLastError(), L"Failed to open file: %s", pInputFile);
+							nExitCode = (int)XC_FailedToOpen;
+						}
+					}
+					else
+					{
+						nExitCode = (int)client.RemoveDigitalSignature(pInputFile, pOutputFile);
+					}
+
+					if (nExitCode == (int)XC_GEN_FAILURE)
+					{
+						//Error
+						CSigRem::ReportOSError(::GetLastError(), L"Failed to get reply from server: %s", pClientPipe);
+					}
+				}
+				else
+				{
+					//Error
+					CSigRem::ReportOSError(::GetLastError(), L"Failed to connect to server: %s", pClientPipe);
+					nExitCode = (int)XC_FailedToOpen;
+				}
+			}
+		}
+		else if (pWatchFolder)
+		{
+			if (pInputFile ||
+				pInputFolder ||
+				pJournalFile ||
+				bResume)
+			{
+				//Error
+				CSigRem::ReportOSError(22, L"-w command line parameter can be used only with -o and -io");
+			}
+			else
+			{
+				//Remove binary signatures from files as they are written into the folder
+				CSigRemWatch watch;
+				nExitCode = (int)watch.Watch(pWatchFolder, pOutputFile, ioPolicy);
+			}
+		}
+		else if (pInputFolder)
+		{
+			if (pInputFile ||
+				pOutputFile)
+			{
+				//Error
+				CSigRem::ReportOSError(22, L"-d command line parameter cannot be used with -i or -o");
+			}
+			else if (bResume &&
+				!pJournalFile)
+			{
+				//Error
+				CSigRem::ReportOSError(22, L"-r command line parameter requires the -j parameter");
+			}
+			else
+			{
+				CSigRemJournal journal;
+				if (!pJournalFile ||
+					journal.Open(pJournalFile, bResume))
+				{
+					//Remove binary signatures from all files in the folder
+					CSigRemBatch batch;
+					nExitCode = (int)batch.ProcessFolder(pInputFolder, pJournalFile ? &journal : NULL, ioPolicy);
+
+					if (pJournalFile &&
+						!journal.Close())
+					{
+						//Error was reported
+						nExitCode = (int)XC_FailedFileWrite;
+					}
+				}
+				else
+				{
+					//Error was reported
+					nExitCode = (int)XC_FailedToOpen;
+				}
+			}
+		}
+		else if (pInputFile)
+		{
+			if (pJournalFile ||
+				bResume)
+			{
+				//Error
+				CSigRem::ReportOSError(22, L"-j and -r command line parameters require the -d parameter");
+			}
+			else
+			{
+				//Remove binary signature from the file
+				SIGREM_PARAMS params = {};
+				params.ioPolicy = ioPolicy;
+
+				nExitCode = (int)CSigRem::RemoveDigitalSignature(pInputFile, pOutputFile, NULL, &params);
+			}
+		}
+		else
+		{
+			//Do we have just an output?
+			if (pOutputFile)
+			{
+				//Error
+				CSigRem::ReportOSError(22, L"-o command line parameter requires the -i parameter");
+			}
+			else if (pJournalFile ||
+				bResume)
+			{
+				//Error
+				CSigRem::ReportOSError(22, L"-j and -r command line parameters require the -d parameter");
+			}
+		}
+	}
+	else
+	{
+		//No command line
+		WCHAR buffYr[32];
+		SYSTEMTIME st = {};
+		::GetLocalTime(&st);
+		const int knStartYear = 2021;
+		if (st.wYear <= knStartYear)
+		{
+			verify(SUCCEEDED(::StringCchPrintf(buffYr, _countof(buffYr), L"%04u", knStartYear)));
+		}
+		else
+		{
+			verify(SUCCEEDED(::StringCchPrintf(buffYr, _countof(buffYr), L"%04u-%04u", knStartYear, st.wYear)));
+		}
+
+		wprintf(
+			L"%s\n"
+			L"v.%s\n"
+			L"Copyright (C) %s by www.dennisbabkin.com\n"
+			L"\n"
+			L"Use -h command line switch for more info...\n"
+			,
+			APP_NAME,
+			APP_VERSION,
+			buffYr);
+
+		nExitCode = 0;
+	}
+
+	return nExitCode;
+}
+
+
@@ -1,57 +1,101 @@
-//  
-//    Binary File Digital Signature Remover App
-//    "Utility to remove digital code signature from binary PE files in Windows."
-//    Copyright (c) 2021 www.dennisbabkin.com
-//    
-//        https://dennisbabkin.com/sigremover
-//
-//        https://dennisbabkin.com/blog/?i=AAA10400
-//
-//    Licensed under the Apache License, Version 2.0 (the "License");
-//    you may not use this file except in compliance with the License.
-//    You may obtain a copy of the License at
-//    
-//        https://www.apache.org/licenses/LICENSE-2.0
-//    
-//    Unless required by applicable law or agreed to in writing, software
-//    distributed under the License is distributed on an "AS IS" BASIS,
-//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
-//    See the License for the specific language governing permissions and
-//    limitations under the License.
-//  
-//
-
-
-//Custom types
-#pragma once
-
-
-#define APP_NAME L"Binary File Digital Signature Remover App"
-#define APP_VERSION L"1.0.2"
-
-
-//#define FUZZING_BUILD			//Uncomment to generate a fuzzing build
-
-
-enum EXIT_CODES {
-	XC_Success = 0,
-	XC_BinaryHasNoSignature = 1,
-
-	XC_GEN_FAILURE = -1,
-	XC_FailedToOpen = -2,
-	XC_Not_PE_File = -3,
-	XC_BadSignature = -4,
-	XC_FailedChecksum = -5,
-	XC_FailedFileWrite = -6,
-};
-
-
-
-
-#define CHECK_PTR_4_OVERRUN(p_s, end) 	((BYTE*)(p_s) >= (end) || (BYTE*)(p_s) + sizeof(*(p_s)) >= (end))
-
-#define SIZEOF_TEXT(t) (_countof(t) - 1)
-
-
-
-
+//  
+//    Binary File Digital Signature Remover App
+//    "Utility to remove digital code signature from binary PE files in Windows."
+//    Copyright (c) 2021 www.dennisbabkin.com
+//    
+//        https://dennisbabkin.com/sigremover
+//
+//        https://dennisbabkin.com/blog/?i=AAA10400
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//    
+//        https://www.apache.org/licenses/LICENSE-2.0
+//    
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//  
+//
+
+
+//Custom types
+#pragma once
+
+
+#define APP_NAME L"Binary File Digital Signature Remover App"
+#define APP_VERSION L"1.0.2"
+
+
+//#define FUZZING_BUILD			//Uncomment to generate a fuzzing build
+
+
+enum EXIT_CODES {
+	XC_Success = 0,
+	XC_BinaryHasNoSignature = 1,
+	XC_ChecksumIsCorrect = 2,
+
+	XC_GEN_FAILURE = -1,
+	XC_FailedToOpen = -2,
+	XC_Not_PE_File = -3,
+	XC_BadSignature = -4,
+	XC_FailedChecksum = -5,
+	XC_FailedFileWrite = -6,
+	XC_Cancelled = -7,
+	XC_TimedOut = -8,
+};
+
+
+
+
+//Protocol for the server mode (over a named pipe in message mode)
+#define SIGREM_PIPE_PREFIX L"\\\\.\\pipe\\"
+#define SIGREM_PIPE_REQUEST_MAGIC 0x51524753			//'SGRQ'
+#define SIGREM_PIPE_REPLY_MAGIC 0x50524753				//'SGRP'
+#define SIGREM_PIPE_VERSION 1
+
+enum SIGREM_PIPE_FLAGS {
+	SPF_INPUT_HANDLE = 0x1,				//'hInputFile' is used for input (and the input path is used only to name the output file)
+};
+
+struct SIGREM_PIPE_REQUEST
+{
+	DWORD dwMagic;						//SIGREM_PIPE_REQUEST_MAGIC
+	DWORD dwVersion;					//SIGREM_PIPE_VERSION
+	DWORD dwFlags;						//Combination of SIGREM_PIPE_FLAGS
+	DWORD dwcbRequest;					//Size of the request in BYTEs, including this header and both paths
+	ULONGLONG hInputFile;				//If SPF_INPUT_HANDLE: value of the input file handle in the client process (it will be duplicated by the server)
+	WORD wcchInputPath;					//Length of the input file path in WCHARs (without terminating null)
+	WORD wcchOutputPath;				//Length of the output file path in WCHARs (without terminating null), or 0 to use the file suffix
+	DWORD dwReserved;					//Set to 0
+
+	//Followed by:
+	//	WCHAR input path [wcchInputPath]
+	//	WCHAR output path [wcchOutputPath]
+};
+
+struct SIGREM_PIPE_REPLY
+{
+	DWORD dwMagic;						//SIGREM_PIPE_REPLY_MAGIC
+	int nExitCode;						//Result of the request, one of EXIT_CODES
+	ULONGLONG uicbInputSz;				//Size of the input file in BYTEs
+	ULONGLONG uicbOutputSz;				//Size of the output file in BYTEs (valid only if 'nExitCode' is XC_Success)
+};
+
+#define SIGREM_PIPE_MAX_REQUEST (sizeof(SIGREM_PIPE_REQUEST) + 2 * 0xFFFF * sizeof(WCHAR))
+
+
+
+
+#define CHECK_PTR_4_OVERRUN(p_s, end) 	((BYTE*)(p_s) >= (end) || (BYTE*)(p_s) + sizeof(*(p_s)) >= (end))
+
+#define SIZEOF_TEXT(t) (_countof(t) - 1)
+
+#define ALIGN_UP(v, a) (((v) + (a) - 1) & ~((a) - 1))		//Round 'v' up to 'a', which must be a power of 2
+
+
+
+